@@ -0,0 +1,377 @@
+// Synthetic code segment benchmark, development builds with BENCHMARK defined only.
+#include "stdafx.h"
+#ifdef BENCHMARK
+#include <vector>
+#include <algorithm>
+#include "Benchmark.h"
+
+// Segment name, replaced on each run and left in the IDB afterwards to look at
+#define BENCH_SEGNAME "$bench"
+
+// Generated function count, and the fixed random seed so runs are comparable
+#define BENCH_FUNCS 2000
+#define BENCH_SEED 0x2545F491
+
+// Damage, in percent: functions stripped to unknown bytes, stripped function starts made
+// bad data, and padding runs made data
+#define BENCH_STRIP_PCT   40
+#define BENCH_BADDATA_PCT 10
+#define BENCH_PADDATA_PCT 30
+
+namespace Benchmark
+{
+	// Ground truth
+	struct FUNCTRUTH
+	{
+		ea_t start, end;
+		BOOL stripped;
+	};
+	static std::vector<FUNCTRUTH> s_funcs;
+	static std::vector<range_t> s_islands, s_padding;
+
+	static std::vector<BYTE> s_code;
+	static ea_t s_base = BADADDR;
+	static BOOL s_is64 = FALSE, s_active = FALSE;
+	static UINT s_random = BENCH_SEED;
+	static UINT s_recoveredBefore = 0;
+	static double s_passSeconds[4], s_passBytes[4];
+
+	// xorshift32
+	static UINT nextRandom(UINT range)
+	{
+		s_random ^= (s_random << 13);
+		s_random ^= (s_random >> 17);
+		s_random ^= (s_random << 5);
+		return(s_random % range);
+	}
+
+	static ea_t here() { return(s_base + s_code.size()); }
+	static void emit(const char *bytes, UINT size) { s_code.insert(s_code.end(), (const BYTE *) bytes, ((const BYTE *) bytes + size)); }
+	static void emit8(UINT value) { s_code.push_back((BYTE) value); }
+	static void emit32(UINT value) { for (int i = 0; i < 4; i++) emit8(value >> (i * 8)); }
+	static void patch8(size_t offset, UINT value) { s_code[offset] = (BYTE) value; }
+	static void patch32(size_t offset, UINT value) { for (int i = 0; i < 4; i++) s_code[offset + i] = (BYTE) (value >> (i * 8)); }
+
+	// Pad to the next 16 byte boundary with one of the typical compiler fillers
+	static void emitPadding()
+	{
+		UINT size = (UINT) ((16 - (here() & 15)) & 15);
+		if (!size)
+			return;
+
+		ea_t start = here();
+		switch (nextRandom(3))
+		{
+			case 0: while (size--) emit8(0xCC); break;
+			case 1: while (size--) emit8(0x90); break;
+
+			// Multi-byte NOPs, biggest first
+			case 2:
+			{
+				static const char * const nops[] =
+				{
+					"\x90", "\x66\x90", "\x0F\x1F\x00", "\x0F\x1F\x40\x00", "\x0F\x1F\x44\x00\x00",
+					"\x66\x0F\x1F\x44\x00\x00", "\x0F\x1F\x80\x00\x00\x00\x00", "\x0F\x1F\x84\x00\x00\x00\x00\x00",
+				};
+				while (size)
+				{
+					UINT length = std::min(size, (UINT) 8);
+					emit(nops[length - 1], length);
+					size -= length;
+				}
+			}
+			break;
+		};
+		s_padding.push_back(range_t(start, here()));
+	}
+
+	// One function, followed by its data islands and padding
+	static void emitFunction()
+	{
+		FUNCTRUTH func = { here(), 0, FALSE };
+
+		// Prologue
+		if (s_is64)
+			emit("\x48\x83\xEC\x28", 4);	// sub rsp, 28h
+		else
+			emit("\x55\x8B\xEC", 3);		// push ebp, mov ebp, esp
+
+		size_t constantFixup = 0, tableFixup = 0, caseStart = 0;
+		for (UINT i = (2 + nextRandom(12)); i > 0; i--)
+		{
+			switch (nextRandom(6))
+			{
+				case 0: emit("\x8B\xC1", 2); break;							// mov eax, ecx
+				case 1: emit("\x33\xC0", 2); break;							// xor eax, eax
+				case 2: emit("\x83\xC0", 2); emit8(nextRandom(0x80)); break;	// add eax, imm8
+				case 3: emit("\x85\xC0\x74\x02\x33\xC9", 6); break;			// test eax, eax; jz $+4; xor ecx, ecx
+
+				// Call an earlier function
+				case 4:
+				if (!s_funcs.empty())
+				{
+					ea_t target = s_funcs[nextRandom((UINT) s_funcs.size())].start;
+					emit8(0xE8);
+					emit32((UINT) (target - (here() + 4)));
+				}
+				break;
+
+				// Load a double constant from an island, absolute in 32 bit, RIP relative in 64
+				case 5:
+				if (!constantFixup)
+				{
+					emit("\xF2\x0F\x10\x05", 4);	// movsd xmm0, [constant]
+					constantFixup = s_code.size();
+					emit32(0);
+				}
+				break;
+			};
+		}
+
+		// A small jump table switch, 32 bit only (x64 ones need the image base to go with)
+		size_t jaFixup = 0;
+		if (!s_is64 && (nextRandom(8) == 0))
+		{
+			emit("\x83\xF8\x03\x77", 4);	// cmp eax, 3; ja end
+			jaFixup = s_code.size();
+			emit8(0);
+			emit("\xFF\x24\x85", 3);		// jmp [eax * 4 + table]
+			tableFixup = s_code.size();
+			emit32(0);
+
+			caseStart = s_code.size();
+			for (int i = 0; i < 4; i++)
+				emit("\x40\xEB\x00", 3);	// inc eax; jmp end
+		}
+
+		// Epilogue
+		size_t end = s_code.size();
+		if (jaFixup)
+		{
+			patch8(jaFixup, (UINT) (end - (jaFixup + 1)));
+			for (int i = 0; i < 4; i++)
+			{
+				size_t jmp = (caseStart + (i * 3) + 2);
+				patch8(jmp, (UINT) (end - (jmp + 1)));
+			}
+		}
+		if (s_is64)
+			emit("\x48\x83\xC4\x28\xC3", 5);	// add rsp, 28h; retn
+		else
+			emit("\x5D\xC3", 2);				// pop ebp; retn
+		func.end = here();
+		s_funcs.push_back(func);
+
+		// Data islands
+		if (tableFixup)
+		{
+			ea_t table = here();
+			patch32(tableFixup, (UINT) table);
+			for (int i = 0; i < 4; i++)
+				emit32((UINT) (s_base + caseStart + (i * 3)));
+			s_islands.push_back(range_t(table, here()));
+		}
+		if (constantFixup)
+		{
+			ea_t constant = here();
+			patch32(constantFixup, (UINT) (s_is64 ? (constant - (s_base + constantFixup + 4)) : constant));
+			emit("\x00\x00\x00\x00\x00\x00\xF0\x3F", 8);	// 1.0
+			s_islands.push_back(range_t(constant, here()));
+		}
+
+		emitPadding();
+	}
+
+	static void generate()
+	{
+		s_code.clear();
+		s_funcs.clear();
+		s_islands.clear();
+		s_padding.clear();
+		s_random = BENCH_SEED;
+		for (int i = 0; i < BENCH_FUNCS; i++)
+			emitFunction();
+	}
+
+	static BOOL isTruthStart(ea_t ea)
+	{
+		for (std::vector<FUNCTRUTH>::const_iterator it = s_funcs.begin(); it != s_funcs.end(); ++it)
+		{
+			if (it->start == ea)
+				return(TRUE);
+		}
+		return(FALSE);
+	}
+
+	static BOOL isRecovered(const FUNCTRUTH &func)
+	{
+		func_t *f = get_func(func.start);
+		return(f && (f->start_ea == func.start));
+	}
+
+	static UINT countStrippedRecovered()
+	{
+		UINT count = 0;
+		for (std::vector<FUNCTRUTH>::const_iterator it = s_funcs.begin(); it != s_funcs.end(); ++it)
+		{
+			if (it->stripped && isRecovered(*it))
+				count++;
+		}
+		return(count);
+	}
+
+	segment_t *begin()
+	{
+		if (segment_t *old = get_segm_by_name(BENCH_SEGNAME))
+			del_segm(old->start_ea, SEGMOD_KILL);
+
+		s_is64 = inf.is_64bit();
+		s_base = ((inf.max_ea + 0xFFFF) & ~((ea_t) 0xFFFF));
+		generate();
+
+		segment_t seg;
+		seg.start_ea = s_base;
+		seg.end_ea   = here();
+		seg.bitness  = (s_is64 ? 2 : 1);
+		seg.perm     = (SEGPERM_EXEC | SEGPERM_READ);
+		seg.type     = SEG_CODE;
+		seg.align    = saRelPara;
+		seg.comb     = scPub;
+		if (!add_segm_ex(&seg, BENCH_SEGNAME, "CODE", (ADDSEG_NOSREG | ADDSEG_QUIET)))
+		{
+			msg("** Benchmark segment add failed! **\n");
+			return(NULL);
+		}
+		put_bytes(s_base, s_code.data(), s_code.size());
+
+		// The intact analysis
+		for (std::vector<FUNCTRUTH>::iterator it = s_funcs.begin(); it != s_funcs.end(); ++it)
+			auto_make_proc(it->start);
+		auto_wait();
+		for (std::vector<range_t>::iterator it = s_islands.begin(); it != s_islands.end(); ++it)
+		{
+			if (it->size() == 8)
+				create_qword(it->start_ea, 8);
+			else
+				create_dword(it->start_ea, it->size());
+		}
+		for (std::vector<range_t>::iterator it = s_padding.begin(); it != s_padding.end(); ++it)
+			create_align(it->start_ea, it->size(), 0);
+		auto_wait();
+
+		// Damage it
+		UINT stripped = 0;
+		for (std::vector<FUNCTRUTH>::iterator it = s_funcs.begin(); it != s_funcs.end(); ++it)
+		{
+			if (nextRandom(100) < BENCH_STRIP_PCT)
+			{
+				del_func(it->start);
+				del_items(it->start, DELIT_SIMPLE, (it->end - it->start));
+				if (nextRandom(100) < BENCH_BADDATA_PCT)
+					create_dword(it->start, 4);
+				it->stripped = TRUE;
+				stripped++;
+			}
+		}
+		for (std::vector<range_t>::iterator it = s_padding.begin(); it != s_padding.end(); ++it)
+		{
+			if (nextRandom(100) < BENCH_PADDATA_PCT)
+			{
+				del_items(it->start_ea, DELIT_SIMPLE, it->size());
+				create_byte(it->start_ea, it->size());
+			}
+		}
+		auto_wait();
+
+		memset(s_passSeconds, 0, sizeof(s_passSeconds));
+		memset(s_passBytes, 0, sizeof(s_passBytes));
+		s_recoveredBefore = countStrippedRecovered();
+		s_active = TRUE;
+
+		char buffer[32], buffer2[32];
+		msg("Benchmark: %s bit, %s functions, %s stripped, at " EAFORMAT ".\n", (s_is64 ? "64" : "32"), prettyNumberString(s_funcs.size(), buffer), prettyNumberString(stripped, buffer2), s_base);
+		return(getseg(s_base));
+	}
+
+	BOOL active()
+	{
+		return(s_active);
+	}
+
+	void passDone(int pass, double seconds, double bytes)
+	{
+		if (s_active && (pass >= 0) && (pass < 4))
+		{
+			s_passSeconds[pass] += seconds;
+			s_passBytes[pass] += bytes;
+		}
+	}
+
+	void report()
+	{
+		if (!s_active)
+			return;
+
+		UINT stripped = 0;
+		for (std::vector<FUNCTRUTH>::const_iterator it = s_funcs.begin(); it != s_funcs.end(); ++it)
+			stripped += (it->stripped ? 1 : 0);
+		UINT recovered = countStrippedRecovered();
+
+		// Functions that start anywhere else
+		UINT falseFuncs = 0;
+		ea_t end = (s_base + s_code.size());
+		for (func_t *f = get_next_func(s_base - 1); f && (f->start_ea < end); f = get_next_func(f->start_ea))
+		{
+			if (!isTruthStart(f->start_ea))
+				falseFuncs++;
+		}
+
+		// Data islands made code
+		UINT brokenIslands = 0;
+		for (std::vector<range_t>::const_iterator it = s_islands.begin(); it != s_islands.end(); ++it)
+		{
+			for (ea_t ea = it->start_ea; ea < it->end_ea; ea++)
+			{
+				if (is_code(get_flags(ea)))
+				{
+					brokenIslands++;
+					break;
+				}
+			}
+		}
+
+		// Padding no longer data
+		UINT padding = 0;
+		for (std::vector<range_t>::const_iterator it = s_padding.begin(); it != s_padding.end(); ++it)
+		{
+			flags_t flags = get_flags(it->start_ea);
+			if (!is_data(flags) || is_align(flags))
+				padding++;
+		}
+
+		msg("\n===== Benchmark =====\n");
+		msg("        Recovered: %u of %u stripped (%u before)\n", recovered, stripped, s_recoveredBefore);
+		msg("  False functions: %u\n", falseFuncs);
+		msg("   Broken islands: %u of %u\n", brokenIslands, (UINT) s_islands.size());
+		msg("          Padding: %u of %u restored\n", padding, (UINT) s_padding.size());
+
+		static const char * const passNames[4] = { "Unknown data", "Align blocks", "Missing code", "Missing functions" };
+		for (int i = 0; i < 4; i++)
+		{
+			if (s_passSeconds[i] > 0)
+				msg("%17s: %.0f bytes/s, %s\n", passNames[i], (s_passBytes[i] / s_passSeconds[i]), timeString(s_passSeconds[i]));
+		}
+		if (s_passSeconds[3] > 0)
+			msg("%17s: %.1f functions/s\n", "Recovery", ((double) (recovered - s_recoveredBefore) / s_passSeconds[3]));
+		msg(" \n");
+	}
+
+	void end()
+	{
+		s_active = FALSE;
+		std::vector<BYTE> empty;
+		s_code.swap(empty);
+	}
+};
+
+#endif // BENCHMARK
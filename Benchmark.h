@@ -0,0 +1,21 @@
+// Synthetic code segment benchmark, development builds with BENCHMARK defined only.
+// Generates a code segment with known functions, padding, switch tables and data islands,
+// lets IDA analyze it, damages it, then scores how much the passes recover and how fast.
+#pragma once
+#ifdef BENCHMARK
+
+namespace Benchmark
+{
+	// Build the damaged segment past the end of the database, returns NULL on failure
+	segment_t *begin();
+	BOOL active();
+
+	// Pass throughput sample, pass index, seconds and segment bytes covered
+	void passDone(int pass, double seconds, double bytes);
+
+	// Score it against the ground truth
+	void report();
+	void end();
+};
+
+#endif // BENCHMARK
@@ -0,0 +1,243 @@
+// Segment census
+#include "stdafx.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include "Census.h"
+#include "Padding.h"
+
+// Not exported by the SDK headers, see Main.cpp
+#define FF_IVL 0x00000100LU	// Byte has value ?
+
+// SSE2 lane masks, 4 flags at a time
+static inline __m128i splat(UINT32 value) { return(_mm_set1_epi32((int) value)); }
+static inline UINT lanes(__m128i mask)
+{
+	static const BYTE bitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+	return(bitCount[_mm_movemask_ps(_mm_castsi128_ps(mask))]);
+}
+
+static inline __m128i isData(__m128i flags)
+{
+	__m128i data  = _mm_cmpeq_epi32(_mm_and_si128(flags, splat(MS_CLS)), splat(FF_DATA));
+	__m128i align = _mm_cmpeq_epi32(_mm_and_si128(flags, splat(DT_TYPE)), splat(FF_ALIGN));
+	return(_mm_andnot_si128(align, data));
+}
+
+static inline __m128i isUnknown(__m128i flags)
+{
+	__m128i unknown = _mm_cmpeq_epi32(_mm_and_si128(flags, splat(MS_CLS)), splat(FF_UNK));
+	__m128i value   = _mm_cmpeq_epi32(_mm_and_si128(flags, splat(FF_IVL)), splat(FF_IVL));
+	return(_mm_and_si128(unknown, value));
+}
+
+// 0xCC or 0x90 valued head, not already an align item or a 0x90 instruction (loop head NOPs in functions);
+// or a 0x00 one outside of data items. Tails are left out here, code ones are too common a false hit; data item ones
+// are looked for separately, see CensusClassifier::classify().
+// The multi-byte NOP forms are looked for separately, see CensusClassifier::classify().
+static inline __m128i isPadding(__m128i flags)
+{
+	__m128i value = _mm_and_si128(flags, splat(FF_IVL | 0xFF));
+	__m128i cls   = _mm_and_si128(flags, splat(MS_CLS));
+	__m128i pad   = _mm_or_si128(_mm_cmpeq_epi32(value, splat(FF_IVL | 0xCC)), _mm_cmpeq_epi32(value, splat(FF_IVL | 0x90)));
+	__m128i zero  = _mm_andnot_si128(_mm_cmpeq_epi32(cls, splat(FF_DATA)), _mm_cmpeq_epi32(value, splat(FF_IVL)));
+	__m128i tail  = _mm_cmpeq_epi32(cls, splat(FF_TAIL));
+	__m128i align = _mm_cmpeq_epi32(_mm_and_si128(flags, splat(DT_TYPE | MS_CLS)), splat(FF_ALIGN | FF_DATA));
+	__m128i nop   = _mm_and_si128(_mm_cmpeq_epi32(value, splat(FF_IVL | 0x90)), _mm_cmpeq_epi32(cls, splat(FF_CODE)));
+	return(_mm_andnot_si128(_mm_or_si128(_mm_or_si128(tail, align), nop), _mm_or_si128(pad, zero)));
+}
+
+// A 0xCC or 0x90 valued byte
+static inline BOOL isFillValue(flags_t flags)
+{
+	flags_t value = (flags & (FF_IVL | 0xFF));
+	return((value == (FF_IVL | 0xCC)) || (value == (FF_IVL | 0x90)));
+}
+
+CensusClassifier::CensusClassifier() : m_start(0), m_end(0), m_dataItems(0), m_unknownRuns(0), m_paddingRuns(0), m_funcGaps(0), m_prevFlags(0), m_inData(FALSE), m_valid(FALSE)
+{
+}
+
+void CensusClassifier::reset(ea_t start, ea_t end)
+{
+	m_start = start;
+	m_end = end;
+	m_blocks.assign((size_t) (((end - start) + (CENSUS_BLOCK - 1)) / CENSUS_BLOCK), 0);
+	m_dataItems = m_unknownRuns = m_paddingRuns = m_funcGaps = 0;
+	m_prevFlags = 0;
+	m_inData = FALSE;
+	m_valid = FALSE;
+}
+
+void CensusClassifier::classify(const FLAGWINDOW &window)
+{
+	// A copy with the previous window's last flags in front, so every lane has its predecessor
+	size_t count = (size_t) (window.ownedEnd - window.start);
+	std::vector<flags_t> flags(count + 1);
+	flags[0] = m_prevFlags;
+	memcpy(&flags[1], window.flags.data(), (count * sizeof(flags_t)));
+	m_prevFlags = flags[count];
+	std::vector<BYTE> bytes;
+
+	// Block by block
+	for (ea_t ea = window.start; ea < window.ownedEnd;)
+	{
+		size_t block = (size_t) ((ea - m_start) / CENSUS_BLOCK);
+		ea_t blockEnd = std::min((ea_t) (m_start + ((block + 1) * CENSUS_BLOCK)), window.ownedEnd);
+		size_t first = (size_t) (ea - window.start), i = first, end = (size_t) (blockEnd - window.start);
+
+		__m128i anyData = _mm_setzero_si128(), anyUnknown = _mm_setzero_si128(), anyPadding = _mm_setzero_si128();
+		UINT64 data = 0, unknownRuns = 0, paddingRuns = 0;
+		for (; (i + 4) <= end; i += 4)
+		{
+			__m128i current  = _mm_loadu_si128((const __m128i *) &flags[i + 1]);
+			__m128i previous = _mm_loadu_si128((const __m128i *) &flags[i]);
+
+			__m128i d = isData(current), u = isUnknown(current), p = isPadding(current);
+			data        += lanes(d);
+			unknownRuns += lanes(_mm_andnot_si128(isUnknown(previous), u));
+			paddingRuns += lanes(_mm_andnot_si128(isPadding(previous), p));
+			anyData    = _mm_or_si128(anyData, d);
+			anyUnknown = _mm_or_si128(anyUnknown, u);
+			anyPadding = _mm_or_si128(anyPadding, p);
+		}
+
+		// The remainder, padded out with non matching flags
+		if (i < end)
+		{
+			alignas(16) flags_t current[4] = { 0, 0, 0, 0 }, previous[4] = { 0, 0, 0, 0 };
+			for (size_t j = 0; (i + j) < end; j++)
+			{
+				current[j]  = flags[i + j + 1];
+				previous[j] = flags[i + j];
+			}
+			__m128i c = _mm_load_si128((const __m128i *) current), pr = _mm_load_si128((const __m128i *) previous);
+			__m128i d = isData(c), u = isUnknown(c), p = isPadding(c);
+			data        += lanes(d);
+			unknownRuns += lanes(_mm_andnot_si128(isUnknown(pr), u));
+			paddingRuns += lanes(_mm_andnot_si128(isPadding(pr), p));
+			anyData    = _mm_or_si128(anyData, d);
+			anyUnknown = _mm_or_si128(anyUnknown, u);
+			anyPadding = _mm_or_si128(anyPadding, p);
+		}
+
+		// Fill bytes inside data items, the align pass takes those runs too.
+		// Only walked where a data item is, or one carries over into the block.
+		if (m_inData || lanes(anyData))
+		{
+			for (size_t j = first; j < end; j++)
+			{
+				flags_t current = flags[j + 1];
+				if (!is_tail(current))
+					m_inData = (is_data(current) && !is_align(current));
+				else
+				if (m_inData && isFillValue(current))
+				{
+					if (!isFillValue(flags[j]))
+						paddingRuns++;
+					anyPadding = _mm_set1_epi32(-1);
+				}
+			}
+		}
+
+		// No fill bytes, any multi-byte NOP heads?
+		if (!lanes(anyPadding))
+		{
+			if (bytes.empty())
+				Padding::packWindow(window, bytes);
+			for (ea_t head = ea; head < blockEnd; head++)
+			{
+				flags_t headFlags = window[head];
+				BYTE value = bytes[(size_t) (head - window.start)];
+				if ((value != 0) && Padding::isLeadByte(value) && !is_tail(headFlags) && !is_data(headFlags) && !is_code(headFlags))
+				{
+					// Either bitness, a 32 bit only form just flags the block
+					Padding::KIND kind;
+					if (Padding::match(&bytes[(size_t) (head - window.start)], (UINT) (window.end - head), FALSE, kind))
+					{
+						anyPadding = _mm_set1_epi32(-1);
+						paddingRuns++;
+						break;
+					}
+				}
+			}
+		}
+
+		m_dataItems   += data;
+		m_unknownRuns += unknownRuns;
+		m_paddingRuns += paddingRuns;
+		if (lanes(anyData))    m_blocks[block] |= CW_DATA;
+		if (lanes(anyUnknown)) m_blocks[block] |= CW_UNKNOWN;
+		if (lanes(anyPadding)) m_blocks[block] |= CW_PADDING;
+		ea = blockEnd;
+	}
+}
+
+void CensusClassifier::finish()
+{
+	// Gaps between the functions that start in the segment
+	m_funcGaps = 0;
+	// The first at or after the start, without "m_start - 1" wrapping for a segment at zero
+	ea_t last = m_start;
+	func_t *f = get_func(m_start);
+	if (!f || (f->start_ea != m_start))
+		f = get_next_func(m_start);
+	for (; f && (f->start_ea < m_end); f = get_next_func(f->start_ea))
+	{
+		if (f->start_ea > last)
+			m_funcGaps++;
+		last = std::max(last, f->end_ea);
+	}
+	if (last < m_end)
+		m_funcGaps++;
+	m_valid = TRUE;
+}
+
+BOOL CensusClassifier::hasWork(UINT work) const
+{
+	if (!m_valid)
+		return(TRUE);
+	for (std::vector<BYTE>::const_iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+	{
+		if (*it & work)
+			return(TRUE);
+	}
+	return(FALSE);
+}
+
+ea_t CensusClassifier::nextWork(ea_t ea, UINT work) const
+{
+	if (!m_valid)
+		return(ea);
+	if (ea < m_start)
+		ea = m_start;
+	for (size_t block = (size_t) ((ea - m_start) / CENSUS_BLOCK); block < m_blocks.size(); block++)
+	{
+		if (m_blocks[block] & work)
+			return(std::max(ea, (ea_t) (m_start + (block * CENSUS_BLOCK))));
+	}
+	return(m_end);
+}
+
+std::vector<range_t> CensusClassifier::workRanges(UINT work) const
+{
+	std::vector<range_t> ranges;
+	if (!m_valid)
+	{
+		ranges.push_back(range_t(m_start, m_end));
+		return(ranges);
+	}
+
+	for (size_t block = 0; block < m_blocks.size(); block++)
+	{
+		if (!(m_blocks[block] & work))
+			continue;
+
+		ea_t start = (ea_t) (m_start + (block * CENSUS_BLOCK));
+		ea_t end = std::min((ea_t) (start + CENSUS_BLOCK), m_end);
+		if (!ranges.empty() && (ranges.back().end_ea == start))
+			ranges.back().end_ea = end;
+		else
+			ranges.push_back(range_t(start, end));
+	}
+	return(ranges);
+}
@@ -0,0 +1,52 @@
+// Segment census, a quick SIMD count of what the steps have to work on, taken before they start.
+// Kept per block so the steps can skip the blocks with nothing for them, or be skipped altogether.
+#pragma once
+#include <vector>
+#include "SegStream.h"
+
+// Census block size, the skip granularity
+#define CENSUS_BLOCK (64 * 1024)
+
+// Block work bits
+enum CENSUSWORK
+{
+	CW_DATA    = 0x01,	// Data items, not aligns; eSTATE_PASS_1
+	CW_PADDING = 0x02,	// Padding heads or data item fill bytes, not align items; eSTATE_PASS_2
+	CW_UNKNOWN = 0x04,	// Unknown bytes; eSTATE_PASS_3
+};
+
+class CensusClassifier : public WindowClassifier
+{
+public:
+	CensusClassifier();
+
+	void reset(ea_t start, ea_t end);
+	void classify(const FLAGWINDOW &window);
+	void apply() {}
+
+	// After the stream; counts the function gaps, which needs the SDK
+	void finish();
+
+	UINT64 dataItems() const { return(m_dataItems); }
+	UINT64 unknownRuns() const { return(m_unknownRuns); }
+	UINT64 paddingRuns() const { return(m_paddingRuns); }
+	UINT64 funcGaps() const { return(m_funcGaps); }
+	BOOL valid() const { return(m_valid); }
+
+	// TRUE if any block has any of the work bits; always without a census
+	BOOL hasWork(UINT work) const;
+
+	// Start of the first block at or after "ea" with any of the work bits, else the segment end
+	ea_t nextWork(ea_t ea, UINT work) const;
+
+	// The merged block ranges with any of the work bits; the whole segment without a census
+	std::vector<range_t> workRanges(UINT work) const;
+
+private:
+	ea_t m_start, m_end;
+	std::vector<BYTE> m_blocks;
+	UINT64 m_dataItems, m_unknownRuns, m_paddingRuns, m_funcGaps;
+	flags_t m_prevFlags;
+	BOOL m_inData;		// Last head seen is a data item, not an align
+	BOOL m_valid;
+};
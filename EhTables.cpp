@@ -0,0 +1,284 @@
+// C++ EH and SEH table funclet finder
+#include "stdafx.h"
+#include <set>
+#include "EhTables.h"
+#include "Profiler.h"
+
+// Sanity limits for table counts
+#define EH_MAX_STATES  4096
+#define EH_MAX_TRIES   1024
+#define EH_MAX_CATCHES 256
+#define EH_MAX_SCOPES  256
+
+namespace EhTables
+{
+	// Handler data layout, by the handler that owns it
+	enum TABLEKIND
+	{
+		FUNCINFO,	// C++ "FuncInfo", __CxxFrameHandler*()
+		SCOPE64,	// x64 SEH scope table, __C_specific_handler()
+		SCOPE3,		// x86 SEH scope table, _except_handler3()
+		SCOPE4,		// x86 SEH scope table with cookie header, _except_handler4() and _SEH_prolog4()
+	};
+
+	struct HANDLERNAME
+	{
+		const char *name;	// Without the leading underscores
+		TABLEKIND kind;
+	};
+
+	static const HANDLERNAME s_handlers[] =
+	{
+		{ "CxxFrameHandler",     FUNCINFO },
+		{ "CxxFrameHandler2",    FUNCINFO },
+		{ "CxxFrameHandler3",    FUNCINFO },
+		{ "GSHandlerCheck_EH",   FUNCINFO },
+		{ "C_specific_handler",  SCOPE64 },
+		{ "except_handler3",     SCOPE3 },
+		{ "except_handler4",     SCOPE4 },
+		{ "SEH_prolog4",         SCOPE4 },
+		{ "SEH_prolog4_GS",      SCOPE4 },
+	};
+
+	static BOOL s_is64 = FALSE;
+	static ea_t s_imageBase = 0;
+
+	// collect() progress: the handlers, their imports and thunks, and the references of the current one
+	static std::vector<std::pair<ea_t, TABLEKIND> > s_handlerEas;
+	static size_t s_handler = 0;
+	static std::vector<ea_t> s_refs;
+	static size_t s_ref = 0;
+	static std::set<ea_t> s_tables, s_seen;
+
+	// Table pointers are absolute in x86, image relative in x64
+	static ea_t tablePointer(ea_t ea)
+	{
+		UINT32 value = get_dword(ea);
+		if (!value)
+			return(BADADDR);
+		ea_t target = (s_is64 ? (s_imageBase + value) : (ea_t) value);
+		return(is_mapped(target) ? target : BADADDR);
+	}
+
+	// Code target in an executable segment
+	static BOOL isCodeTarget(ea_t ea)
+	{
+		segment_t *seg = getseg(ea);
+		return(seg && ((seg->perm & SEGPERM_EXEC) || (seg->type == SEG_CODE)) && !is_data(get_flags(ea)));
+	}
+
+	static void addSeed(FUNCLIST &seeds, ea_t ea)
+	{
+		if ((ea != BADADDR) && isCodeTarget(ea) && !get_fchunk(ea))
+		{
+			FUNCNODE seed = { ea, 0 };
+			seeds.push_back(seed);
+		}
+	}
+
+	// Known handler kind of a name, skipping import and thunk prefixes
+	static BOOL handlerKind(const char *name, TABLEKIND &kind)
+	{
+		if (strncmp(name, "__imp_", 6) == 0)
+			name += 6;
+		else
+		if (strncmp(name, "j_", 2) == 0)
+			name += 2;
+		while (*name == '_')
+			name++;
+
+		for (size_t i = 0; i < qnumber(s_handlers); i++)
+		{
+			if (strcmp(name, s_handlers[i].name) == 0)
+			{
+				kind = s_handlers[i].kind;
+				return(TRUE);
+			}
+		}
+		return(FALSE);
+	}
+
+	// C++ "FuncInfo"; the leading fields and the entries the funclets are in line up for x86 and x64,
+	// but for the pointer size and a trailing "dispFrame" field in x64 handler entries.
+	static BOOL walkFuncInfo(ea_t funcInfo, FUNCLIST &seeds)
+	{
+		UINT32 magic = (get_dword(funcInfo) & 0x1FFFFFFF);
+		if ((magic < 0x19930520) || (magic > 0x19930522))
+			return(FALSE);
+
+		UINT32 maxState = get_dword(funcInfo + 4), tryBlocks = get_dword(funcInfo + 12);
+		if ((maxState > EH_MAX_STATES) || (tryBlocks > EH_MAX_TRIES))
+			return(FALSE);
+
+		// Unwind map, { toState, action }
+		ea_t unwindMap = tablePointer(funcInfo + 8);
+		if (maxState && (unwindMap != BADADDR))
+		{
+			for (UINT32 i = 0; i < maxState; i++)
+				addSeed(seeds, tablePointer(unwindMap + (i * 8) + 4));
+		}
+
+		// Try block map, { tryLow, tryHigh, catchHigh, nCatches, handlers }
+		ea_t tryMap = tablePointer(funcInfo + 16);
+		if (tryBlocks && (tryMap != BADADDR))
+		{
+			const UINT handlerSize = (s_is64 ? 20 : 16);
+			for (UINT32 i = 0; i < tryBlocks; i++)
+			{
+				ea_t tryBlock = (tryMap + (i * 20));
+				UINT32 catches = get_dword(tryBlock + 12);
+				ea_t handlers = tablePointer(tryBlock + 16);
+				if ((catches > EH_MAX_CATCHES) || (handlers == BADADDR))
+					continue;
+
+				// { adjectives, type, dispCatchObj, addressOfHandler [, dispFrame] }
+				for (UINT32 j = 0; j < catches; j++)
+					addSeed(seeds, tablePointer(handlers + (j * handlerSize) + 12));
+			}
+		}
+		return(TRUE);
+	}
+
+	// x64 scope table, count then { begin, end, handler, target }; the handler is a filter or
+	// "__finally" funclet, or 1 for "EXCEPTION_EXECUTE_HANDLER".
+	static BOOL walkScope64(ea_t table, FUNCLIST &seeds)
+	{
+		UINT32 count = get_dword(table);
+		if (!count || (count > EH_MAX_SCOPES))
+			return(FALSE);
+
+		for (UINT32 i = 0; i < count; i++)
+		{
+			ea_t entry = (table + 4 + (i * 16));
+			if (get_dword(entry + 8) > 1)
+				addSeed(seeds, tablePointer(entry + 8));
+		}
+		return(TRUE);
+	}
+
+	// x86 scope table, { enclosingLevel, filter, handler } entries chained by their enclosing level;
+	// the filters are funclets, the "__except" blocks belong to the function.
+	static BOOL walkScope86(ea_t table, BOOL cookieHeader, FUNCLIST &seeds)
+	{
+		if (cookieHeader)
+			table += 16;
+
+		UINT32 i = 0;
+		for (; i < EH_MAX_SCOPES; i++)
+		{
+			ea_t entry = (table + (i * 12));
+			INT32 enclosing = (INT32) get_dword(entry);
+			if (((enclosing >= 0) && ((UINT32) enclosing >= i)) || (enclosing < -2))
+				break;
+			ea_t handler = tablePointer(entry + 8);
+			if ((handler == BADADDR) || !isCodeTarget(handler))
+				break;
+
+			addSeed(seeds, tablePointer(entry + 4));
+		}
+		return(i > 0);
+	}
+
+	// Handler data of a reference to a frame handler, BADADDR if none.
+	// x64 references are from unwind info, the handler data follows the handler's RVA.
+	// x86 references are from code, the table is the immediate of the instruction before,
+	// "mov eax, offset FuncInfo" in __ehhandler stubs, "push offset ScopeTable" in SEH prologs.
+	static ea_t handlerData(ea_t from, TABLEKIND kind)
+	{
+		if (!is_code(get_flags(from)))
+		{
+			if (!s_is64)
+				return(BADADDR);
+			return((kind == FUNCINFO) ? tablePointer(from + 4) : (from + 4));
+		}
+
+		insn_t cmd;
+		if (decode_prev_insn(&cmd, from) == BADADDR)
+			return(BADADDR);
+		if (((cmd.itype == NN_mov) && (kind == FUNCINFO)) || ((cmd.itype == NN_push) && (kind != FUNCINFO)))
+		{
+			const op_t &op = ((cmd.itype == NN_mov) ? cmd.ops[1] : cmd.ops[0]);
+			if ((op.type == o_imm) && is_mapped((ea_t) op.value))
+				return((ea_t) op.value);
+		}
+		return(BADADDR);
+	}
+
+	void begin()
+	{
+		PROFILE_SCOPE("EhTables::begin");
+		s_is64 = inf.is_64bit();
+		s_imageBase = get_imagebase();
+
+		s_handlerEas.clear();
+		s_refs.clear();
+		s_tables.clear();
+		s_seen.clear();
+		s_handler = s_ref = 0;
+		for (size_t i = 0; i < get_nlist_size(); i++)
+		{
+			TABLEKIND kind;
+			if (handlerKind(get_nlist_name(i), kind))
+				s_handlerEas.push_back(std::make_pair(get_nlist_ea(i), kind));
+		}
+	}
+
+	BOOL collect(FUNCLIST &seeds, TIMESTAMP until)
+	{
+		PROFILE_SCOPE("EhTables::collect");
+		for (BOOL worked = FALSE; ; worked = TRUE)
+		{
+			if (worked && (getTimeStamp() >= until))
+				return(TRUE);
+
+			// Next handler's references
+			if (s_ref >= s_refs.size())
+			{
+				s_refs.clear();
+				s_ref = 0;
+				for (; s_handler < s_handlerEas.size(); s_handler++)
+				{
+					if (s_seen.insert(s_handlerEas[s_handler].first).second)
+						break;
+				}
+				if (s_handler >= s_handlerEas.size())
+					return(FALSE);
+
+				xrefblk_t xb;
+				for (bool ok = xb.first_to(s_handlerEas[s_handler].first, XREF_ALL); ok; ok = xb.next_to())
+					s_refs.push_back(xb.from);
+				s_handler++;
+				continue;
+			}
+
+			TABLEKIND kind = s_handlerEas[s_handler - 1].second;
+			ea_t from = s_refs[s_ref++];
+			ea_t data = handlerData(from, kind);
+			if (data != BADADDR)
+			{
+				if (s_tables.find(data) != s_tables.end())
+					continue;
+
+				BOOL walked = FALSE;
+				switch (kind)
+				{
+					case FUNCINFO: walked = walkFuncInfo(data, seeds); break;
+					case SCOPE64:  walked = walkScope64(data, seeds); break;
+					case SCOPE3:   walked = walkScope86(data, FALSE, seeds); break;
+					case SCOPE4:   walked = walkScope86(data, TRUE, seeds); break;
+				};
+				if (walked)
+					s_tables.insert(data);
+			}
+			else
+			// A thunk to the handler, follow its references too
+			if (func_t *f = get_fchunk(from))
+			{
+				if ((f->flags & FUNC_THUNK) && (f->start_ea == from))
+					s_handlerEas.push_back(std::make_pair(f->start_ea, kind));
+			}
+		}
+	}
+
+	UINT tables() { return((UINT) s_tables.size()); }
+};
@@ -0,0 +1,17 @@
+// C++ EH and SEH table funclet finder.
+// MSVC catch blocks, unwind actions and SEH filters are only reached through the exception tables
+// of their frame handlers, so gap walking tends to miss them.
+#pragma once
+#include "FuncSeed.h"
+
+namespace EhTables
+{
+	// Walk the tables from the references to the frame handlers, adding every handler, unwind
+	// action and filter not yet in a function to "seeds". begin() finds the handlers, then
+	// collect() walks until "until" per call, returning TRUE while there are more references.
+	void begin();
+	BOOL collect(FUNCLIST &seeds, TIMESTAMP until);
+
+	// Count of tables walked
+	UINT tables();
+};
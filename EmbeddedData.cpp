@@ -0,0 +1,263 @@
+// Embedded data in code recognizer
+#include "stdafx.h"
+#include <map>
+#include <algorithm>
+#include "EmbeddedData.h"
+#include "ItypeClass.h"
+#include "Profiler.h"
+
+namespace EmbeddedData
+{
+	// Pinned ranges, start to end; kept with the IDB as "P" tag alt values
+	typedef std::map<ea_t, ea_t> PINMAP;
+	static PINMAP s_pins;
+	static BOOL s_hooked = FALSE;
+	static BOOL s_ownEdits = FALSE;		// The plugin's own, see ownEdits()
+
+	// Pin a range, merging it with any it overlaps
+	static void pin(ea_t start, ea_t end)
+	{
+		if (end <= start)
+			return;
+
+		netnode node(NETNODE_NAME, 0, true);
+		PINMAP::iterator it = s_pins.upper_bound(start);
+		if (it != s_pins.begin())
+		{
+			PINMAP::iterator prev = it; --prev;
+			if (prev->second >= start)
+				it = prev;
+		}
+		while ((it != s_pins.end()) && (it->first <= end))
+		{
+			start = std::min(start, it->first);
+			end = std::max(end, it->second);
+			node.altdel(it->first, 'P');
+			it = s_pins.erase(it);
+		}
+
+		s_pins[start] = end;
+		node.altset(start, end, 'P');
+	}
+
+	// Drop the pins the range overlaps, the analyst or the auto-analyzer redefined them
+	static void unpin(ea_t start, ea_t end)
+	{
+		if (s_pins.empty() || s_ownEdits)
+			return;
+
+		PINMAP::iterator it = s_pins.upper_bound(start);
+		if (it != s_pins.begin())
+		{
+			PINMAP::iterator prev = it; --prev;
+			if (prev->second > start)
+				it = prev;
+		}
+		if ((it == s_pins.end()) || (it->first >= end))
+			return;
+
+		netnode node(NETNODE_NAME);
+		while ((it != s_pins.end()) && (it->first < end))
+		{
+			if (node != BADNODE)
+				node.altdel(it->first, 'P');
+			it = s_pins.erase(it);
+		}
+	}
+
+	// Code made in a pin, or its items destroyed
+	static ssize_t idaapi idbEvent(void *ud, int code, va_list va)
+	{
+		switch (code)
+		{
+			case idb_event::destroyed_items:
+			{
+				ea_t ea1 = va_arg(va, ea_t);
+				ea_t ea2 = va_arg(va, ea_t);
+				unpin(ea1, ea2);
+			}
+			break;
+
+			case idb_event::make_code:
+			{
+				const insn_t *insn = va_arg(va, const insn_t *);
+				unpin(insn->ea, (insn->ea + insn->size));
+			}
+			break;
+
+			case idb_event::closebase:
+			clear();
+			break;
+		};
+		return(0);
+	}
+
+	// A pin made code since it was saved, it's data or unknown bytes no more
+	static BOOL hasCode(ea_t start, ea_t end)
+	{
+		for (ea_t ea = start; (ea != BADADDR) && (ea < end); ea = next_head(ea, end))
+		{
+			if (is_code(get_flags(ea)))
+				return(TRUE);
+		}
+		return(FALSE);
+	}
+
+	// Returns TRUE and the table range if "ea" is in one of a switch's tables
+	static BOOL inSwitchTable(const switch_info_t &si, ea_t ea, range_t &table)
+	{
+		int count = ((si.flags & SWI_INDIRECT) ? si.jcases : si.ncases);
+		table = range_t(si.jumps, (si.jumps + (count * si.get_jtable_element_size())));
+		if (table.contains(ea))
+			return(TRUE);
+
+		// Value table, for indirect (index) and sparse switches
+		if (si.flags & (SWI_INDIRECT | SWI_SPARSE))
+		{
+			table = range_t(si.values, (si.values + (si.ncases * si.get_vtable_element_size())));
+			if (table.contains(ea))
+				return(TRUE);
+		}
+		return(FALSE);
+	}
+
+	// Classify how an instruction reads the data at "ea"
+	static TYPE classifyAccess(const insn_t &cmd, ea_t ea)
+	{
+		for (int i = 0; i < UA_MAXOP; i++)
+		{
+			const op_t &op = cmd.ops[i];
+			if (op.type == o_void)
+				break;
+			if (((op.type != o_mem) && (op.type != o_displ)) || (op.addr != ea))
+				continue;
+
+			// Byte load to a register, "movzx" style
+			BYTE itypeClasses = itypeClass(cmd.itype);
+			if ((itypeClasses & IC_BYTELOAD) && (cmd.ops[0].type == o_reg) && (op.dtype == dt_byte))
+				return(INDEX_TABLE);
+
+			// Indirect jump through a table IDA didn't make a switch of
+			if (itypeClasses & IC_INDIRECT)
+				return(SWITCH_TABLE);
+
+			// Floating point and vector constants
+			switch (op.dtype)
+			{
+				case dt_float:
+				case dt_double:
+				case dt_tbyte:
+				case dt_packreal:
+				case dt_byte16:
+				return(CONSTANT);
+			};
+		}
+		return(NONE);
+	}
+
+	void load()
+	{
+		// Follow the edits that redefine pins
+		if (!s_hooked)
+			s_hooked = hook_to_notification_point(HT_IDB, idbEvent, NULL);
+
+		s_pins.clear();
+		netnode node(NETNODE_NAME);
+		if (node == BADNODE)
+			return;
+
+		for (nodeidx_t alt = node.altfirst('P'); alt != BADNODE; alt = node.altnext(alt, 'P'))
+			s_pins[(ea_t) alt] = (ea_t) node.altval(alt, 'P');
+
+		// Drop the ones redefined between runs
+		for (PINMAP::iterator it = s_pins.begin(); it != s_pins.end();)
+		{
+			if (hasCode(it->first, it->second))
+			{
+				node.altdel(it->first, 'P');
+				it = s_pins.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	void clear()
+	{
+		s_pins.clear();
+		if (s_hooked)
+		{
+			unhook_from_notification_point(HT_IDB, idbEvent, NULL);
+			s_hooked = FALSE;
+		}
+	}
+
+	TYPE recognize(ea_t start, ea_t end)
+	{
+		PROFILE_SCOPE("recognizeData");
+		TYPE type = NONE;
+		xrefblk_t xb;
+		for (bool ok = xb.first_to(start, XREF_DATA); ok && (type == NONE); ok = xb.next_to())
+		{
+			if (!is_code(get_flags(xb.from)))
+				continue;
+
+			// Referenced by a switch jump, pin its whole table
+			switch_info_t si;
+			if (get_switch_info(&si, xb.from) > 0)
+			{
+				range_t table;
+				if (inSwitchTable(si, start, table))
+				{
+					pin(table.start_ea, std::max(table.end_ea, end));
+					type = SWITCH_TABLE;
+				}
+				continue;
+			}
+
+			insn_t cmd;
+			if (decode_insn(&cmd, xb.from) > 0)
+			{
+				if ((type = classifyAccess(cmd, start)) != NONE)
+					pin(start, end);
+			}
+		}
+		return(type);
+	}
+
+	void ownEdits(BOOL own)
+	{
+		s_ownEdits = own;
+	}
+
+	BOOL isPinned(ea_t ea, range_t *pin)
+	{
+		PINMAP::const_iterator it = s_pins.upper_bound(ea);
+		if (it == s_pins.begin())
+			return(FALSE);
+		--it;
+		if (ea >= it->second)
+			return(FALSE);
+
+		if (pin)
+			*pin = range_t(it->first, it->second);
+		return(TRUE);
+	}
+
+	BOOL nextPin(ea_t ea, range_t &pin)
+	{
+		if (isPinned(ea, &pin))
+			return(TRUE);
+
+		PINMAP::const_iterator it = s_pins.upper_bound(ea);
+		if (it == s_pins.end())
+			return(FALSE);
+		pin = range_t(it->first, it->second);
+		return(TRUE);
+	}
+
+	size_t count()
+	{
+		return(s_pins.size());
+	}
+};
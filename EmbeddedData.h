@@ -0,0 +1,34 @@
+// Embedded data in code recognizer
+// Classifies data items in code segments once and pins the confirmed ones with the IDB, so the
+// unknown data pass doesn't undo them and the missing code pass doesn't try to make code of them.
+// A pin is dropped once its range is redefined: code made or items destroyed in it, or found with code on load.
+#pragma once
+
+namespace EmbeddedData
+{
+	enum TYPE
+	{
+		NONE,
+		SWITCH_TABLE,	// Jump or value (index) table of a switch
+		INDEX_TABLE,	// Byte table read by "movzx", etc.
+		CONSTANT,		// Floating point or vector constant
+	};
+
+	// Load the pins and follow the IDB edits to them, until clear()
+	void load();
+	void clear();
+
+	// Classify the data item at "start" to "end", pinning it if recognized
+	TYPE recognize(ea_t start, ea_t end);
+
+	// Brackets the plugin's own edits of a recognized range, so they don't drop its pin
+	void ownEdits(BOOL own);
+
+	// Returns TRUE and the pinned range if "ea" is inside one
+	BOOL isPinned(ea_t ea, range_t *pin = NULL);
+
+	// First pinned range that ends after "ea", returns FALSE if none
+	BOOL nextPin(ea_t ea, range_t &pin);
+
+	size_t count();
+};
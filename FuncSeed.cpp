@@ -0,0 +1,47 @@
+// Function seeding from collected evidence, created in sorted batches
+#include "stdafx.h"
+#include <algorithm>
+#include "FuncSeed.h"
+#include "NoReturn.h"
+#include "Profiler.h"
+
+namespace FuncSeed
+{
+	static bool sameAddress(const FUNCNODE &a, const FUNCNODE &b) { return(a.address == b.address); }
+
+	void prepare(FUNCLIST &seeds)
+	{
+		std::sort(seeds.begin(), seeds.end());
+		seeds.erase(std::unique(seeds.begin(), seeds.end(), sameAddress), seeds.end());
+	}
+
+	BOOL createBatch(const FUNCLIST &seeds, size_t &next, UINT &created)
+	{
+		PROFILE_SCOPE("FuncSeed::createBatch");
+		if (next >= seeds.size())
+			return(FALSE);
+
+		// Let the auto-analyzer catch up once per batch rather than per function
+		std::vector<ea_t> made;
+		size_t end = std::min((next + SEED_BATCH), seeds.size());
+		for (; next < end; next++)
+		{
+			// Could be part of one made earlier
+			const FUNCNODE &seed = seeds[next];
+			if (get_fchunk(seed.address))
+				continue;
+
+			if (PROFILE_CALL("add_func", add_func(seed.address, (seed.size ? (seed.address + seed.size) : BADADDR))))
+			{
+				made.push_back(seed.address);
+				created++;
+			}
+		}
+		PROFILE_CALL("auto_wait", auto_wait());
+
+		// Check the new ones for no-return once they're analyzed
+		for (std::vector<ea_t>::iterator it = made.begin(); it != made.end(); ++it)
+			NoReturn::added(*it);
+		return(next < seeds.size());
+	}
+};
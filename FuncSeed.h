@@ -0,0 +1,26 @@
+// Function seeding from collected evidence, created in sorted batches
+#pragma once
+#include <vector>
+
+// add_func() calls between auto-analysis waits
+#define SEED_BATCH 256
+
+// Function info container
+struct FUNCNODE
+{
+	ea_t address;
+	UINT size;	// Zero to let IDA find the end
+
+	bool operator<(const FUNCNODE &rhs) const { return(address < rhs.address); }
+};
+
+typedef std::vector<FUNCNODE> FUNCLIST;
+
+namespace FuncSeed
+{
+	// Create functions from the list a batch at a time: prepare() sorts and deduplicates it, then
+	// createBatch() from "next" = 0 on, adding to "created", until it returns FALSE.
+	// Seeds already inside a function are skipped.
+	void prepare(FUNCLIST &seeds);
+	BOOL createBatch(const FUNCLIST &seeds, size_t &next, UINT &created);
+};
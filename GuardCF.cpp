@@ -0,0 +1,107 @@
+// Control Flow Guard function table reader
+#include "stdafx.h"
+#include "GuardCF.h"
+#include "Profiler.h"
+
+// Load config directory fields, x86 and x64 offsets
+#define LC_SIZE            0
+#define LC_GUARD_TABLE_32  0x50
+#define LC_GUARD_COUNT_32  0x54
+#define LC_GUARD_FLAGS_32  0x58
+#define LC_GUARD_TABLE_64  0x80
+#define LC_GUARD_COUNT_64  0x88
+#define LC_GUARD_FLAGS_64  0x90
+
+#define GUARD_CF_FUNCTION_TABLE_PRESENT 0x00000400
+#define GUARD_CF_ENTRY_EXTRA_MASK       0xF0000000	// Extra bytes after each entry's RVA
+#define GUARD_CF_ENTRY_EXTRA_SHIFT      28
+
+// Sanity limit for the table size
+#define GUARD_MAX_ENTRIES (16 * 1024 * 1024)
+
+namespace GuardCF
+{
+	static ea_t s_table = BADADDR, s_imageBase = 0;
+	static UINT64 s_count = 0, s_next = 0;
+	static UINT s_stride = 4;
+
+	// The load config directory from the PE header the loader keeps with the IDB, else its symbol
+	static ea_t findLoadConfig(BOOL is64)
+	{
+		netnode penode("$ PE header");
+		if (penode != BADNODE)
+		{
+			// On disk layout: signature, file header, optional header with the data directories last
+			BYTE header[0x200];
+			ssize_t size = penode.valobj(header, sizeof(header));
+			const UINT directories = (24 + (is64 ? 112 : 96));
+			const UINT loadConfig = (directories + (10 * 8));
+			if ((size >= (ssize_t) (loadConfig + 8)) && (*((UINT32 *) header) == 0x4550))
+			{
+				UINT32 rva = *((UINT32 *) (header + loadConfig));
+				if (rva && is_mapped(get_imagebase() + rva))
+					return(get_imagebase() + rva);
+			}
+		}
+
+		static const char *names[] = { "_load_config_used", "__load_config_used" };
+		for (size_t i = 0; i < qnumber(names); i++)
+		{
+			ea_t ea = get_name_ea(BADADDR, names[i]);
+			if (ea != BADADDR)
+				return(ea);
+		}
+		return(BADADDR);
+	}
+
+	UINT begin()
+	{
+		PROFILE_SCOPE("GuardCF::begin");
+		s_count = s_next = 0;
+		BOOL is64 = inf.is_64bit();
+		ea_t loadConfig = findLoadConfig(is64);
+		if (loadConfig == BADADDR)
+			return(0);
+
+		// Old load configs end before the guard fields
+		UINT32 size = get_dword(loadConfig + LC_SIZE);
+		if (size < (UINT32) (is64 ? (LC_GUARD_FLAGS_64 + 4) : (LC_GUARD_FLAGS_32 + 4)))
+			return(0);
+
+		ea_t table   = (is64 ? (ea_t) get_qword(loadConfig + LC_GUARD_TABLE_64) : (ea_t) get_dword(loadConfig + LC_GUARD_TABLE_32));
+		UINT64 count = (is64 ? get_qword(loadConfig + LC_GUARD_COUNT_64) : get_dword(loadConfig + LC_GUARD_COUNT_32));
+		UINT32 flags = get_dword(loadConfig + (is64 ? LC_GUARD_FLAGS_64 : LC_GUARD_FLAGS_32));
+		if (!(flags & GUARD_CF_FUNCTION_TABLE_PRESENT) || !count || (count > GUARD_MAX_ENTRIES) || !is_mapped(table))
+			return(0);
+
+		s_table = table;
+		s_count = count;
+		s_stride = (4 + ((flags & GUARD_CF_ENTRY_EXTRA_MASK) >> GUARD_CF_ENTRY_EXTRA_SHIFT));
+		s_imageBase = get_imagebase();
+		return((UINT) count);
+	}
+
+	BOOL collect(FUNCLIST &seeds, TIMESTAMP until)
+	{
+		PROFILE_SCOPE("GuardCF::collect");
+		for (UINT i = 0; s_next < s_count; s_next++, i++)
+		{
+			// Clock checked every 256
+			if (i && !(i & 0xFF) && (getTimeStamp() >= until))
+				return(TRUE);
+
+			ea_t ea = (s_imageBase + get_dword(s_table + (ea_t) (s_next * s_stride)));
+			segment_t *seg = getseg(ea);
+			if (!seg || !((seg->perm & SEGPERM_EXEC) || (seg->type == SEG_CODE)))
+				continue;
+
+			flags_t eaFlags = get_flags(ea);
+			if (is_tail(eaFlags) || is_data(eaFlags) || is_func(eaFlags))
+				continue;
+
+			FUNCNODE seed = { ea, 0 };
+			seeds.push_back(seed);
+		}
+		return(FALSE);
+	}
+};
@@ -0,0 +1,15 @@
+// Control Flow Guard function table reader.
+// Images built with "/guard:cf" list every address taken function in the load config's
+// "GuardCFFunctionTable", sorted by address.
+#pragma once
+#include "FuncSeed.h"
+
+namespace GuardCF
+{
+	// Find the table, returns its entry count, zero if the image has none
+	UINT begin();
+
+	// Add the table's functions in executable segments to "seeds", until "until" per call.
+	// Returns TRUE while there are more entries.
+	BOOL collect(FUNCLIST &seeds, TIMESTAMP until);
+};
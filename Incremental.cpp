@@ -0,0 +1,300 @@
+// Background incremental mode
+#include "stdafx.h"
+#include <algorithm>
+#include "Incremental.h"
+
+// UI timer period, ms
+#define INCREMENTAL_TICK_MS 200
+
+// Quiet time after the last edit before the dirty ranges are worked, seconds
+#define INCREMENTAL_SETTLE 1.0
+
+// Most a dirty range is grown by on either side, to take in the function chunk or gap it's in
+#define INCREMENTAL_REACH (64 * 1024)
+
+namespace Incremental
+{
+	static BOOL s_active = FALSE;
+	static BOOL s_working = FALSE;		// In the work callback, its own edits aren't dirt
+	static BOOL s_settling = FALSE;		// Nor the analysis it queued, until the auto-analyzer is done with it
+	static BOOL s_haveRange = FALSE, s_first = FALSE;
+	static range_t s_range;
+	static rangeset_t s_dirty;
+	static std::vector<range_t> s_segments;
+	static RANGEWORK s_work = NULL;
+	static RANGEDROP s_drop = NULL;
+	static qtimer_t s_timer = NULL;
+	static TIMESTAMP s_lastEdit = 0;
+
+	// Add the parts of an edited range in the watched segments
+	static void dirty(ea_t start, ea_t end)
+	{
+		if (s_working || s_settling || (end <= start))
+			return;
+
+		for (std::vector<range_t>::iterator it = s_segments.begin(); it != s_segments.end(); ++it)
+		{
+			ea_t from = std::max(start, it->start_ea);
+			ea_t to   = std::min(end, it->end_ea);
+			if (to > from)
+			{
+				s_dirty.add(range_t(from, to));
+				s_lastEdit = getTimeStamp();
+			}
+		}
+	}
+
+	// Stop watching the segments starting in "start" - "end", returns TRUE if any were
+	static BOOL unwatch(ea_t start, ea_t end)
+	{
+		BOOL watched = FALSE;
+		for (std::vector<range_t>::iterator it = s_segments.begin(); it != s_segments.end();)
+		{
+			if ((it->start_ea >= start) && (it->start_ea < end))
+			{
+				s_dirty.sub(*it);
+				it = s_segments.erase(it);
+				watched = TRUE;
+			}
+			else
+				++it;
+		}
+		s_dirty.sub(range_t(start, end));
+		return(watched);
+	}
+
+	// A watched segment's bounds changed from "oldStart" - "oldEnd", work what it gained
+	static void resized(const segment_t *seg, ea_t oldStart, ea_t oldEnd)
+	{
+		for (std::vector<range_t>::iterator it = s_segments.begin(); it != s_segments.end(); ++it)
+		{
+			if ((it->start_ea == oldStart) && (it->end_ea == oldEnd))
+			{
+				*it = range_t(seg->start_ea, seg->end_ea);
+				if (seg->start_ea < oldStart)
+					dirty(seg->start_ea, oldStart);
+				else
+				if (seg->start_ea > oldStart)
+					s_dirty.sub(range_t(oldStart, seg->start_ea));
+
+				if (seg->end_ea > oldEnd)
+					dirty(oldEnd, seg->end_ea);
+				else
+				if (seg->end_ea < oldEnd)
+					s_dirty.sub(range_t(seg->end_ea, oldEnd));
+				break;
+			}
+		}
+	}
+
+	static ssize_t idaapi idbEvent(void *ud, int code, va_list va)
+	{
+		switch (code)
+		{
+			case idb_event::destroyed_items:
+			{
+				ea_t ea1 = va_arg(va, ea_t);
+				ea_t ea2 = va_arg(va, ea_t);
+				dirty(ea1, ea2);
+			}
+			break;
+
+			case idb_event::make_code:
+			{
+				const insn_t *insn = va_arg(va, const insn_t *);
+				dirty(insn->ea, (insn->ea + insn->size));
+			}
+			break;
+
+			case idb_event::make_data:
+			{
+				ea_t ea = va_arg(va, ea_t);
+				va_arg(va, flags_t);
+				va_arg(va, tid_t);
+				asize_t len = va_arg(va, asize_t);
+				dirty(ea, (ea + len));
+			}
+			break;
+
+			case idb_event::func_added:
+			case idb_event::deleting_func:
+			{
+				func_t *pfn = va_arg(va, func_t *);
+				dirty(pfn->start_ea, pfn->end_ea);
+			}
+			break;
+
+			case idb_event::deleting_func_tail:
+			{
+				va_arg(va, func_t *);
+				const range_t *tail = va_arg(va, const range_t *);
+				dirty(tail->start_ea, tail->end_ea);
+			}
+			break;
+
+			// New code segments are watched, and worked whole
+			case idb_event::segm_added:
+			{
+				segment_t *seg = va_arg(va, segment_t *);
+				if (seg->type == SEG_CODE)
+				{
+					s_segments.push_back(range_t(seg->start_ea, seg->end_ea));
+					dirty(seg->start_ea, seg->end_ea);
+				}
+			}
+			break;
+
+			case idb_event::segm_deleted:
+			{
+				ea_t start = va_arg(va, ea_t);
+				ea_t end = va_arg(va, ea_t);
+				unwatch(start, end);
+			}
+			break;
+
+			case idb_event::segm_start_changed:
+			{
+				segment_t *seg = va_arg(va, segment_t *);
+				ea_t oldStart = va_arg(va, ea_t);
+				resized(seg, oldStart, seg->end_ea);
+			}
+			break;
+
+			case idb_event::segm_end_changed:
+			{
+				segment_t *seg = va_arg(va, segment_t *);
+				ea_t oldEnd = va_arg(va, ea_t);
+				resized(seg, seg->start_ea, oldEnd);
+			}
+			break;
+
+			case idb_event::segm_moved:
+			{
+				ea_t from = va_arg(va, ea_t);
+				ea_t to = va_arg(va, ea_t);
+				asize_t size = va_arg(va, asize_t);
+				if (unwatch(from, (from + size)))
+				{
+					s_segments.push_back(range_t(to, (to + size)));
+					dirty(to, (to + size));
+				}
+			}
+			break;
+
+			case idb_event::closebase:
+			stop();
+			break;
+		};
+		return(0);
+	}
+
+	// Take the first dirty range, grown out to the function chunk or gap around each end, in one segment
+	static void take(range_t &range)
+	{
+		range = s_dirty.getrange(0);
+		range_t seg = range;
+		for (std::vector<range_t>::iterator it = s_segments.begin(); it != s_segments.end(); ++it)
+		{
+			if (it->contains(range.start_ea))
+			{
+				seg = *it;
+				break;
+			}
+		}
+		range.end_ea = std::min(range.end_ea, seg.end_ea);
+
+		ea_t start, end;
+		if (func_t *chunk = get_fchunk(range.start_ea))
+			start = chunk->start_ea;
+		else
+		if (func_t *prev = get_prev_fchunk(range.start_ea))
+			start = prev->end_ea;
+		else
+			start = seg.start_ea;
+
+		if (func_t *chunk = get_fchunk(range.end_ea - 1))
+			end = chunk->end_ea;
+		else
+		if (func_t *next = get_next_fchunk(range.end_ea - 1))
+			end = next->start_ea;
+		else
+			end = seg.end_ea;
+
+		ea_t lowest  = (((range.start_ea - seg.start_ea) > INCREMENTAL_REACH) ? (range.start_ea - INCREMENTAL_REACH) : seg.start_ea);
+		ea_t highest = (((seg.end_ea - range.end_ea) > INCREMENTAL_REACH) ? (range.end_ea + INCREMENTAL_REACH) : seg.end_ea);
+		range.start_ea = std::min(range.start_ea, std::max(start, lowest));
+		range.end_ea   = std::max(range.end_ea, std::min(end, highest));
+		s_dirty.sub(range);
+	}
+
+	// Work a time slice of the next dirty range, once the auto-analyzer is idle and the edits have settled
+	static int idaapi tick(void *ud)
+	{
+		if (!s_active)
+			return(-1);
+		if (s_working || !auto_is_ok())
+			return(INCREMENTAL_TICK_MS);
+		s_settling = FALSE;
+
+		if (!s_haveRange)
+		{
+			if (s_dirty.empty() || ((getTimeStamp() - s_lastEdit) < INCREMENTAL_SETTLE))
+				return(INCREMENTAL_TICK_MS);
+			take(s_range);
+			s_haveRange = s_first = TRUE;
+		}
+
+		BOOL more = FALSE;
+		s_working = TRUE;
+		try
+		{
+			more = s_work(s_range, s_first);
+		}
+		CATCH()
+		s_working = s_first = FALSE;
+		s_haveRange = more;
+
+		// The slice left analysis queued (auto_mark_range(), reanalyze_callers()), its edits are the slice's too
+		s_settling = !auto_is_ok();
+		return(INCREMENTAL_TICK_MS);
+	}
+
+	BOOL start(const std::vector<range_t> &segments, RANGEWORK work, RANGEDROP drop)
+	{
+		stop();
+		if (!hook_to_notification_point(HT_IDB, idbEvent, NULL))
+			return(FALSE);
+
+		s_segments = segments;
+		s_work = work;
+		s_drop = drop;
+		s_dirty.clear();
+		s_haveRange = s_working = s_settling = FALSE;
+		s_lastEdit = 0;
+		s_timer = register_timer(INCREMENTAL_TICK_MS, tick, NULL);
+		s_active = TRUE;
+		return(TRUE);
+	}
+
+	void stop()
+	{
+		if (!s_active)
+			return;
+		s_active = FALSE;
+
+		unhook_from_notification_point(HT_IDB, idbEvent, NULL);
+		if (s_timer)
+		{
+			unregister_timer(s_timer);
+			s_timer = NULL;
+		}
+		if (s_haveRange && s_drop)
+			s_drop();
+		s_haveRange = FALSE;
+		s_dirty.clear();
+		s_segments.clear();
+	}
+
+	BOOL active() { return(s_active); }
+	size_t pending() { return(s_dirty.nranges()); }
+};
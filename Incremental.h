@@ -0,0 +1,26 @@
+// Background incremental mode.
+// After a run the plugin can stay resident, collecting the ranges of the processed segments that IDB
+// change events touch (items destroyed, code and data made, functions added and deleted, segment
+// changes). Once the edits settle, a UI timer hands the merged ranges back a time slice at a time,
+// while the auto-analyzer is idle, for the passes to be redone on just them. The edits a slice makes,
+// and those of the analysis it leaves queued, aren't collected; nor edits made while that analysis runs.
+#pragma once
+#include <vector>
+
+namespace Incremental
+{
+	// Does a time slice of work on a dirty range, "first" set on its first call.
+	// Returns TRUE while it has more to do on it.
+	typedef BOOL (*RANGEWORK)(const range_t &range, BOOL first);
+
+	// Abandons the range being worked, when stopped part way through it
+	typedef void (*RANGEDROP)();
+
+	// Watch "segments", handing their dirty ranges to "work"; returns FALSE if the IDB can't be hooked
+	BOOL start(const std::vector<range_t> &segments, RANGEWORK work, RANGEDROP drop);
+	void stop();
+	BOOL active();
+
+	// Dirty ranges waiting, not counting the one being worked
+	size_t pending();
+};
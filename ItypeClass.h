@@ -0,0 +1,83 @@
+// x86 instruction type (itype) classification tables.
+// One class bit set byte per "allins.hpp" NN_* itype, so classifying is a single table lookup.
+#pragma once
+
+enum ITYPECLASS
+{
+	IC_RETURN     = 0x01,	// Return, from a function, interrupt or system call
+	IC_JUMP       = 0x02,	// Unconditional jump
+	IC_TRAP       = 0x04,	// Halts or faults, execution doesn't go on past it
+	IC_CONDBRANCH = 0x08,	// Conditional branch, "jcc", "jcxz" and "loop"s
+	IC_CALL       = 0x10,
+	IC_INDIRECT   = 0x20,	// Indirect near jump or call, through a register or table
+	IC_PADDING    = 0x40,	// Align filler, "int 3" and "nop"s
+	IC_BYTELOAD   = 0x80,	// Can load a byte to a register: "mov", "movzx", etc.
+
+	// Flow doesn't fall through to the next instruction
+	IC_TERMINATOR = (IC_RETURN | IC_JUMP | IC_TRAP),
+};
+
+namespace ItypeClass
+{
+	static constexpr WORD returns[] =
+	{
+		NN_retn, NN_retf, NN_retnw, NN_retnd, NN_retnq, NN_retfw, NN_retfd, NN_retfq,
+		NN_iretw, NN_iret, NN_iretd, NN_iretq, NN_syscall, NN_sysret, NN_sysexit,
+	};
+	static constexpr WORD jumps[] = { NN_jmp, NN_jmpfi, NN_jmpni, NN_jmpshort };
+	static constexpr WORD traps[] = { NN_hlt, NN_ud2 };
+	static constexpr WORD condBranches[] =
+	{
+		NN_ja,  NN_jae, NN_jb,  NN_jbe,  NN_jc,   NN_je,   NN_jg,
+		NN_jge, NN_jl,  NN_jle, NN_jna,  NN_jnae, NN_jnb,  NN_jnbe,
+		NN_jnc, NN_jne, NN_jng, NN_jnge, NN_jnl,  NN_jnle, NN_jno,
+		NN_jnp, NN_jns, NN_jnz, NN_jo,   NN_jp,   NN_jpe,  NN_jpo,
+		NN_js,  NN_jz,  NN_jcxz, NN_jecxz, NN_jrcxz,
+		NN_loopw, NN_loop, NN_loopd, NN_loopq, NN_loopwe, NN_loope, NN_loopde, NN_loopqe,
+		NN_loopwne, NN_loopne, NN_loopdne, NN_loopqne,
+	};
+	static constexpr WORD calls[] = { NN_call, NN_callfi, NN_callni };
+	static constexpr WORD indirects[] = { NN_jmpni, NN_callni };
+	static constexpr WORD paddings[] = { NN_int3, NN_nop, NN_fnop };
+	static constexpr WORD byteLoads[] = { NN_mov, NN_movzx, NN_movsx, NN_lods };
+
+	// C++11 style (single expression) so VS2015 takes it
+	constexpr bool inList(UINT itype, const WORD *list, size_t count)
+	{
+		return((count != 0) && ((list[count - 1] == itype) || inList(itype, list, (count - 1))));
+	}
+	template<size_t N> constexpr BYTE bitIf(UINT itype, const WORD (&list)[N], BYTE bit)
+	{
+		return(inList(itype, list, N) ? bit : 0);
+	}
+
+	constexpr BYTE classOf(UINT itype)
+	{
+		return(bitIf(itype, returns, IC_RETURN) | bitIf(itype, jumps, IC_JUMP) | bitIf(itype, traps, IC_TRAP) |
+			   bitIf(itype, condBranches, IC_CONDBRANCH) | bitIf(itype, calls, IC_CALL) | bitIf(itype, indirects, IC_INDIRECT) |
+			   bitIf(itype, paddings, IC_PADDING) | bitIf(itype, byteLoads, IC_BYTELOAD));
+	}
+
+	// The table, filled in by init() at plugin load.
+	// A compile time table is one constant evaluation per itype, too many steps for VS2015's constexpr limit.
+	inline BYTE *table()
+	{
+		static BYTE classes[NN_last];
+		return(classes);
+	}
+
+	inline void init()
+	{
+		BYTE *classes = table();
+		for (UINT itype = 0; itype < NN_last; itype++)
+			classes[itype] = classOf(itype);
+	}
+
+	static_assert((classOf(NN_retn) == IC_RETURN) && (classOf(NN_jmpni) == (IC_JUMP | IC_INDIRECT)), "Bad itype classes");
+};
+
+// Class bits of an instruction type
+inline BYTE itypeClass(UINT itype) { return((itype < NN_last) ? ItypeClass::table()[itype] : 0); }
+
+// Returns TRUE if the instruction type is in any of the classes
+inline BOOL isItype(UINT itype, UINT classes) { return((itypeClass(itype) & classes) != 0); }
@@ -1,1526 +1,3174 @@
-
-#include "stdafx.h"
-#include <WaitBoxEx.h>
-#include <SegSelect.h>
-#include <IdaOgg.h>
-#include <unordered_set>
-#include <vector>
-
-#include "complete_ogg.h"
-
-//#define VBDEV
-//#define LOG_FILE
-
-// Count of eSTATE_PASS_1 unknown byte gather passes
-#define UNKNOWN_PASSES 8
-
-// x86 hack for speed in alignment value searching
-// Defs from IDA headers, not supposed to be exported but need to because some cases not covered
-// by SDK accessors, etc.
-#define MS_VAL  0x000000FFLU	// Mask for byte value
-#define FF_IVL  0x00000100LU	// Byte has value ?
-#define FF_REF  0x00001000LU	// has references
-#define FF_0OFF 0x00500000LU	// Offset?
-
-/*
-    1st pass. Look for " dd " without "offset". Finds missing code
-    For each found:
-        1. Find the extents of the block and undefine it
-        2. Analise it for code
-
-    2nd pass. Look for " dw " without "offset". Finds missing code
-    Same as above.
-
-    3nd pass. Look for " db " without "offset". Finds missing code
-    Same as above.
-
-    4th pass. Look at gaps between functions. Finds missing functions
-    If code is found try to make a function of it.
-*/
-
-
-// Process states
-enum eSTATES
-{
-    eSTATE_INIT,	// Initialize
-	eSTATE_START,	// Start processing
-
-    eSTATE_PASS_1,	// Find unknown data in code space
-    eSTATE_PASS_2,	// Find missing "align" blocks
-	eSTATE_PASS_3,	// Find lost code instructions
-	eSTATE_PASS_4,  // Find missing functions part
-
-    eSTATE_FINISH,  // Done
-
-    eSTATE_EXIT,
-};
-
-static const char SITE_URL[] = { "http://www.macromonkey.com/bb/index.php/topic,21.0.html" };
-
-// UI options bit flags
-// *** Must be same sequence as check box options
-const static WORD OPT_DATATOBYTES = (1 << 0);
-const static WORD OPT_ALIGNBLOCKS = (1 << 1);
-const static WORD OPT_MISSINGCODE = (1 << 2);
-const static WORD OPT_MISSINGFUNC = (1 << 3);
-
-// Function info container
-struct FUNCNODE
-{
-	ea_t address;
-	UINT size;
-};
-
-typedef std::unordered_set<ea_t> ADDRSET;
-typedef std::vector<FUNCNODE> FUNCLIST;
-
-// === Function Prototypes ===
-static void showEndStats();
-static void nextState();
-static void processFuncGap(ea_t start, UINT size);
-static bool idaapi isAlignByte(flags_t flags, void *ud);
-static bool idaapi is_data(flags_t flags, void *ud);
-
-// === Data ===
-static TIMESTAMP s_startTime = 0, s_stepTime = 0;
-static segment_t *s_thisSeg  = NULL;
-static ea_t s_segStart       = NULL;
-static ea_t s_segEnd         = NULL;
-static ea_t s_currentAddress = NULL;
-static ea_t s_lastAddress    = NULL;
-static BOOL s_isBreak        = FALSE;
-#ifdef LOG_FILE
-static FILE *s_logFile       = NULL;
-#endif
-static eSTATES s_state       = eSTATE_INIT;
-static size_t  s_startFuncCount = 0;
-static int  s_pass1Loops     = 0;
-static size_t s_funcCount      = 0;
-static UINT s_funcIndex      = 0;
-//
-static UINT s_unknownDataCount = 0;
-static UINT s_alignFixes       = 0;
-static UINT s_codeFixes        = 0;
-//
-static BOOL s_doDataToBytes  = TRUE;
-static BOOL s_doAlignBlocks  = TRUE;
-static BOOL s_doMissingCode  = TRUE;
-static BOOL s_doMissingFunc  = TRUE;
-static WORD s_audioAlertWhenDone = 1;
-static SegSelect::segments *chosen = NULL;
-
-
-// Options dialog
-static const char optionDialog[] =
-{
-	"BUTTON YES* Continue\n" // 'Continue' instead of 'okay'
-
-	// Help body
-	"HELP\n"
-	"\"ExtraPass PlugIn\""
-	"An IDA Pro Win32 x86 executable clean up plugin, by Sirmabus\n\n"
-
-	"This plugin does an \"extra pass\" to help fix and cleanup the IDB.\n"
-	"It can find tens of thousands missing functions and alignment blocks making\n"
-	"your IDB more complete and easier to reverse.\n\n"
-
-	"It actually does essentially five processing steps:\n"
-	"1. Convert stray code section values to \"unknown\".\n"
-	"2. Fix missing \"align\" blocks.\n"
-	"3. Fix missing code bytes.\n"
-	"4. Locate and fix missing/undefined functions.\n\n"
-
-	"It's intended for, and only tested on typical MSVC and Intel complied Windows\n"
-	"32bit binary executables but it might still be helpful on Delphi/Borland and\n"
-	"other complied targets.\n"
-	"For best results, run the plugin at least two times.\n"
-	"Will not work well with Borland(r) and other targets that has data mixed with code in the same space.\n"
-	"See \"ExtraPass.txt\" for more help.\n\n"
-	"Forum: http://www.macromonkey.com/bb/\n"
-	"ENDHELP\n"
-
-	// Title
-	"ExtraPass Plugin\n"
-
-	// Message text
-	"Version %Aby Sirmabus\n"
-    "<#Click to open site.#www.macromonkey.com:k:2:1::>\n\n"
-
-	"Choose processing steps:\n"
-
-	// checkbox -> s_wDoDataToBytes
-	"<#Scan the entire code section converting all unknown DD,DW,DB data declarations to\n"
-	"unknown bytes, to be reexamined as possible code, functions, and alignment blocks\n"
-	"in the following passes.#1 Convert unknown data.                                     :C>\n"
-
-	// checkbox -> s_wDoAlignBlocks
-	"<#Fix missing \"align xx\" blocks.#2 Fix align blocks.:C>\n"
-
-	// checkbox -> s_wDoMissingCode
-	"<#Fix lost code instructions.#3 Fix missing code.:C>\n"
-
-	// checkbox -> s_wDoMissingFunc
-	"<#Fix missing/undeclared functions.#4 Fix missing functions.:C>>\n"
-
-	// checkbox -> s_wAudioAlertWhenDone
-	"<#Play sound on completion.#Play sound on completion.                                     :C>>\n"
-
-
-	"<#Choose the code segment(s) to process.\nElse will use the first CODE segment by default.\n#Choose Code Segments:B:1:8::>\n"
-    "                      "
-};
-
-// Checks and handles if break key pressed; returns TRUE on break.
-static BOOL checkBreak()
-{
-    if (!s_isBreak)
-    {
-        if (WaitBox::isUpdateTime())
-        {
-            if (WaitBox::updateAndCancelCheck())
-            {
-                msg("\n*** Aborted ***\n\n");
-
-                // Show stats then directly to exit
-                showEndStats();
-                s_state = eSTATE_EXIT;
-                s_isBreak = TRUE;
-                return(TRUE);
-            }
-        }
-    }
-    return(s_isBreak);
-}
-
-// Make and address range "unknown" so it can be set with something else
-static void makeUnknown(ea_t start, ea_t end)
-{
-   auto_wait();
-    //auto_mark_range(s_currentAddress, end, AU_UNK);
-    //do_unknown(start, (DOUNK_SIMPLE | DOUNK_NOTRUNC));
-
-   del_items(start, (DELIT_SIMPLE | DELIT_NOTRUNC), (end - start));
-    auto_wait();
-}
-
-// Initialize
-int idaapi plugin_init()
-{
-	// Only Intel x86/AMD64 supported
-	if (ph.id != PLFM_386)
-		return(PLUGIN_SKIP);
-
-    s_state = eSTATE_INIT;
-	return(PLUGIN_OK);
-}
-
-// Uninitialize
-void idaapi plugin_exit()
-{
-    try
-    {
-        #ifdef LOG_FILE
-        if(s_logFile)
-        {
-            qfclose(s_logFile);
-            s_logFile = NULL;
-        }
-        #endif
-
-        if (chosen)
-        {
-            SegSelect::free(chosen);
-            chosen = NULL;
-        }
-
-        OggPlay::endPlay();
-        set_user_defined_prefix(0, NULL);
-    }
-    CATCH()
-}
-
-// Handler for choose code and data segment buttons
-static void idaapi chooseBtnHandler(TWidget *fields[], int code)
-{
-    if (chosen = SegSelect::select(SegSelect::CODE_HINT, "Choose code segments"))
-    {
-        msg("Chosen: ");
-        for (SegSelect::segments::iterator it = chosen->begin(); it != chosen->end(); ++it)
-        {
-            qstring buffer;
-            if (get_segm_name(&buffer, *it) <= 0)
-                buffer = "????";
-
-            SegSelect::segments::iterator it2 = it; ++it2;
-            if (it2 != chosen->end())
-                msg("\"%s\", ", buffer.c_str());
-            else
-                msg("\"%s\"", buffer.c_str());
-        }
-        msg("\n");
-        WaitBox::processIdaEvents();
-    }
-}
-
-static void idaapi doHyperlink(TWidget *fields[], int code) { open_url(SITE_URL); }
-
-
-// Plug-in process
-bool idaapi plugin_run(size_t arg)
-{
-    try
-    {
-        while (TRUE)
-        {
-            switch (s_state)
-            {
-                // Initialize
-                case eSTATE_INIT:
-                {
-					char version[16];
-					sprintf(version, "%u.%u", HIBYTE(MY_VERSION), LOBYTE(MY_VERSION));
-					msg("\n>> ExtraPass: v: %s, BD: %s, By Sirmabus ==\n", version, __DATE__);
-					refreshUI();
-                    WaitBox::processIdaEvents();
-                    s_isBreak = FALSE;
-
-                    // Do UI for process pass selection
-                    s_doDataToBytes = s_doAlignBlocks = s_doMissingCode = s_doMissingFunc = TRUE;
-                    s_audioAlertWhenDone = TRUE;
-
-                    WORD optionFlags = 0;
-                    if (s_doDataToBytes) optionFlags |= OPT_DATATOBYTES;
-                    if (s_doAlignBlocks) optionFlags |= OPT_ALIGNBLOCKS;
-                    if (s_doMissingCode) optionFlags |= OPT_MISSINGCODE;
-                    if (s_doMissingFunc) optionFlags |= OPT_MISSINGFUNC;
-
-                    {
-                        // To add forum URL to help box
-                        int result = ask_form(optionDialog, version, doHyperlink, &optionFlags, &s_audioAlertWhenDone, chooseBtnHandler);
-                        if (!result || (optionFlags == 0))
-                        {
-                            // User canceled, or no options selected, bail out
-                            msg(" - Canceled -\n\n");
-                            WaitBox::processIdaEvents();
-                            s_state = eSTATE_EXIT;
-                            break;
-                        }
-
-                        s_doDataToBytes = ((optionFlags & OPT_DATATOBYTES) != 0);
-                        s_doAlignBlocks = ((optionFlags & OPT_ALIGNBLOCKS) != 0);
-                        s_doMissingCode = ((optionFlags & OPT_MISSINGCODE) != 0);
-                        s_doMissingFunc = ((optionFlags & OPT_MISSINGFUNC) != 0);
-                    }
-
-                    // IDA must be IDLE
-                    if (auto_is_ok())
-                    {
-                        // Ask for the log file name once
-                        #ifdef LOG_FILE
-                        if(!s_logFile)
-                        {
-                            if(char *szFileName = askfile_c(1, "*.txt", "Select a log file name:"))
-                            {
-                                // Open it for appending
-                                s_logFile = qfopen(szFileName, "ab");
-                            }
-                        }
-                        if(!s_logFile)
-                        {
-                            msg("** Log file open failed! Aborted. **\n");
-                            return;
-                        }
-                        #endif
-
-                        s_thisSeg = NULL;
-                        s_unknownDataCount = 0;
-                        s_alignFixes = s_codeFixes = 0;
-                        s_pass1Loops = 0; s_funcIndex = 0;
-                        s_startFuncCount = get_func_qty();
-
-                        if (s_startFuncCount > 0)
-                        {
-                            char buffer[32];
-                            msg("Starting function count: %s\n", prettyNumberString(s_startFuncCount, buffer));
-                            WaitBox::processIdaEvents();
-
-                            /*
-                            msg("\n=========== Segments ===========\n");
-                            int iSegCount = get_segm_qty();
-                            for(int i = 0; i < iSegCount; i++)
-                            {
-                                if(segment_t *pSegInfo = getnseg(i))
-                                {
-                                char szName[128] = {0};
-                                get_visible_segm_name(pSegInfo, szName, (sizeof(szName) - 1));
-                                char szClass[16] = {0};
-                                get_segm_class(pSegInfo, szClass, (sizeof(szClass) - 1));
-                                msg("[%d] \"%s\", \"%s\".\n", i, szName, szClass);
-                                }
-                            }
-                            */
-
-                            // First chosen seg
-                            if (chosen && !chosen->empty())
-                            {
-                                s_thisSeg = chosen->back();
-                                chosen->pop_back();
-                            }
-                            else
-                            // Use the first CODE seg
-                            {
-                                int iSegCount = get_segm_qty();
-                                int iIndex = 0;
-                                for (; iIndex < iSegCount; iIndex++)
-                                {
-                                    if (s_thisSeg = getnseg(iIndex))
-                                    {
-                                        qstring sclass;
-                                        if (get_segm_class(&sclass, s_thisSeg) <= 0)
-                                            break;
-                                        else
-                                        if (sclass == "CODE")
-                                            break;
-                                    }
-                                }
-
-                                if (iIndex >= iSegCount)
-                                    s_thisSeg = NULL;
-                            }
-
-                            if (s_thisSeg)
-                            {
-                                WaitBox::show();
-                                WaitBox::updateAndCancelCheck(-1);
-                                s_segStart = s_thisSeg->start_ea;
-                                s_segEnd   = s_thisSeg->end_ea;
-                                nextState();
-                                break;
-                            }
-                            else
-                                msg("** No code segment found to process! **\n*** Aborted ***\n\n");
-                        }
-                        else
-                            msg("** No functions in DB?! **\n*** Aborted ***\n\n");
-                    }
-                    else
-                        msg("** Wait for IDA to finish processing before starting plugin! **\n*** Aborted ***\n\n");
-
-                    // Canceled or error'ed, bail out
-                    s_state = eSTATE_EXIT;
-                }
-                break;
-
-                // Start up process
-                case eSTATE_START:
-                {
-                    s_currentAddress = 0;
-
-                    qstring name;
-                    if (get_segm_name(&name, s_thisSeg) <= 0)
-                        name = "????";
-					qstring sclass;
-                    if(get_segm_class(&sclass, s_thisSeg) <= 0)
-                        sclass = "????";
-                    msg("\nProcessing segment: \"%s\", type: %s, address: " EAFORMAT "-" EAFORMAT ", size: %08X\n\n", name.c_str(), sclass.c_str(), s_thisSeg->start_ea, s_thisSeg->end_ea, s_thisSeg->size());
-
-                    // Move to first process state
-                    s_startTime = getTimeStamp();
-                    nextState();
-                }
-                break;
-
-
-                // Find unknown data values in code
-                //#define PASS1_DEBUG
-                case eSTATE_PASS_1:
-                {
-                    if (s_currentAddress < s_segEnd)
-                    {
-                        // Value at this location data?
-                        auto_wait();
-                        flags_t flags = get_flags(s_currentAddress);
-                        if (is_data(flags) && !is_align(flags))
-                        {
-                            #ifdef PASS1_DEBUG
-                            msg(EAFORMAT",  F: %08X data\n", s_currentAddress, flags);
-                            #endif
-                            ea_t end = next_head(s_currentAddress, s_segEnd);
-
-                            // Handle an occasional over run case
-                            if (end == BADADDR)
-                            {
-                                #ifdef PASS1_DEBUG
-                                msg(EAFORMAT" **** abort end\n", s_currentAddress);
-                                #endif
-                                s_currentAddress = (s_segEnd - 1);
-                                break;
-                            }
-
-                            // Skip if it has offset reference (most common occurrence)
-                            BOOL bSkip = FALSE;
-                            if (flags & FF_0OFF)
-                            {
-                                #ifdef PASS1_DEBUG
-                                msg("  skip offset.\n");
-                                #endif
-                                bSkip = TRUE;
-                            }
-                            else
-                            // Has a reference?
-                            if (flags & FF_REF)
-                            {
-                                ea_t eaDRef = get_first_dref_to(s_currentAddress);
-                                if (eaDRef != BADADDR)
-                                {
-                                    // Ref part an offset?
-                                    flags_t flags2 = get_flags(eaDRef);
-                                    if (is_code(flags2) && is_off1(flags2))
-                                    {
-                                        // Decide instruction to global "cmd" struct
-                                        BOOL bIsByteAccess = FALSE;
-										insn_t cmd;
-                                        if (decode_insn(&cmd, eaDRef))
-                                        {
-                                            switch (cmd.itype)
-                                            {
-                                                // movxx style move a byte?
-                                                case NN_movzx:
-                                                case NN_movsx:
-                                                {
-                                                    #ifdef PASS1_DEBUG
-                                                    msg(EAFORMAT" movzx\n", s_currentAddress);
-                                                    #endif
-                                                    bIsByteAccess = TRUE;
-                                                }
-                                                break;
-
-                                                case NN_mov:
-                                                {
-                                                    if ((cmd.ops[0].type == o_reg) && (cmd.ops[1].dtype == dt_byte))
-                                                    {
-                                                        #ifdef PASS1_DEBUG
-                                                        msg(EAFORMAT" mov\n", s_currentAddress);
-                                                        #endif
-                                                        /*
-                                                        msg(" [0] T: %d, D: %d, \n", cmd.Operands[0].type, cmd.Operands[0].dtyp);
-                                                        msg(" [1] T: %d, D: %d, \n", cmd.Operands[1].type, cmd.Operands[1].dtyp);
-                                                        msg(" [2] T: %d, D: %d, \n", cmd.Operands[2].type, cmd.Operands[2].dtyp);
-                                                        msg(" [3] T: %d, D: %d, \n", cmd.Operands[3].type, cmd.Operands[3].dtyp);
-                                                        */
-                                                        bIsByteAccess = TRUE;
-                                                    }
-                                                }
-                                                break;
-                                            };
-                                        }
-
-                                        // If it's byte access, assume it's a byte switch table
-                                        if (bIsByteAccess)
-                                        {
-                                            #ifdef PASS1_DEBUG
-                                            msg(EAFORMAT" not byte\n", s_currentAddress);
-                                            #endif
-                                            makeUnknown(s_currentAddress, end);
-                                            // Step through making the array, and any bad size a byte
-                                            //for(ea_t i = s_eaCurrentAddress; i < eaEnd; i++){ doByte(i, 1); }
-											create_byte(s_currentAddress, (end - s_currentAddress));
-                                            auto_wait();
-                                            bSkip = TRUE;
-                                        }
-                                    }
-                                }
-                            }
-
-                            // Make it unknown bytes
-                            if (!bSkip)
-                            {
-                                #ifdef PASS1_DEBUG
-                                msg(EAFORMAT" "EAFORMAT" %02X unknown\n", s_currentAddress, end, get_flags(s_currentAddress));
-                                #endif
-                                makeUnknown(s_currentAddress, end);
-                                s_unknownDataCount++;
-
-                                // Note: Might have triggered auto-analysis and a alignment or function could be here now
-                            }
-
-                            // Advance to next data value, or the end which ever comes first
-                            s_currentAddress = end;
-                            if (s_currentAddress < s_segEnd)
-                            {
-                                s_currentAddress = next_that(s_currentAddress, s_segEnd, is_data, NULL);
-                                break;
-                            }
-                        }
-                        else
-                        {
-                            // Advance to next data value, or the end which ever comes first
-                            s_currentAddress = next_that(s_currentAddress, s_segEnd, is_data, NULL);
-                            break;
-                        }
-                    }
-
-                    if (++s_pass1Loops < UNKNOWN_PASSES)
-                    {
-                        #ifdef PASS1_DEBUG
-                        msg("** Pass %d Unknowns: %u\n", s_pass1Loops, s_unknownDataCount);
-                        #endif
-                        s_currentAddress = s_lastAddress = s_segStart;
-                    }
-                    else
-                    {
-                        #ifdef PASS1_DEBUG
-                        msg("** Pass %d Unknowns: %u\n", s_pass1Loops, s_unknownDataCount);
-                        #endif
-                        nextState();
-                    }
-                }
-                break;  // Find unknown data values in code
-
-
-                // Find missing align blocks
-                //#define PASS2_DEBUG
-                case eSTATE_PASS_2:
-                {
-                    #define NEXT(_Here, _Limit) next_that(_Here, _Limit, isAlignByte, NULL)
-
-                    // Still inside this code segment?
-                    ea_t end = s_segEnd;
-                    if (s_currentAddress < end)
-                    {
-                        // Look for next unknown alignment type byte
-                        // Will return BADADDR if none found which will catch in the endEA test
-                        flags_t flags = get_full_flags(s_currentAddress);
-                        if (!isAlignByte(flags, NULL))
-                            s_currentAddress = NEXT(s_currentAddress, s_segEnd);
-                        if (s_currentAddress < end)
-                        {
-                            // Catch when we get caught up in an array, etc.
-                            ea_t startAddress = s_currentAddress;
-                            if (s_currentAddress <= s_lastAddress)
-                            {
-                                // Move to next header and try again..
-                                #ifdef PASS2_DEBUG
-                                //msg(EAFORMAT", F: 0x%X *** Align test in array #1 ***\n", s_currentAddress, flags);
-                                #endif
-                                s_currentAddress = s_lastAddress = next_addr(s_currentAddress);
-                                break;
-                            }
-
-                            #ifdef PASS2_DEBUG
-                            //msg(EAFORMAT" Start.\n", startAddress);
-                            //msg(EAFORMAT", F: %08X.\n", startAddress, get_flags(startAddress));
-                            #endif
-                            s_lastAddress = s_currentAddress;
-
-                            // Get run count of this align byte
-                            UINT alignByteCount = 1;
-                            BYTE startAlignValue = get_byte(startAddress);
-
-                            while (TRUE)
-                            {
-                                // Next byte
-                                s_currentAddress = next_addr(s_currentAddress);
-                                #ifdef PASS2_DEBUG
-                                //msg(EAFORMAT" Next.\n", s_currentAddress);
-                                //msg(EAFORMAT", F: %08X.\n", s_currentAddress, get_flags(s_currentAddress));
-                                #endif
-
-                                if (s_currentAddress < end)
-                                {
-                                    // Catch when we get caught up in an array, etc.
-                                    if (s_currentAddress <= s_lastAddress)
-                                    {
-                                        #ifdef PASS2_DEBUG
-                                        //msg(EAFORMAT", F: %08X *** Align test in array #2 ***\n", startAddress, get_flags(s_currentAddress));
-                                        #endif
-                                        s_currentAddress = s_lastAddress = next_addr(s_currentAddress);
-                                        break;
-                                    }
-                                    s_lastAddress = s_currentAddress;
-
-                                    // Count if it' still the same byte
-                                    if (get_byte(s_currentAddress) == startAlignValue)
-                                        alignByteCount++;
-                                    else
-                                        break;
-                                }
-                                else
-                                    break;
-                            };
-
-                            // Do these bytes bring about at least a 16 (could be 32) align?
-                            // TODO: Must we consider other alignments such as 4 and 8?
-                            //       Probably a compiler option that is not normally used anymore.
-                            if (((startAddress + alignByteCount) & (16 - 1)) == 0)
-                            {
-                                // If short count, only try alignment if the line above or a below us has n xref
-                                // We don't want to try to align odd code and switch table bytes, etc.
-                                if (alignByteCount <= 2)
-                                {
-                                    BOOL hasRef = FALSE;
-
-                                    // Before us
-                                    ea_t endAddress = (startAddress + alignByteCount);
-                                    ea_t ref = get_first_cref_from(endAddress);
-                                    if (ref != BADADDR)
-                                    {
-                                        //msg(EAFORMAT " cref from end.\n", endAddress);
-                                        hasRef = TRUE;
-                                    }
-                                    else
-                                    {
-                                        ref = get_first_cref_to(endAddress);
-                                        if (ref != BADADDR)
-                                        {
-                                            //msg(EAFORMAT " cref to end.\n", endAddress);
-                                            hasRef = TRUE;
-                                        }
-                                    }
-
-                                    // After us
-                                    if (ref == BADADDR)
-                                    {
-                                        ea_t foreAddress = (startAddress - 1);
-                                        ref = get_first_cref_from(foreAddress);
-                                        if (ref != BADADDR)
-                                        {
-                                            //msg(EAFORMAT " cref from start.\n", eaForeAddress);
-                                            hasRef = TRUE;
-                                        }
-                                        else
-                                        {
-                                            ref = get_first_cref_to(foreAddress);
-                                            if (ref != BADADDR)
-                                            {
-                                                //msg(EAFORMAT " cref to start.\n", eaForeAddress);
-                                                hasRef = TRUE;
-                                            }
-                                        }
-                                    }
-
-                                    // No code ref, now look for a broken code ref
-                                    if (ref == BADADDR)
-                                    {
-                                        // This is still not complete as it could still be code, but pointing to a vftable
-                                        // entry in data.
-                                        // But should be fixed on more passes.
-                                        ea_t endAddress = (startAddress + alignByteCount);
-                                        ref = get_first_dref_from(endAddress);
-                                        if (ref != BADADDR)
-                                        {
-                                            // If it the ref points to code assume code is just broken here
-                                            if (is_code(get_flags(ref)))
-                                            {
-                                                //msg(EAFORMAT " dref from end %08X.\n", eaRef, eaEndAddress);
-                                                hasRef = TRUE;
-                                            }
-                                        }
-                                        else
-                                        {
-                                            ref = get_first_dref_to(endAddress);
-                                            if (ref != BADADDR)
-                                            {
-                                                if (is_code(get_flags(ref)))
-                                                {
-                                                    //msg(EAFORMAT " dref to end %08X.\n", eaRef, eaEndAddress);
-                                                    hasRef = TRUE;
-                                                }
-                                            }
-                                        }
-
-                                        if (ref == BADADDR)
-                                        {
-                                            //msg(EAFORMAT " NO REF.\n", eaStartAddress);
-                                        }
-                                    }
-
-                                    // Assume it's not an alignment byte(s) and bail out
-                                    if (!hasRef) break;
-                                }
-
-                                // If it's not an align make block already try to fix it
-								flags_t flags = get_flags(startAddress);
-								UINT itemSize = get_item_size(startAddress);
-								if (!is_align(flags) || (itemSize != alignByteCount))
-								{
-									makeUnknown(startAddress, ((startAddress + alignByteCount) - 1));
-									BOOL result = create_align(startAddress, alignByteCount, 0);
-									auto_wait();
-									#ifdef PASS2_DEBUG
-									msg(EAFORMAT" %d %d  %d %d %d DO ALIGN.\n", startAddress, alignByteCount, result, is_align(flags), itemSize, get_item_size(startAddress));
-									#endif
-									if (result)
-									{
-										#ifdef PASS2_DEBUG
-										//msg(EAFORMAT" %d ALIGN.\n", startAddress, alignByteCount);
-										#endif
-										s_alignFixes++;
-									}
-									else
-									{
-										// There are cases were IDA will fail even when the alignment block is obvious.
-										// Usually when it's an ALIGN(32) and there is a run of 16 align bytes
-										// Could at least do a code analyze on it. Then IDA will at least make a mini array of it
-										#ifdef PASS2_DEBUG
-										msg(EAFORMAT" %d ALIGN FAIL ***\n", startAddress, alignByteCount);
-										//s_alignFails++;
-										#endif
-									}
-								}
-                            }
-                        }
-
-                        break;
-                    }
-
-                    s_currentAddress = s_segEnd;
-                    nextState();
-                    #undef NEXT
-                }
-                break; // Find missing align blocks
-
-
-                // Find missing code
-                //#define PASS3_DEBUG
-                case eSTATE_PASS_3:
-                {
-                    // Still inside segment?
-                    if (s_currentAddress < s_segEnd)
-                    {
-                        // Look for next unknown value
-                        ea_t startAddress = next_unknown(s_currentAddress, s_segEnd);
-                        if (startAddress < s_segEnd)
-                        {
-                            s_currentAddress = startAddress;
-                            //s_uStrayBYTE++;
-                            //msg(EAFORMAT " unknown.\n");
-
-                            // Catch when we get caught up in an array, etc.
-                            if (s_currentAddress <= s_lastAddress)
-                            {
-                                // Move to next header and try again..
-                                s_currentAddress = next_unknown(s_currentAddress, s_segEnd);
-                                s_lastAddress = s_currentAddress;
-                                break;
-                            }
-                            s_lastAddress = s_currentAddress;
-
-                            // Try to make code of it
-                            auto_wait();
-                            int result = create_insn(s_currentAddress);
-                            auto_wait();
-                            #ifdef PASS3_DEBUG
-                            msg(EAFORMAT" DO CODE %d\n", s_currentAddress, result);
-                            #endif
-                            if(result > 0)
-                                s_codeFixes++;
-                            else
-                            {
-                                #ifdef PASS3_DEBUG
-                                msg(EAFORMAT" fix fail.\n", s_currentAddress);
-                                #endif
-                            }
-
-                            // Start from possible next byte
-                            s_currentAddress++;
-                            break;
-                        }
-                    }
-
-                    // Next state
-                    s_currentAddress = s_segEnd;
-                    nextState();
-                }
-                break; // End: Find missing code
-
-
-                // Discover missing functions part 1
-                case eSTATE_PASS_4:
-                {
-                    if (s_funcIndex < s_funcCount)
-                    {
-                        // Get function gap from the bottom of the function to the start of the next
-                        func_t *f1 = getn_func(s_funcIndex + 0);
-                        func_t *f2 = getn_func(s_funcIndex + 1);
-
-                        UINT gapSize = (f2->start_ea - f1->end_ea);
-                        if (gapSize > 0)
-                            processFuncGap(f1->end_ea, gapSize);
-
-                        s_funcIndex++;
-                    }
-                    else
-                    {
-                        s_currentAddress = s_segEnd;
-                        nextState();
-                    }
-                }
-                break;
-
-
-                // Finished processing
-                case eSTATE_FINISH:
-                {
-                    nextState();
-                }
-                break;
-
-                // Done processing
-                case eSTATE_EXIT:
-                {
-					WaitBox::hide();
-                    nextState();
-                    goto BailOut;
-                }
-                break;
-            };
-
-            // Check & bail out on 'break' press
-			if (checkBreak())
-			{
-				WaitBox::hide();
-				goto BailOut;
-			}
-        };
-
-        BailOut:;
-    }
-    CATCH()
-	return true;
-}
-
-
-// Do next state logic
-static void nextState()
-{
-	// Rewind
-	if(s_state < eSTATE_FINISH)
-	{
-		// Top of code seg
-		s_currentAddress = s_lastAddress = s_segStart;
-		//SafeJumpTo(s_uCurrentAddress);
-		auto_wait();
-	}
-
-	// Logic
-	switch(s_state)
-	{
-		// Init
-		case eSTATE_INIT:
-		{
-			s_state = eSTATE_START;
-		}
-		break;
-
-		// Start
-		case eSTATE_START:
-		{
-			if(s_doDataToBytes)
-			{
-				msg("===== Fixing bad code bytes =====\n");
-				s_stepTime = getTimeStamp();
-				s_state = eSTATE_PASS_1;
-			}
-			else
-			if(s_doAlignBlocks)
-			{
-				msg("===== Missing align blocks =====\n");
-				s_stepTime = getTimeStamp();
-				s_state = eSTATE_PASS_2;
-			}
-			else
-			if(s_doMissingCode)
-			{
-				msg("===== Missing code =====\n");
-				s_stepTime = getTimeStamp();
-				s_state = eSTATE_PASS_3;
-			}
-			else
-			if(s_doMissingFunc)
-			{
-				msg("===== Missing functions =====\n");
-                WaitBox::processIdaEvents();
-				s_stepTime = getTimeStamp();
-                s_funcIndex = 0;
-                s_funcCount = (get_func_qty() - 1);
-				s_state = eSTATE_PASS_4;
-			}
-			else
-				s_state = eSTATE_FINISH;
-
-            WaitBox::processIdaEvents();
-		}
-		break;
-
-		// Find unknown data in code space
-		case eSTATE_PASS_1:
-		{
-			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_stepTime));
-
-			if(s_doAlignBlocks)
-			{
-				msg("===== Missing align blocks =====\n");
-				s_stepTime = getTimeStamp();
-				s_state = eSTATE_PASS_2;
-			}
-			else
-			if(s_doMissingCode)
-			{
-				msg("===== Missing code =====\n");
-				s_stepTime = getTimeStamp();
-				s_state = eSTATE_PASS_3;
-			}
-			else
-			if(s_doMissingFunc)
-			{
-				msg("===== Missing functions =====\n");
-                WaitBox::processIdaEvents();
-				s_stepTime = getTimeStamp();
-                s_funcIndex = 0;
-                s_funcCount = (get_func_qty() - 1);
-				s_state = eSTATE_PASS_4;
-			}
-			else
-				s_state = eSTATE_FINISH;
-
-            WaitBox::processIdaEvents();
-		}
-		break;
-
-
-		// From missing align block pass
-		case eSTATE_PASS_2:
-		{
-			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_stepTime));
-
-			if(s_doMissingCode)
-			{
-				msg("===== Missing code =====\n");
-				s_stepTime = getTimeStamp();
-				s_state = eSTATE_PASS_3;
-			}
-			else
-			if(s_doMissingFunc)
-			{
-				msg("===== Missing functions =====\n");
-                WaitBox::processIdaEvents();
-				s_stepTime = getTimeStamp();
-                s_funcIndex = 0;
-                s_funcCount = (get_func_qty() - 1);
-				s_state = eSTATE_PASS_4;
-			}
-			else
-				s_state = eSTATE_FINISH;
-
-            WaitBox::processIdaEvents();
-		}
-		break;
-
-		// From missing code pass
-		case eSTATE_PASS_3:
-		{
-			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_stepTime));
-
-			if(s_doMissingFunc)
-			{
-				msg("===== Missing functions =====\n");
-                WaitBox::processIdaEvents();
-				s_stepTime = getTimeStamp();
-                s_funcIndex = 0;
-                s_funcCount = (get_func_qty() - 1);
-				s_state = eSTATE_PASS_4;
-			}
-			else
-				s_state = eSTATE_FINISH;
-
-            WaitBox::processIdaEvents();
-		}
-		break;
-
-		// From missing function pass part
-		case eSTATE_PASS_4:
-		{
-			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_stepTime));
-			s_state = eSTATE_FINISH;
-
-            WaitBox::processIdaEvents();
-		}
-		break;
-
-
-		// From final pass, we're done
-		case eSTATE_FINISH:
-		{
-			// If there are more code segments to process, do next
-			auto_wait();
-            if (chosen && !chosen->empty())
-			{
-				s_thisSeg = chosen->back();
-                chosen->pop_back();
-				s_segStart = s_thisSeg->start_ea;
-				s_segEnd   = s_thisSeg->end_ea;
-				s_state = eSTATE_START;
-			}
-			else
-			{
-				msg("\n===== Done =====\n");
-				showEndStats();
-                refresh_idaview_anyway();
-				WaitBox::hide();
-                WaitBox::processIdaEvents();
-
-				// Optionally play completion sound
-				if(s_audioAlertWhenDone)
-				{
-                    // Only if processing took at least a few seconds
-                    if ((getTimeStamp() - s_startTime) > 2.2)
-                    {
-
-                        WaitBox::processIdaEvents();
-                        OggPlay::playFromMemory((const PVOID)complete_ogg, complete_ogg_len);
-                        OggPlay::endPlay();
-                    }
-				}
-
-				s_state = eSTATE_EXIT;
-			}
-		}
-		break;
-
-		// Exit plugin run back to IDA control
-		case eSTATE_EXIT:
-		{
-			// In case we aborted some place and list still exists..
-            if (chosen)
-            {
-                SegSelect::free(chosen);
-                chosen = NULL;
-            }
-			s_state = eSTATE_INIT;
-		}
-		break;
-	};
-}
-
-
-// Print out end stats
-static void showEndStats()
-{
-    char buffer[32];
-	msg("Total time: %s\n", timeString(getTimeStamp() - s_startTime));
-    msg("Alignments: %s\n", prettyNumberString(s_alignFixes, buffer));
-    int functionsDelta = ((int) get_func_qty() - s_startFuncCount);
-	if (functionsDelta != 0)
-		msg(" Functions: %c%s\n", ((functionsDelta >= 0) ? '+' : '-'), prettyNumberString(labs(functionsDelta), buffer)); // Can be negative
-	else
-		msg(" Functions: 0\n");
-
-	//msg("Code fixes: %u\n", s_uCodeFixes);
-	//msg("Code fails: %u\n", s_uCodeFixFails);
-	//msg("Align fails: %d\n", s_uAlignFails);
-	//msg("  Unknowns: %u\n", s_uUnknowns);
-
-	msg(" \n");
-}
-
-// Returns TRUE if flag byte is possibly a typical alignment byte
-static bool idaapi isAlignByte(flags_t flags, void *ud)
-{
-	const flags_t ALIGN_VALUE1 = (FF_IVL | 0xCC); // 0xCC (single byte "int 3") byte type
-	const flags_t ALIGN_VALUE2 = (FF_IVL | 0x90); // NOP byte type
-
-	flags &= (FF_IVL | MS_VAL);
-	if((flags == ALIGN_VALUE1) || (flags == ALIGN_VALUE2))
-		return(TRUE);
-	else
-		return(FALSE);
-}
-
-// Return if flag is data type we want to convert to unknown bytes
-static bool idaapi is_data(flags_t flags, void *ud)
-{
-	return(!is_align(flags) && is_data(flags));
-}
-
-
-static inline BOOL isJmpNotCntl(UINT type) { return((type >= NN_jmp) && (type <= NN_jmpshort)); }   // Returns TRUE if is a non-conditional jump instruction type
-static inline BOOL isCall(UINT type) { return((type >= NN_call) && (type <= NN_callni)); }          // Returns TRUE if is call instruction type
-
-// Try adding a function at specified address
-static BOOL tryFunction(ea_t codeStart, ea_t codeEnd, ea_t &current)
-{
-	BOOL result = FALSE;
-
-	auto_wait();
-	#ifdef LOG_FILE
-	Log(s_logFile, EAFORMAT " " EAFORMAT " Trying function.\n", codeStart, current);
-	#endif
-	//msg("  " EAFORMAT " " EAFORMAT " Trying function.\n", codeStart, codeEnd);
-
-	/// *** Don't use "get_func()" it has a bug, use "get_fchunk()" instead ***
-
-	// Could belong as a chunk to an existing function already or already a function here recovered already between steps.
-	if(func_t *f = get_fchunk(codeStart))
-	{
-  		#ifdef LOG_FILE
-        Log(s_logFile, "  " EAFORMAT " " EAFORMAT " " EAFORMAT " F: %08X already function.\n", f->end_ea, f->start_ea, codeStart, get_flags(codeStart));
-		#endif
-		//msg("  " EAFORMAT " " EAFORMAT " " EAFORMAT " F: %08X already a function.\n", f->end_ea, f->start_ea, codeStart, get_full_flags(codeStart));
-		current = prev_head(f->end_ea, codeStart); // Advance to end of the function -1 location (for a follow up "next_head()")
-		result = TRUE;
-	}
-	else
-	{
-		// Try function here
-		//flags_t flags = get_full_flags(codeEnd);
-		//flags = flags;
-		//if (add_func(codeStart, codeEnd /*BADADDR*/))
-
-		if(add_func(codeStart, BADADDR))
-		{
-			// Wait till IDA is done possibly creating the function, then get it's info
-			auto_wait();
-			if(func_t *f = get_fchunk(codeStart)) // get_func
-			{
-				#ifdef LOG_FILE
-				Log(s_logFile, "  " EAFORMAT " function success.\n", codeStart);
-				#endif
-				#ifdef VBDEV
-				msg("  " EAFORMAT " function success.\n", codeStart);
-				#endif
-
-				// Look at function tail instruction
-				auto_wait();
-				BOOL isExpected = FALSE;
-				ea_t tailEa = prev_head(f->end_ea, codeStart);
-				if(tailEa != BADADDR)
-				{
-					insn_t cmd;
-					if(decode_insn(&cmd, tailEa))
-					{
-						switch(cmd.itype)
-						{
-							// A return?
-							case NN_retn: case NN_retf: case NN_iretw: case NN_iret: case NN_iretd:
-							case NN_iretq: case NN_syscall:
-							case NN_sysret:
-							{
-								isExpected = TRUE;
-							}
-							break;
-
-							// A jump? (chain to another function, etc.)
-							case NN_jmp: case NN_jmpfi:	case NN_jmpni: case NN_jmpshort:
-							// Can be a conditional branch to another incongruent chunk
-							case NN_ja:  case NN_jae: case NN_jb:  case NN_jbe:  case NN_jc:   case NN_je:   case NN_jg:
-							case NN_jge: case NN_jl:  case NN_jle: case NN_jna:  case NN_jnae: case NN_jnb:  case NN_jnbe:
-							case NN_jnc: case NN_jne: case NN_jng: case NN_jnge: case NN_jnl:  case NN_jnle: case NN_jno:
-							case NN_jnp: case NN_jns: case NN_jnz: case NN_jo:   case NN_jp:  case NN_jpe:   case NN_jpo:
-							case NN_js:  case NN_jz:
-							{
-								isExpected = TRUE;
-							}
-							break;
-
-							// A single align byte that was mistakenly made a function?
-							case NN_int3:
-							case NN_nop:
-							if(f->size() == 1)
-							{
-								// Try to make it an align
-                                makeUnknown(tailEa, (tailEa + 1));
-								if(!create_align(tailEa, 1, 0))
-								{
-									// If it fails, make it an instruction at least
-									//msg("  " EAFORMAT " ALIGN fail.\n", tailEA);
-									create_insn(tailEa);
-								}
-                                auto_wait();
-								//msg("  " EAFORMAT " ALIGN\n", tailEA);
-								isExpected = TRUE;
-							}
-							break;
-
-							// Return-less exception or exit handler?
-							case NN_call:
-							{
-								ea_t eaCRef = get_first_cref_from(tailEa);
-								if(eaCRef != BADADDR)
-								{
-                                    qstring str;
-                                    if (get_name(&str, eaCRef) > 0)
-                                    {
-                                        char name[MAXNAMELEN + 1];
-                                        strncpy(name, str.c_str(), SIZESTR(name));
-                                        _strlwr(name);
-
-										static const char * const exitNames[] =
-										{
-											"exception",
-											"handler",
-											"exitprocess",
-											"fatalappexit",
-											"_abort",
-											"_exit",
-										};
-
-										for(int i = 0; i < (sizeof(exitNames) / sizeof(const char *)); i++)
-										{
-											if(strstr(name, exitNames[i]))
-											{
-												//msg("  " EAFORMAT " Exception\n", CodeStartEA);
-												isExpected = TRUE;
-												break;
-											}
-										}
-									}
-								}
-							}
-							// Drop through to default for "call"
-
-							// Allow if function has attribute "noreturn"
-							default:
-							{
-								if(f->flags & FUNC_NORET)
-								{
-									//msg("  " EAFORMAT " NORETURN\n", tailEA);
-									isExpected = TRUE;
-								}
-							}
-							break;
-						};
-					}
-
-					if(!isExpected)
-					{
-                        qstring name;
-                        if (get_name(&name, f->start_ea) <= 0)
-                            name = "unknown";
-						msg(EAFORMAT " \"%s\" problem? <click me>\n", tailEa, name.c_str());
-						//msg("  T: %d\n", cmd.itype);
-
-						#ifdef LOG_FILE
-						Log(s_logFile, EAFORMAT " \"%s\" problem? <click me>\n", tailEa, name);
-						//Log(s_hLogFile, "  T: %d\n", cmd.itype);
-						#endif
-					}
-				}
-
-				// Update current look position to the end of this function
-				current = tailEa; // Advance to end of the function -1 location (for a follow up "next_head()")
-				result = TRUE;
-			}
-		}
-	}
-
-	return(result);
-}
-
-
-// Process the gap from the end of one function to the start of the next
-// looking for missing functions in between.
-static void processFuncGap(ea_t start, UINT size)
-{
-    s_currentAddress = start;
-	ea_t end = (start + size);
-	#ifdef LOG_FILE
-	Log(s_logFile, "\nS: " EAFORMAT ", E: " EAFORMAT " ==== PFG START ====\n", start, end);
-	#endif
-	#ifdef VBDEV
-	msg(EAFORMAT " " EAFORMAT " ==== Gap\n", start, end);
-	#endif
-
-	// Walk backwards at the end to trim alignments
-	auto_wait();
-	ea_t ea = prev_head(end, start);
-	if (ea == BADADDR)
-		return;
-	else
-	{
-		while (ea >= start)
-		{
-			flags_t flags = get_full_flags(ea);
-			if (isAlignByte(flags, NULL) || is_align(flags))
-			{
-				ea = prev_head(ea, start);
-				if (ea == BADADDR)
-					return;
-			}
-			else
-			{
-				end = next_head(ea, end);
-				// Can fail in some odd circumstances, so reset it back to whole gap size
-				if (end == BADADDR)
-					end = (start + size);
-				break;
-			}
-		};
-	}
-
-    // Traverse gap
-	ea_t codeStart = BADADDR;
-	ea = start;
-    while(ea < end)
-    {
-		// Info flags for this address
-        flags_t flags = get_full_flags(ea);
-		#ifdef LOG_FILE
-		Log(s_logFile, "  C: " EAFORMAT ", F: %08X, \"%s\".\n", ea, flags, getDisasmText(ea));
-		#endif
-		#ifdef VBDEV
-		qstring disStr;
-		getDisasmText(ea, disStr);
-		msg(" C: " EAFORMAT ", F: %08X, \"%s\".\n", ea, flags, disStr.c_str());
-		#endif
-
-		if(ea < start)
-		{
-			#ifdef LOG_FILE
-			Log(s_logFile, "**** Out of start range! " EAFORMAT " " EAFORMAT " " EAFORMAT " ****\n", ea, start, end);
-			#endif
-			return;
-		}
-        else
-		if(ea > end)
-		{
-			#ifdef LOG_FILE
-			Log(s_logFile, "**** Out of end range! " EAFORMAT " " EAFORMAT " " EAFORMAT " ****\n", ea, start, end);
-			#endif
-			return;
-		}
-
-		// Skip over "align" blocks.
-		// #1 we will typically see more of these then anything else
-		if(isAlignByte(flags, NULL) || is_align(flags))
-		{
-			// Function between code start?
-			if(codeStart != BADADDR)
-			{
-				#ifdef LOG_FILE
-				Log(s_logFile, "  " EAFORMAT " Trying function #1\n", codeStart);
-				#endif
-				#ifdef VBDEV
-				msg(">" EAFORMAT " Trying function #1\n", codeStart);
-				#endif
-				tryFunction(codeStart, end, ea);
-			}
-
-			codeStart = BADADDR;
-		}
-		else
-		// #2 case, we'll typically see data
-		if(is_data(flags))
-		{
-			// Function between code start?
-			if(codeStart != BADADDR)
-			{
-				#ifdef LOG_FILE
-				Log(s_logFile, "  " EAFORMAT " Trying function #2\n", codeStart);
-				#endif
-				#ifdef VBDEV
-				msg(">" EAFORMAT " Trying function #2\n", codeStart);
-				#endif
-				tryFunction(codeStart, end, ea);
-			}
-
-			codeStart = BADADDR;
-		}
-		else
-		// Hit some code?
-		if(is_code(flags))
-		{
-			// Yes, mark the start of a possible code block
-			if(codeStart == BADADDR)
-			{
-				codeStart  = ea;
-
-				#ifdef LOG_FILE
-				Log(s_logFile, "  " EAFORMAT " Trying function #3, assumed func start\n", codeStart);
-				#endif
-				#ifdef VBDEV
-				msg(">" EAFORMAT " Trying function #3, assumed func start\n", codeStart);
-				#endif
-				if(tryFunction(codeStart, end, ea))
-					codeStart = BADADDR;
-			}
-		}
-		else
-		// Undefined?
-		// Usually 0xCC align bytes
-		if(is_unknown(flags))
-		{
-			#ifdef LOG_FILE
-			Log(s_logFile, "  C: " EAFORMAT " , Unknown type.\n", ea);
-			#endif
-			#ifdef VBDEV
-			msg("  C: " EAFORMAT ", Unknown type.\n", ea);
-			#endif
-			codeStart = BADADDR;
-		}
-		else
-		{
-			#ifdef LOG_FILE
-			Log(s_logFile, "  " EAFORMAT " ** unknown data type! **\n", ea);
-			#endif
-			#ifdef VBDEV
-			msg("  " EAFORMAT " ** unknown data type! **\n", ea);
-			#endif
-			codeStart = BADADDR;
-		}
-
-		// Next item
-		auto_wait();
-		ea_t nextEa = BADADDR;
-		if(ea != BADADDR)
-		{
-			nextEa = next_head(ea, end);
-			if(nextEa != BADADDR)
-				ea = nextEa;
-		}
-
-		if((nextEa == BADADDR) || (ea == BADADDR))
-		{
-			// If have code and at the end, try a function from the start
-			if(codeStart != BADADDR)
-			{
-				#ifdef LOG_FILE
-				Log(s_logFile, "  " EAFORMAT " Trying function #4\n", codeStart);
-				#endif
-				#ifdef VBDEV
-				msg(">" EAFORMAT " Trying function #4\n", codeStart);
-				#endif
-				tryFunction(codeStart, end, ea);
-				auto_wait();
-			}
-
-			#ifdef LOG_FILE
-			Log(s_logFile, " Gap end: " EAFORMAT ".\n", ea);
-			#endif
-			#ifdef VBDEV
-			msg(" Gap end: " EAFORMAT ".\n", ea);
-			#endif
-
-            break;
-		}
-
-    }; // while(ea < start)
-}
-
-// ============================================================================
-
-const char PLUGIN_NAME[] = "ExtraPass";
-
-// Plug-in description block
-extern "C" ALIGN(16) plugin_t PLUGIN =
-{
-	IDP_INTERFACE_VERSION,	// IDA version plug-in is written for
-	PLUGIN_UNL,				// Plug-in flags
-	plugin_init,			// Initialization function
-	plugin_exit,	        // Clean-up function
-	plugin_run,	            // Main plug-in body
-	PLUGIN_NAME,	        // Comment - unused
-	PLUGIN_NAME,	        // As above - unused
-	PLUGIN_NAME,	        // Plug-in name shown in Edit->Plugins menu
-	NULL                    // Hot key to run the plug-in
-};
+
+#include "stdafx.h"
+#include <WaitBoxEx.h>
+#include <SegSelect.h>
+#include <IdaOgg.h>
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <malloc.h>
+
+#include "SegStream.h"
+#include "SegPipeline.h"
+#include "EmbeddedData.h"
+#include "FuncSeed.h"
+#include "PtrTables.h"
+#include "ItypeClass.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "ProblemList.h"
+#include "Census.h"
+#include "Padding.h"
+#include "EhTables.h"
+#include "Rtti.h"
+#include "GuardCF.h"
+#include "NoReturn.h"
+#include "Toolchain.h"
+#include "Incremental.h"
+#include "complete_ogg.h"
+
+//#define VBDEV
+//#define LOG_FILE
+
+// Count of eSTATE_PASS_1 unknown byte gather passes
+#define UNKNOWN_PASSES 8
+
+// eSTATE_PASS_4 gap scoring: max heads sampled per gap, spread over this many even spans of it;
+// and minimal tryFunction() attempts per gap visit
+#define GAP_SCAN_HEADS 512
+#define GAP_SCAN_SPANS 8
+#define GAP_MIN_BUDGET 8
+
+// Pass time quantum, seconds; the break and deadline checks, and the UI, only run between quanta
+#define PASS_QUANTUM 0.05
+
+// Deadline mode default pass throughputs in segment bytes per second, until measured on the IDB
+#define PASS_COUNT 4
+static const double DEFAULT_PASS_RATES[PASS_COUNT] = { 2.0e6, 4.0e6, 1.0e6, 0.5e6 };
+
+// x86 hack for speed in alignment value searching
+// Defs from IDA headers, not supposed to be exported but need to because some cases not covered
+// by SDK accessors, etc.
+#define MS_VAL  0x000000FFLU	// Mask for byte value
+#define FF_IVL  0x00000100LU	// Byte has value ?
+#define FF_REF  0x00001000LU	// has references
+#define FF_0OFF 0x00500000LU	// Offset?
+
+/*
+    1st pass. Look for " dd " without "offset". Finds missing code
+    For each found:
+        1. Find the extents of the block and undefine it
+        2. Analise it for code
+
+    2nd pass. Look for " dw " without "offset". Finds missing code
+    Same as above.
+
+    3nd pass. Look for " db " without "offset". Finds missing code
+    Same as above.
+
+    4th pass. Look at gaps between functions. Finds missing functions
+    If code is found try to make a function of it.
+*/
+
+
+// Process states
+enum eSTATES
+{
+    eSTATE_INIT,	// Initialize
+	eSTATE_START,	// Start processing
+
+    eSTATE_PASS_1,	// Find unknown data in code space
+    eSTATE_PASS_2,	// Find missing "align" blocks
+	eSTATE_PASS_3,	// Find lost code instructions
+	eSTATE_PASS_4,  // Find missing functions part
+
+    eSTATE_FINISH,  // Done
+
+    eSTATE_EXIT,
+};
+
+// Profiler names of the above
+static const char * const stateNames[] =
+{
+	"Init", "Start", "Unknown data", "Align blocks", "Missing code", "Missing functions", "Finish", "Exit",
+};
+
+static const char SITE_URL[] = { "http://www.macromonkey.com/bb/index.php/topic,21.0.html" };
+
+
+// UI options bit flags
+// *** Must be same sequence as check box options
+const static WORD OPT_DATATOBYTES = (1 << 0);
+const static WORD OPT_ALIGNBLOCKS = (1 << 1);
+const static WORD OPT_MISSINGCODE = (1 << 2);
+const static WORD OPT_MISSINGFUNC = (1 << 3);
+
+// Function gap container, ordered by score for the missing function pass
+struct GAPNODE
+{
+	ea_t start;
+	UINT size;
+	UINT score;
+	UINT budget;
+
+	bool operator<(const GAPNODE &rhs) const { return(score < rhs.score); }
+};
+
+// Deadline mode time slice and coverage accounting per pass
+struct PASSINFO
+{
+	double rate;	// Throughput, segment bytes per second
+	double done;	// Segment bytes covered
+	double total;	// Segment bytes to cover
+	TIMESTAMP time;	// Run time, over all segments
+	UINT quanta;	// runPass() calls
+};
+
+typedef std::unordered_set<ea_t> ADDRSET;
+typedef std::vector<GAPNODE> GAPLIST;
+
+// === Function Prototypes ===
+static void showEndStats();
+static void nextState();
+static void buildGapList(BOOL report);
+static BOOL seedNoReturn(BOOL first, TIMESTAMP quantumEnd);
+static BOOL seedGuardTable(BOOL first, TIMESTAMP quantumEnd);
+static BOOL seedEhFunclets(BOOL first, TIMESTAMP quantumEnd);
+static BOOL seedCallTargets(BOOL first, TIMESTAMP quantumEnd);
+static BOOL seedRelocTargets(BOOL first, TIMESTAMP quantumEnd);
+static BOOL seedPointerTables(BOOL first, TIMESTAMP quantumEnd);
+static BOOL seedVtables(BOOL first, TIMESTAMP quantumEnd);
+static BOOL seedStubClusters(BOOL first, TIMESTAMP quantumEnd);
+static void beginPass();
+static void endPass();
+static ea_t processFuncGap(ea_t start, UINT size, UINT budget);
+static void tryAlignRun(ea_t startAddress, UINT alignByteCount, UINT alignment);
+static void selectProfile(Toolchain::FAMILY family);
+static void startResident();
+static bool idaapi is_data(flags_t flags, void *ud);
+
+// eSTATE_PASS_2 align padding run finder, run by a SegPipeline.
+// The scan workers match the padding unit at every byte of a window (see Padding::matchAll), the merge
+// thread then gathers the runs of one kind, a fill byte or NOPs, that end on the profile's alignment
+// boundary; runs are carried over windows.
+class AlignRunBase : public WindowClassifier
+{
+public:
+	virtual void reset(BOOL is64) = 0;
+
+	// Heap instances keep their SpscQueue's cache line alignment, plain "new" doesn't before C++17
+	void *operator new(size_t size)
+	{
+		if (void *p = _aligned_malloc(size, 64))
+			return(p);
+		throw std::bad_alloc();
+	}
+	void operator delete(void *p) { _aligned_free(p); }
+};
+
+template<class PROFILE> class AlignRunClassifier : public AlignRunBase
+{
+public:
+	AlignRunClassifier() : m_runStart(BADADDR), m_runCount(0), m_runKind(Padding::NONE), m_skip(0), m_is64(FALSE) {}
+
+	void reset(BOOL is64)
+	{
+		m_runStart = BADADDR;
+		m_runCount = m_skip = 0;
+		m_runKind = Padding::NONE;
+		m_is64 = is64;
+		m_runs.reset(PIPELINE_RESULT_QUEUE);
+		m_stale.clear();
+	}
+
+	void scan(FLAGWINDOW &window)
+	{
+		std::vector<BYTE> bytes;
+		Padding::packWindow(window, bytes);
+		window.scan.resize(window.flags.size());
+		Padding::matchAll(bytes.data(), (UINT) window.flags.size(), m_is64, window.scan.data());
+	}
+
+	void classify(const FLAGWINDOW &window)
+	{
+		// Stale ranges behind the open run are done with
+		ea_t keep = (m_runCount ? m_runStart : window.start);
+		m_stale.erase(std::remove_if(m_stale.begin(), m_stale.end(), [keep](const range_t &range) { return(range.end_ea <= keep); }), m_stale.end());
+
+		// Past a NOP that crossed into this window
+		ea_t ea = std::min((ea_t) (window.start + m_skip), window.ownedEnd);
+		m_skip = 0;
+		while (ea < window.ownedEnd)
+		{
+			// Only the profile's kinds, zero fill is only taken outside of data items.
+			// NOPs and fillers not on code or inside other items, compilers put them in function bodies to align loop heads.
+			BYTE unit = window.scan[(size_t) (ea - window.start)];
+			Padding::KIND kind = Padding::unitKind(unit);
+			UINT length = Padding::unitLength(unit);
+			flags_t flags = window[ea];
+			if (!(PROFILE::FILLS & (1 << kind)) || ((kind == Padding::FILL_ZERO) && is_data(flags)) || (((kind == Padding::NOP) || (kind == Padding::FILLER)) && (is_code(flags) || is_tail(flags))))
+				length = 0;
+
+			if (length == 0)
+			{
+				endRun();
+				ea++;
+				continue;
+			}
+
+			// A fill run continues in the next window, or the next chunk, on its own
+			if ((kind != Padding::NOP) && (kind != Padding::FILLER))
+				length = (UINT) std::min((ea_t) length, (ea_t) (window.ownedEnd - ea));
+
+			if (!m_runCount || (kind != m_runKind))
+			{
+				endRun();
+				m_runStart = ea;
+				m_runKind = kind;
+			}
+			m_runCount += length;
+			ea += length;
+		}
+		if (ea > window.ownedEnd)
+			m_skip = (UINT) (ea - window.ownedEnd);
+
+		if (window.last)
+			endRun();
+	}
+
+	// Runs over bytes the main thread edited since are off the stale snapshot
+	void invalidate(const range_t &range)
+	{
+		m_stale.push_back(range);
+	}
+
+	void apply()
+	{
+		ALIGNRUN run;
+		while (m_runs.pop(run))
+			tryAlignRun(run.start, run.count, PROFILE::ALIGN);
+	}
+
+private:
+	struct ALIGNRUN
+	{
+		ea_t start;
+		UINT count;
+	};
+
+	void endRun()
+	{
+		if (m_runCount && (((m_runStart + m_runCount) & (PROFILE::ALIGN - 1)) == 0) && !isStale(m_runStart, (m_runStart + m_runCount)))
+		{
+			ALIGNRUN run = { m_runStart, m_runCount };
+			emit(m_runs, run);
+		}
+		m_runCount = 0;
+	}
+
+	BOOL isStale(ea_t start, ea_t end) const
+	{
+		for (std::vector<range_t>::const_iterator it = m_stale.begin(); it != m_stale.end(); ++it)
+		{
+			if ((it->start_ea < end) && (start < it->end_ea))
+				return(TRUE);
+		}
+		return(FALSE);
+	}
+
+	SpscQueue<ALIGNRUN> m_runs;		// Merge thread to main thread
+	std::vector<range_t> m_stale;	// Merge thread's
+	ea_t m_runStart;
+	UINT m_runCount;
+	Padding::KIND m_runKind;
+	UINT m_skip;
+	BOOL m_is64;
+};
+
+// eSTATE_PASS_3 unknown byte range gatherer, run by a SegPipeline; ranges are carried over windows.
+// Each window's ranges get queued for code with one auto-analyzer range mark apiece.
+class UnknownRangeClassifier : public WindowClassifier
+{
+public:
+	UnknownRangeClassifier() : m_rangeStart(BADADDR), m_queued(0) {}
+
+	void reset()
+	{
+		m_rangeStart = BADADDR;
+		m_queued = 0;
+		m_ranges.reset(PIPELINE_RESULT_QUEUE);
+	}
+
+	void classify(const FLAGWINDOW &window)
+	{
+		for (ea_t ea = window.start; ea < window.ownedEnd; ea++)
+		{
+			// Unknown, and has a value
+			flags_t flags = window[ea];
+			if (is_unknown(flags) && (flags & FF_IVL))
+			{
+				if (m_rangeStart == BADADDR)
+					m_rangeStart = ea;
+			}
+			else
+				endRange(ea);
+		}
+
+		if (window.last)
+			endRange(window.ownedEnd);
+	}
+
+	void apply()
+	{
+		range_t range;
+		while (m_ranges.pop(range))
+		{
+			// Leave out pinned embedded data
+			ea_t ea = range.start_ea;
+			range_t pin;
+			while ((ea < range.end_ea) && EmbeddedData::nextPin(ea, pin) && (pin.start_ea < range.end_ea))
+			{
+				if (pin.start_ea > ea)
+					mark(ea, pin.start_ea);
+				ea = std::max(ea, pin.end_ea);
+			}
+			if (ea < range.end_ea)
+				mark(ea, range.end_ea);
+		}
+	}
+
+	UINT64 queued() const { return(m_queued); }
+
+private:
+	void mark(ea_t start, ea_t end)
+	{
+		auto_mark_range(start, end, AU_CODE);
+		m_queued += (end - start);
+	}
+
+	void endRange(ea_t end)
+	{
+		if (m_rangeStart != BADADDR)
+		{
+			emit(m_ranges, range_t(m_rangeStart, end));
+			m_rangeStart = BADADDR;
+		}
+	}
+
+	SpscQueue<range_t> m_ranges;	// Merge thread to main thread
+	ea_t m_rangeStart;
+	UINT64 m_queued;
+};
+
+// eSTATE_PASS_4 direct call and jump target harvester.
+// Collects the targets of the 5 byte "call rel32" (E8) and "jmp rel32" (E9) code heads in functions;
+// the ones that land outside of any function in a code segment become function seeds.
+// Orphan code heads are left to the gap walk, an intra-body jump there would split its function.
+class CallTargetClassifier : public WindowClassifier
+{
+public:
+	void reset()
+	{
+		m_refs.clear();
+		m_seeds.clear();
+	}
+
+	void classify(const FLAGWINDOW &window)
+	{
+		for (ea_t ea = window.start; (ea < window.ownedEnd) && ((ea + 5) < window.end); ea++)
+		{
+			flags_t flags = window[ea];
+			if (!is_code(flags))
+				continue;
+
+			BYTE opcode = window.byteAt(ea);
+			if ((opcode != 0xE8) && (opcode != 0xE9))
+				continue;
+
+			// Must be the whole instruction, no prefixes and nothing more
+			if (!is_tail(window[ea + 1]) || !is_tail(window[ea + 4]) || is_tail(window[ea + 5]))
+				continue;
+
+			UINT32 rel = 0;
+			for (int i = 4; i >= 1; i--)
+				rel = ((rel << 8) | window.byteAt(ea + i));
+			REF ref = { (ea_t) (ea + 5 + (INT32) rel), ea };
+			m_refs.push_back(ref);
+		}
+
+		std::sort(m_refs.begin(), m_refs.end());
+	}
+
+	void apply()
+	{
+		ea_t lastSeed = BADADDR;
+		for (std::vector<REF>::iterator it = m_refs.begin(); it != m_refs.end(); ++it)
+		{
+			if ((it->target == lastSeed) || !get_fchunk(it->source))
+				continue;
+
+			flags_t flags = get_flags(it->target);
+			if (is_func(flags) || is_tail(flags) || is_data(flags) || get_fchunk(it->target) || EmbeddedData::isPinned(it->target))
+				continue;
+
+			segment_t *seg = getseg(it->target);
+			if (seg && ((seg->perm & SEGPERM_EXEC) || (seg->type == SEG_CODE)))
+			{
+				FUNCNODE seed = { it->target, 0 };
+				m_seeds.push_back(seed);
+				lastSeed = it->target;
+			}
+		}
+		m_refs.clear();
+	}
+
+	FUNCLIST &seeds() { return(m_seeds); }
+
+private:
+	struct REF
+	{
+		ea_t target, source;
+
+		bool operator<(const REF &other) const { return(target < other.target); }
+	};
+
+	std::vector<REF> m_refs;
+	FUNCLIST m_seeds;
+};
+
+// === Data ===
+// Run options, from the options dialog; kept as the defaults for the next run
+struct RUNOPTIONS
+{
+	BOOL doDataToBytes;
+	BOOL doAlignBlocks;
+	BOOL doMissingCode;
+	BOOL doMissingFunc;
+	WORD audioAlertWhenDone;
+	WORD profile;
+	WORD resident;		// Background incremental mode when done, see Incremental
+	UINT funcBudget;	// Function attempts, zero for no limit
+	UINT streamMemory;	// Peak stream window memory, MB
+
+	RUNOPTIONS() : doDataToBytes(TRUE), doAlignBlocks(TRUE), doMissingCode(TRUE), doMissingFunc(TRUE), audioAlertWhenDone(1), profile(0), resident(0), funcBudget(0), streamMemory(STREAM_MEMORY_MB) {}
+};
+
+// Run options as saved in the IDB, tagged so another build's layout isn't loaded; bump the version on RUNOPTIONS changes
+#define RUNOPTIONS_VERSION 1
+struct SAVEDOPTIONS
+{
+	UINT version;
+	UINT size;
+	RUNOPTIONS options;
+};
+
+// A pass's position in the segment being worked
+struct PASSCURSOR
+{
+	segment_t *seg;
+	ea_t start, end;	// Segment range
+	ea_t current, last;
+	BOOL active;		// Pass begun, not yet accounted
+	BOOL skip;			// Nothing for the pass per the census
+	TIMESTAMP sliceEnd;	// Deadline mode pass time slice end
+
+	PASSCURSOR() : seg(NULL), start(0), end(0), current(0), last(0), active(FALSE), skip(FALSE), sliceEnd(0) {}
+
+	void setSegment(segment_t *segment) { setRange(segment, segment->start_ea, segment->end_ea); }
+	void setRange(segment_t *segment, ea_t rangeStart, ea_t rangeEnd)
+	{
+		seg = segment;
+		start = rangeStart;
+		end = rangeEnd;
+	}
+	void rewind() { current = last = start; }
+};
+
+// Stub cluster hash class, see seedStubClusters()
+struct STUBCLASS
+{
+	UINT size;
+	std::vector<ea_t> members;
+};
+
+// eSTATE_PASS_4 seed stage progress
+struct SEEDSTATE
+{
+	UINT stage;
+	BOOL first;
+	BOOL tablesSwept, ehSwept, guardSwept, vtablesSwept, noretBuilt;
+	int  tableSegIndex;
+	// The stage's place between steps
+	BOOL creating;		// Gathered, creating "seeds" a batch per step
+	FUNCLIST seeds;
+	size_t nextSeed;
+	UINT created, found;
+	UINT phase;
+	size_t index;
+	ea_t ea;
+	std::unordered_map<UINT64, STUBCLASS> stubHashes;
+	std::vector<STUBCLASS> stubClasses;
+
+	SEEDSTATE() : stage(0), first(TRUE), tablesSwept(FALSE), ehSwept(FALSE), guardSwept(FALSE), vtablesSwept(FALSE), noretBuilt(FALSE), tableSegIndex(0) { beginStage(); }
+	void begin() { stage = 0; beginStage(); }
+	void beginStage()
+	{
+		first = TRUE;
+		creating = FALSE;
+		seeds.clear();
+		nextSeed = 0;
+		created = found = phase = 0;
+		index = 0;
+		ea = BADADDR;
+		stubHashes.clear();
+		stubClasses.clear();
+	}
+	void resetSweeps() { tablesSwept = ehSwept = guardSwept = vtablesSwept = noretBuilt = FALSE; }
+};
+
+// Everything a run works with, down to its own profile instance of the passes.
+// The plugin runs the one "s_run" points to, and the NoReturn, EmbeddedData and EhTables state is
+// module wide, so only one context is worked at a time.
+struct RUNCONTEXT
+{
+	RUNOPTIONS options;
+	PASSCURSOR cursor;
+	SEEDSTATE seed;
+	eSTATES state;
+	SegSelect::segments *chosen;
+	TIMESTAMP startTime, stepTime, deadline;
+	BOOL isBreak;
+	BOOL background;	// Background incremental run: quiet, and no seed stages
+	std::vector<range_t> segments;	// Processed
+	#ifdef LOG_FILE
+	FILE *logFile;
+	#endif
+	size_t startFuncCount;
+	int  pass1Loops;
+	GAPLIST gapList;
+	size_t gapCount;
+	UINT64 gapBytes;
+	UINT funcAttempts;
+	PASSINFO passInfo[PASS_COUNT];
+	// Stats
+	UINT unknownDataCount;
+	UINT alignFixes;
+	UINT codeFixes;
+	// Streams and their classifiers
+	SegStream segStream;
+	SegPipeline pipeline;
+	CensusClassifier census;
+	UnknownRangeClassifier unknownRanges;
+	PointerTableClassifier pointerTables;
+	VtableClassifier vtables;
+	CallTargetClassifier callTargets;
+	// Toolchain profile instance of the passes, see selectProfile()
+	Toolchain::FAMILY family;
+	AlignRunBase *alignRuns;
+	BOOL (*isPaddingHead)(ea_t ea, flags_t flags, ea_t end);
+	UINT (*scoreFuncGap)(ea_t start, ea_t end, UINT &budget);
+
+	RUNCONTEXT() : state(eSTATE_INIT), chosen(NULL), startTime(0), stepTime(0), deadline(0), isBreak(FALSE), background(FALSE),
+		#ifdef LOG_FILE
+		logFile(NULL),
+		#endif
+		startFuncCount(0), pass1Loops(0), gapCount(0), gapBytes(0), funcAttempts(0), unknownDataCount(0), alignFixes(0), codeFixes(0),
+		family(Toolchain::UNKNOWN), alignRuns(NULL), isPaddingHead(NULL), scoreFuncGap(NULL)
+	{
+		memset(passInfo, 0, sizeof(passInfo));
+	}
+
+	~RUNCONTEXT()
+	{
+		pipeline.end();
+		delete alignRuns;
+	}
+};
+
+static RUNCONTEXT s_mainRun;
+static RUNCONTEXT *s_run = &s_mainRun;
+
+// eSTATE_PASS_4 function seed stages, run in order before the gap walk.
+// Each is called with "first" set on its first step, returns TRUE while it has more to do.
+// A step works until "quantumEnd", or a bounded amount (a stream window, a FuncSeed batch).
+typedef BOOL (*SEEDSTAGE)(BOOL first, TIMESTAMP quantumEnd);
+static const SEEDSTAGE seedStages[] =
+{
+	seedNoReturn,
+	seedEhFunclets,
+	seedCallTargets,
+	seedRelocTargets,
+	seedVtables,
+	seedPointerTables,
+	seedStubClusters,
+};
+#define SEED_STAGE_COUNT (sizeof(seedStages) / sizeof(seedStages[0]))
+
+// Options dialog
+static const char optionDialog[] =
+{
+	"BUTTON YES* Continue\n" // 'Continue' instead of 'okay'
+
+	// Help body
+	"HELP\n"
+	"\"ExtraPass PlugIn\""
+	"An IDA Pro Win32 x86 executable clean up plugin, by Sirmabus\n\n"
+
+	"This plugin does an \"extra pass\" to help fix and cleanup the IDB.\n"
+	"It can find tens of thousands missing functions and alignment blocks making\n"
+	"your IDB more complete and easier to reverse.\n\n"
+
+	"It actually does essentially five processing steps:\n"
+	"1. Convert stray code section values to \"unknown\".\n"
+	"2. Fix missing \"align\" blocks.\n"
+	"3. Fix missing code bytes.\n"
+	"4. Locate and fix missing/undefined functions.\n\n"
+
+	"It's intended for, and only tested on typical MSVC and Intel complied Windows\n"
+	"32bit binary executables but it might still be helpful on Delphi/Borland and\n"
+	"other complied targets.\n"
+	"For best results, run the plugin at least two times.\n"
+	"Will not work well with Borland(r) and other targets that has data mixed with code in the same space.\n"
+	"See \"ExtraPass.txt\" for more help.\n\n"
+	"Forum: http://www.macromonkey.com/bb/\n"
+	"ENDHELP\n"
+
+	// Title
+	"ExtraPass Plugin\n"
+
+	// Message text
+	"Version %Aby Sirmabus\n"
+    "<#Click to open site.#www.macromonkey.com:k:2:1::>\n\n"
+
+	"Choose processing steps:\n"
+
+	// checkbox -> s_wDoDataToBytes
+	"<#Scan the entire code section converting all unknown DD,DW,DB data declarations to\n"
+	"unknown bytes, to be reexamined as possible code, functions, and alignment blocks\n"
+	"in the following passes.#1 Convert unknown data.                                     :C>\n"
+
+	// checkbox -> s_wDoAlignBlocks
+	"<#Fix missing \"align xx\" blocks.#2 Fix align blocks.:C>\n"
+
+	// checkbox -> s_wDoMissingCode
+	"<#Fix lost code instructions.#3 Fix missing code.:C>\n"
+
+	// checkbox -> s_wDoMissingFunc
+	"<#Fix missing/undeclared functions.#4 Fix missing functions.:C>>\n"
+
+	// checkbox -> s_wAudioAlertWhenDone
+	"<#Play sound on completion.#Play sound on completion.                                     :C>>\n"
+
+	// checkbox -> options.profile
+	"<#Time the steps and their hot calls, reporting a call tree profile when done.\n"
+	"Also written in collapsed stack (flame graph) form to \"<IDB>.profile.txt\".#Profile hot paths.:C>>\n"
+
+	// checkbox -> options.resident
+	"<#Stay resident when done, redoing steps 2 to 4 on the ranges edited afterwards, in\n"
+	"short time slices while IDA is idle. Until the plugin is run again.#Background incremental mode.:C>>\n"
+
+	// number -> options.funcBudget
+	"<#Max function creation attempts for step 4, zero for no limit.\n"
+	"Function gaps are tried in order of their likely value, best first.#Function attempt budget:D:10:10::>\n"
+
+	// string -> timeLimit
+	"<#Stop cleanly when out of time, dividing it up over the chosen steps.\n"
+	"Seconds (\"600\", \"10m\", \"2h\"), or a local clock time (\"23:30\"). Empty for no limit.#Time limit:q:16:16::>\n"
+
+	// number -> streamMemory
+	"<#Peak memory for the segment snapshot windows the steps stream through.\n"
+	"Lower it for very large segments on low memory machines.#Window memory (MB):D:6:6::>\n"
+
+
+	"<#Choose the code segment(s) to process.\nElse will use the first CODE segment by default.\n#Choose Code Segments:B:1:8::>\n"
+    "                      "
+};
+
+// Checks and handles if break key pressed; returns TRUE on break.
+static BOOL checkBreak()
+{
+    if (!s_run->isBreak)
+    {
+        if (WaitBox::isUpdateTime())
+        {
+            if (WaitBox::updateAndCancelCheck())
+            {
+                msg("\n*** Aborted ***\n\n");
+
+                // Show stats then directly to exit
+                endPass();
+                showEndStats();
+                s_run->state = eSTATE_EXIT;
+                s_run->isBreak = TRUE;
+                return(TRUE);
+            }
+        }
+    }
+    return(s_run->isBreak);
+}
+
+// Parse a time limit string to seconds from now, returns 0 for none and -1 if invalid.
+// Takes plain or "m"/"h" suffixed seconds, or an absolute "HH:MM[:SS]" local clock time.
+static double parseTimeLimit(const char *text)
+{
+	while (isspace((BYTE) *text)) text++;
+	if (!*text)
+		return(0);
+
+	int hour, minute, second = 0;
+	if (sscanf(text, "%d:%d:%d", &hour, &minute, &second) >= 2)
+	{
+		if ((hour < 0) || (hour > 23) || (minute < 0) || (minute > 59) || (second < 0) || (second > 59))
+			return(-1);
+
+		time_t now = time(NULL);
+		struct tm when = *localtime(&now);
+		when.tm_hour = hour; when.tm_min = minute; when.tm_sec = second;
+		time_t then = mktime(&when);
+		// Already past that time today, so means tomorrow
+		if (then <= now)
+			then += (24 * 60 * 60);
+		return(difftime(then, now));
+	}
+
+	double value;
+	char unit = 's';
+	if ((sscanf(text, "%lf %c", &value, &unit) < 1) || (value <= 0))
+		return(-1);
+	switch (tolower(unit))
+	{
+		case 's': return(value);
+		case 'm': return(value * 60);
+		case 'h': return(value * (60 * 60));
+	};
+	return(-1);
+}
+
+static BOOL isPassEnabled(int pass)
+{
+	switch (pass)
+	{
+		case 0: return(s_run->options.doDataToBytes);
+		case 1: return(s_run->options.doAlignBlocks);
+		case 2: return(s_run->options.doMissingCode);
+		case 3: return(s_run->options.doMissingFunc);
+	};
+	return(FALSE);
+}
+
+// Census work bits a pass has to look at, including what the enabled passes before it can leave behind.
+// Zero for passes not limited by the census.
+static UINT passWork(int pass)
+{
+	switch (pass)
+	{
+		case 0: return(CW_DATA);
+		case 1: return(CW_PADDING | (s_run->options.doDataToBytes ? CW_DATA : 0));
+		case 2: return(CW_UNKNOWN | (s_run->options.doDataToBytes ? CW_DATA : 0) | (s_run->options.doAlignBlocks ? CW_PADDING : 0));
+	};
+	return(0);
+}
+
+// Load and save measured pass throughputs with the IDB, so deadline slices improve run to run
+static void loadPassRates()
+{
+	double rates[PASS_COUNT];
+	netnode node(NETNODE_NAME);
+	BOOL haveRates = ((node != BADNODE) && (node.supval(0, rates, sizeof(rates), 'R') == sizeof(rates)));
+
+	for (int i = 0; i < PASS_COUNT; i++)
+	{
+		s_run->passInfo[i].rate = ((haveRates && (rates[i] > 0)) ? rates[i] : DEFAULT_PASS_RATES[i]);
+		s_run->passInfo[i].done = s_run->passInfo[i].total = s_run->passInfo[i].time = 0;
+		s_run->passInfo[i].quanta = 0;
+	}
+}
+
+static void savePassRates()
+{
+	double rates[PASS_COUNT];
+	for (int i = 0; i < PASS_COUNT; i++)
+		rates[i] = s_run->passInfo[i].rate;
+
+	netnode node(NETNODE_NAME, 0, true);
+	node.supset(0, rates, sizeof(rates), 'R');
+}
+
+// Load and save the dialog's run options with the IDB, for the next run and unattended ones
+static void loadRunOptions()
+{
+	SAVEDOPTIONS saved;
+	netnode node(NETNODE_NAME);
+	if ((node != BADNODE) && (node.supval(0, &saved, sizeof(saved), 'O') == sizeof(saved)) && (saved.version == RUNOPTIONS_VERSION) && (saved.size == sizeof(RUNOPTIONS)))
+		s_run->options = saved.options;
+	else
+		s_run->options = RUNOPTIONS();
+}
+
+static void saveRunOptions()
+{
+	SAVEDOPTIONS saved;
+	saved.version = RUNOPTIONS_VERSION;
+	saved.size = sizeof(RUNOPTIONS);
+	saved.options = s_run->options;
+
+	netnode node(NETNODE_NAME, 0, true);
+	node.supset(0, &saved, sizeof(saved), 'O');
+}
+
+// Fraction of the current pass done on this segment
+static double passProgress()
+{
+	double segSize = (double) (s_run->cursor.end - s_run->cursor.start);
+	double done = ((s_run->cursor.current > s_run->cursor.start) ? (double) (std::min(s_run->cursor.current, s_run->cursor.end) - s_run->cursor.start) : 0.0);
+
+	double progress = 1.0;
+	switch (s_run->state)
+	{
+		case eSTATE_PASS_1:
+		progress = ((s_run->pass1Loops + (done / segSize)) / UNKNOWN_PASSES);
+		break;
+
+		case eSTATE_PASS_2:
+		progress = (done / segSize);
+		break;
+
+		// First half queuing the unknown ranges, second half trying what's left
+		case eSTATE_PASS_3:
+		if (s_run->pipeline.active())
+			progress = (((double) (s_run->pipeline.position() - s_run->cursor.start) / segSize) * 0.5);
+		else
+			progress = (0.5 + ((done / segSize) * 0.5));
+		break;
+
+		case eSTATE_PASS_4:
+		if (s_run->gapBytes)
+		{
+			UINT64 left = 0;
+			for (GAPLIST::iterator it = s_run->gapList.begin(); it != s_run->gapList.end(); ++it)
+				left += it->size;
+			progress = (1.0 - ((double) left / (double) s_run->gapBytes));
+		}
+		break;
+
+		default:
+		break;
+	};
+	return(std::min(std::max(progress, 0.0), 1.0));
+}
+
+// Pass start setup.
+// In deadline mode gives it a time slice proportional to its estimated share of the work left.
+static void beginPass()
+{
+	int pass = (s_run->state - eSTATE_PASS_1);
+	double segSize = (double) (s_run->cursor.end - s_run->cursor.start);
+	s_run->passInfo[pass].total += segSize;
+	s_run->cursor.active = TRUE;
+
+	// Nothing for it in the segment census?
+	UINT work = passWork(pass);
+	s_run->cursor.skip = (work && !s_run->census.hasWork(work));
+	if (s_run->cursor.skip && !s_run->background)
+		msg("Nothing to do per the census, skipped.\n");
+
+	// Stream only the census blocks with work
+	if (s_run->state == eSTATE_PASS_2)
+	{
+		s_run->alignRuns->reset(s_run->cursor.seg->is_64bit());
+		s_run->pipeline.begin(s_run->census.workRanges(work), *s_run->alignRuns, s_run->options.streamMemory);
+	}
+	else
+	if (s_run->state == eSTATE_PASS_3)
+	{
+		s_run->unknownRanges.reset();
+		s_run->pipeline.begin(s_run->census.workRanges(work), s_run->unknownRanges, s_run->options.streamMemory);
+	}
+	else
+	if (s_run->state == eSTATE_PASS_4)
+	{
+		// The seed stages are whole database sweeps, already done by the run before the background one
+		s_run->seed.begin();
+		if (s_run->background)
+			s_run->seed.stage = SEED_STAGE_COUNT;
+	}
+
+	if (s_run->deadline)
+	{
+		double cost = (segSize / s_run->passInfo[pass].rate);
+		double costLeft = cost;
+		for (int i = (pass + 1); i < PASS_COUNT; i++)
+		{
+			if (isPassEnabled(i))
+				costLeft += (segSize / s_run->passInfo[i].rate);
+		}
+		if (s_run->chosen)
+		{
+			for (SegSelect::segments::iterator it = s_run->chosen->begin(); it != s_run->chosen->end(); ++it)
+			{
+				for (int i = 0; i < PASS_COUNT; i++)
+				{
+					if (isPassEnabled(i))
+						costLeft += ((double) (*it)->size() / s_run->passInfo[i].rate);
+				}
+			}
+		}
+
+		TIMESTAMP now = getTimeStamp();
+		s_run->cursor.sliceEnd = (now + ((s_run->deadline - now) * (cost / costLeft)));
+	}
+}
+
+// Pass end, account the coverage and update its measured throughput
+static void endPass()
+{
+	if (!s_run->cursor.active)
+		return;
+	s_run->cursor.active = FALSE;
+
+	int pass = (s_run->state - eSTATE_PASS_1);
+	double covered = (passProgress() * (double) (s_run->cursor.end - s_run->cursor.start));
+	s_run->passInfo[pass].done += covered;
+	s_run->segStream.end();
+	s_run->pipeline.end();
+
+	// Skip measuring very short runs, mostly overhead
+	TIMESTAMP elapsed = (getTimeStamp() - s_run->stepTime);
+	if ((elapsed > 0.5) && (covered > 0))
+		s_run->passInfo[pass].rate = (covered / elapsed);
+
+	#ifdef BENCHMARK
+	if (!s_run->background)
+		Benchmark::passDone(pass, elapsed, covered);
+	#endif
+}
+
+// Deadline mode check; moves on to the next pass when the current one used up its time slice.
+// Returns TRUE when out of time and the run was stopped.
+static BOOL checkDeadline()
+{
+	if (s_run->deadline && s_run->cursor.active)
+	{
+		TIMESTAMP now = getTimeStamp();
+		if (now >= s_run->deadline)
+		{
+			msg("\n*** Deadline reached ***\n\n");
+			endPass();
+
+			// Account the segments that never got started
+			if (s_run->chosen)
+			{
+				for (SegSelect::segments::iterator it = s_run->chosen->begin(); it != s_run->chosen->end(); ++it)
+				{
+					for (int i = 0; i < PASS_COUNT; i++)
+						s_run->passInfo[i].total += (*it)->size();
+				}
+			}
+
+			s_run->gapList.clear();
+			savePassRates();
+			showEndStats();
+			s_run->state = eSTATE_EXIT;
+			return(TRUE);
+		}
+		else
+		if (now >= s_run->cursor.sliceEnd)
+		{
+			msg("Time slice used up at %.1f%%.\n", (passProgress() * 100.0));
+			endPass();
+			s_run->gapList.clear();
+			s_run->cursor.current = s_run->cursor.end;
+			nextState();
+		}
+	}
+	return(FALSE);
+}
+
+// Make and address range "unknown" so it can be set with something else
+static void makeUnknown(ea_t start, ea_t end)
+{
+   PROFILE_SCOPE("makeUnknown");
+   PROFILE_CALL("auto_wait", auto_wait());
+    //auto_mark_range(s_run->cursor.current, end, AU_UNK);
+    //do_unknown(start, (DOUNK_SIMPLE | DOUNK_NOTRUNC));
+
+   PROFILE_CALL("del_items", del_items(start, (DELIT_SIMPLE | DELIT_NOTRUNC), (end - start)));
+    PROFILE_CALL("auto_wait", auto_wait());
+}
+
+
+// === Passes ===
+// Each pass is a resumable task: it works items until "quantumEnd", keeping its place in the run
+// context, and returns TRUE while it has more to do. See runPass().
+
+// Find unknown data values in code
+//#define PASS1_DEBUG
+static BOOL runUnknownData(TIMESTAMP quantumEnd)
+{
+	PASSCURSOR &cursor = s_run->cursor;
+	do
+	{
+		if (cursor.skip || (cursor.current >= cursor.end))
+		{
+			#ifdef PASS1_DEBUG
+			msg("** Pass %d Unknowns: %u\n", s_run->pass1Loops, s_run->unknownDataCount);
+			#endif
+			if (cursor.skip || (++s_run->pass1Loops >= UNKNOWN_PASSES))
+				return(FALSE);
+			cursor.rewind();
+			continue;
+		}
+
+		// Value at this location data?
+		PROFILE_CALL("auto_wait", auto_wait());
+		flags_t flags = get_flags(cursor.current);
+		if (!is_data(flags) || is_align(flags))
+		{
+			// Advance to next data value, or the end which ever comes first
+			cursor.current = next_that(cursor.current, cursor.end, is_data, NULL);
+			continue;
+		}
+
+		#ifdef PASS1_DEBUG
+		msg(EAFORMAT",  F: %08X data\n", cursor.current, flags);
+		#endif
+		ea_t end = next_head(cursor.current, cursor.end);
+
+		// Handle an occasional over run case
+		if (end == BADADDR)
+		{
+			#ifdef PASS1_DEBUG
+			msg(EAFORMAT" **** abort end\n", cursor.current);
+			#endif
+			cursor.current = (cursor.end - 1);
+			continue;
+		}
+
+		// Skip if it has offset reference (most common occurrence)
+		BOOL bSkip = FALSE;
+		if (flags & FF_0OFF)
+		{
+			#ifdef PASS1_DEBUG
+			msg("  skip offset.\n");
+			#endif
+			bSkip = TRUE;
+		}
+		else
+		// Pinned, or referenced and recognized as embedded data (switch and index tables, constants)?
+		if (EmbeddedData::isPinned(cursor.current))
+			bSkip = TRUE;
+		else
+		if (flags & FF_REF)
+		{
+			EmbeddedData::TYPE type = EmbeddedData::recognize(cursor.current, end);
+			#ifdef PASS1_DEBUG
+			msg(EAFORMAT" embedded data type: %d\n", cursor.current, type);
+			#endif
+
+			// If it's byte access, assume it's a byte switch table
+			if (type == EmbeddedData::INDEX_TABLE)
+			{
+				// Just pinned, remaking it isn't a redefinition
+				EmbeddedData::ownEdits(TRUE);
+				makeUnknown(cursor.current, end);
+				// Step through making the array, and any bad size a byte
+				//for(ea_t i = s_eaCurrentAddress; i < eaEnd; i++){ doByte(i, 1); }
+				create_byte(cursor.current, (end - cursor.current));
+				auto_wait();
+				EmbeddedData::ownEdits(FALSE);
+			}
+			bSkip = (type != EmbeddedData::NONE);
+		}
+
+		// Make it unknown bytes
+		if (!bSkip)
+		{
+			#ifdef PASS1_DEBUG
+			msg(EAFORMAT" "EAFORMAT" %02X unknown\n", cursor.current, end, get_flags(cursor.current));
+			#endif
+			makeUnknown(cursor.current, end);
+			s_run->unknownDataCount++;
+
+			// Note: Might have triggered auto-analysis and a alignment or function could be here now
+		}
+
+		// Advance to next data value, or the end which ever comes first
+		cursor.current = end;
+		if (cursor.current < cursor.end)
+			cursor.current = next_that(cursor.current, cursor.end, is_data, NULL);
+
+	} while (getTimeStamp() < quantumEnd);
+	return(TRUE);
+}
+
+// Find missing align blocks
+// Align byte runs are found on window snapshots of the segment, see AlignRunClassifier
+static BOOL runAlignBlocks(TIMESTAMP quantumEnd)
+{
+	while (s_run->pipeline.step())
+	{
+		s_run->cursor.current = s_run->pipeline.position();
+		if (getTimeStamp() >= quantumEnd)
+			return(TRUE);
+	}
+
+	s_run->cursor.current = s_run->cursor.end;
+	return(FALSE);
+}
+
+// Find missing code
+//#define PASS3_DEBUG
+static BOOL runMissingCode(TIMESTAMP quantumEnd)
+{
+	PASSCURSOR &cursor = s_run->cursor;
+
+	// First queue every unknown range for code in one go, see UnknownRangeClassifier
+	if (s_run->pipeline.active())
+	{
+		while (s_run->pipeline.step())
+		{
+			if (getTimeStamp() >= quantumEnd)
+				return(TRUE);
+		}
+
+		// Let the auto-analyzer make what code it can of them all, in a single wait
+		PROFILE_CALL("auto_wait", auto_wait());
+		if (!s_run->background)
+		{
+			char buffer[32];
+			msg("Unknown bytes queued for code: %s\n", prettyNumberString(s_run->unknownRanges.queued(), buffer));
+		}
+		cursor.current = (cursor.skip ? cursor.end : cursor.start);
+		return(TRUE);
+	}
+
+	// Then try what is still unknown, in the census blocks with work
+	UINT work = passWork(2);
+	while (cursor.current < cursor.end)
+	{
+		ea_t startAddress = s_run->census.nextWork(cursor.current, work);
+		if ((startAddress < cursor.end) && !is_unknown(get_flags(startAddress)))
+			startAddress = next_unknown(startAddress, cursor.end);
+		if (startAddress >= cursor.end)
+			break;
+
+		// Skip over pinned embedded data
+		range_t pin;
+		if (EmbeddedData::isPinned(startAddress, &pin))
+			cursor.current = pin.end_ea;
+		else
+		{
+			// Try to make code of it
+			int result = PROFILE_CALL("create_insn", create_insn(startAddress));
+			#ifdef PASS3_DEBUG
+			msg(EAFORMAT" DO CODE %d\n", startAddress, result);
+			#endif
+			if (result > 0)
+			{
+				// Continue past the new instruction
+				s_run->codeFixes++;
+				cursor.current = get_item_end(startAddress);
+			}
+			else
+			{
+				#ifdef PASS3_DEBUG
+				msg(EAFORMAT" fix fail.\n", startAddress);
+				#endif
+				cursor.current = (startAddress + 1);
+			}
+		}
+
+		if (getTimeStamp() >= quantumEnd)
+			return(TRUE);
+	}
+
+	PROFILE_CALL("auto_wait", auto_wait());
+	cursor.current = cursor.end;
+	return(FALSE);
+}
+
+// Discover missing functions
+// Gaps are visited best score first, each visit limited to its own attempt budget
+static BOOL runMissingFuncs(TIMESTAMP quantumEnd)
+{
+	do
+	{
+		// Bulk create the functions the seed stages find first
+		if (s_run->seed.stage < SEED_STAGE_COUNT)
+		{
+			if (seedStages[s_run->seed.stage](s_run->seed.first, quantumEnd))
+				s_run->seed.first = FALSE;
+			else
+			{
+				s_run->seed.stage++;
+				s_run->seed.beginStage();
+
+				// The stages made functions in the gaps, the list they started from is stale
+				if (s_run->seed.stage == SEED_STAGE_COUNT)
+					buildGapList(TRUE);
+			}
+			continue;
+		}
+
+		if (s_run->gapList.empty() || (s_run->options.funcBudget && (s_run->funcAttempts >= s_run->options.funcBudget)))
+		{
+			if (!s_run->gapList.empty() && !s_run->background)
+			{
+				char buffer[32];
+				msg("Function attempt budget reached, %s gaps left.\n", prettyNumberString(s_run->gapList.size(), buffer));
+			}
+			s_run->cursor.current = s_run->cursor.end;
+			return(FALSE);
+		}
+
+		std::pop_heap(s_run->gapList.begin(), s_run->gapList.end());
+		GAPNODE gap = s_run->gapList.back();
+		s_run->gapList.pop_back();
+
+		UINT attempts = s_run->funcAttempts;
+		ea_t resume = processFuncGap(gap.start, gap.size, gap.budget);
+
+		// Ran out of budget in this gap, put the remainder back at a lower priority.
+		// Stopped at its start, the head there was tried and failed, the remainder is past it.
+		ea_t end = (gap.start + gap.size);
+		if ((resume == gap.start) && (s_run->funcAttempts > attempts))
+			resume = next_head(resume, end);
+		if ((resume != BADADDR) && (resume > gap.start) && (resume < end))
+		{
+			gap.size  = (UINT) (end - resume);
+			gap.start = resume;
+			gap.score >>= 1;
+			s_run->gapList.push_back(gap);
+			std::push_heap(s_run->gapList.begin(), s_run->gapList.end());
+		}
+
+	} while (getTimeStamp() < quantumEnd);
+	return(TRUE);
+}
+
+// In eSTATE_PASS_1.. order
+typedef BOOL (*PASSTASK)(TIMESTAMP quantumEnd);
+static const PASSTASK passTasks[PASS_COUNT] =
+{
+	runUnknownData,
+	runAlignBlocks,
+	runMissingCode,
+	runMissingFuncs,
+};
+
+// Pass driver, runs the current pass for a quantum and accounts its time.
+// The quantum is cut short at the deadline mode slice end. Returns FALSE when the pass is done.
+static BOOL runPass()
+{
+	int pass = (s_run->state - eSTATE_PASS_1);
+	TIMESTAMP start = getTimeStamp();
+	TIMESTAMP quantumEnd = (start + PASS_QUANTUM);
+	if (s_run->deadline)
+		quantumEnd = std::min(quantumEnd, std::min(s_run->cursor.sliceEnd, s_run->deadline));
+
+	BOOL more = passTasks[pass](quantumEnd);
+
+	PASSINFO &info = s_run->passInfo[pass];
+	info.time += (getTimeStamp() - start);
+	info.quanta++;
+	return(more);
+}
+
+// Initialize
+int idaapi plugin_init()
+{
+	// Only Intel x86/AMD64 supported
+	if (ph.id != PLFM_386)
+		return(PLUGIN_SKIP);
+
+    ItypeClass::init();
+    s_run->state = eSTATE_INIT;
+	return(PLUGIN_OK);
+}
+
+// Uninitialize
+void idaapi plugin_exit()
+{
+    try
+    {
+        Incremental::stop();
+        EmbeddedData::clear();
+        s_run->segStream.end();
+        s_run->pipeline.end();
+
+        #ifdef LOG_FILE
+        if(s_run->logFile)
+        {
+            qfclose(s_run->logFile);
+            s_run->logFile = NULL;
+        }
+        #endif
+
+        if (s_run->chosen)
+        {
+            SegSelect::free(s_run->chosen);
+            s_run->chosen = NULL;
+        }
+
+        ProblemList::close();
+        OggPlay::endPlay();
+        set_user_defined_prefix(0, NULL);
+    }
+    CATCH()
+}
+
+// Handler for choose code and data segment buttons
+static void idaapi chooseBtnHandler(TWidget *fields[], int code)
+{
+    if (s_run->chosen = SegSelect::select(SegSelect::CODE_HINT, "Choose code segments"))
+    {
+        msg("Chosen: ");
+        for (SegSelect::segments::iterator it = s_run->chosen->begin(); it != s_run->chosen->end(); ++it)
+        {
+            qstring buffer;
+            if (get_segm_name(&buffer, *it) <= 0)
+                buffer = "????";
+
+            SegSelect::segments::iterator it2 = it; ++it2;
+            if (it2 != s_run->chosen->end())
+                msg("\"%s\", ", buffer.c_str());
+            else
+                msg("\"%s\"", buffer.c_str());
+        }
+        msg("\n");
+        WaitBox::processIdaEvents();
+    }
+}
+
+static void idaapi doHyperlink(TWidget *fields[], int code) { open_url(SITE_URL); }
+
+
+// Plug-in process
+bool idaapi plugin_run(size_t arg)
+{
+    try
+    {
+        while (TRUE)
+        {
+            PROFILE_SCOPE(stateNames[s_run->state]);
+            switch (s_run->state)
+            {
+                // Initialize
+                case eSTATE_INIT:
+                {
+					char version[16];
+					sprintf(version, "%u.%u", HIBYTE(MY_VERSION), LOBYTE(MY_VERSION));
+					msg("\n>> ExtraPass: v: %s, BD: %s, By Sirmabus ==\n", version, __DATE__);
+					refreshUI();
+                    WaitBox::processIdaEvents();
+                    s_run->isBreak = FALSE;
+
+                    // A run replaces the background mode
+                    if (Incremental::active())
+                    {
+                        Incremental::stop();
+                        msg("Background incremental mode off.\n");
+                    }
+
+                    // Do UI for process pass selection, starting from the last run's options
+                    RUNOPTIONS &options = s_run->options;
+                    loadRunOptions();
+
+                    WORD optionFlags = 0;
+                    if (options.doDataToBytes) optionFlags |= OPT_DATATOBYTES;
+                    if (options.doAlignBlocks) optionFlags |= OPT_ALIGNBLOCKS;
+                    if (options.doMissingCode) optionFlags |= OPT_MISSINGCODE;
+                    if (options.doMissingFunc) optionFlags |= OPT_MISSINGFUNC;
+
+                    {
+                        // To add forum URL to help box
+                        sval_t funcBudget = options.funcBudget;
+
+                        // Time limit from the run argument for unattended jobs, else the environment's as the dialog's default
+                        qstring timeLimit;
+                        BOOL unattended = (arg > 0);
+                        if (unattended)
+                            timeLimit.sprnt("%u", (UINT) arg);
+                        else
+                            qgetenv("EXTRAPASS_TIMELIMIT", &timeLimit);
+
+                        // An unattended job has no dialog, it runs with the saved options
+                        if (unattended)
+                            msg("Unattended run, using the saved options.\n");
+                        else
+                        {
+                            sval_t streamMemory = options.streamMemory;
+                            int result = ask_form(optionDialog, version, doHyperlink, &optionFlags, &options.audioAlertWhenDone, &options.profile, &options.resident, &funcBudget, &timeLimit, &streamMemory, chooseBtnHandler);
+                            if (!result || (optionFlags == 0))
+                            {
+                                // User canceled, or no options selected, bail out
+                                msg(" - Canceled -\n\n");
+                                WaitBox::processIdaEvents();
+                                s_run->state = eSTATE_EXIT;
+                                break;
+                            }
+
+                            options.doDataToBytes = ((optionFlags & OPT_DATATOBYTES) != 0);
+                            options.doAlignBlocks = ((optionFlags & OPT_ALIGNBLOCKS) != 0);
+                            options.doMissingCode = ((optionFlags & OPT_MISSINGCODE) != 0);
+                            options.doMissingFunc = ((optionFlags & OPT_MISSINGFUNC) != 0);
+                            options.funcBudget = ((funcBudget > 0) ? (UINT) funcBudget : 0);
+                            options.streamMemory = ((streamMemory >= 1) ? (UINT) streamMemory : STREAM_MEMORY_MB);
+                            saveRunOptions();
+                        }
+
+                        double limit = parseTimeLimit(timeLimit.c_str());
+                        if (limit < 0)
+                        {
+                            msg("** Bad time limit \"%s\"! **\n*** Aborted ***\n\n", timeLimit.c_str());
+                            s_run->state = eSTATE_EXIT;
+                            break;
+                        }
+                        s_run->deadline = ((limit > 0) ? (getTimeStamp() + limit) : 0);
+                        if (s_run->deadline)
+                            msg("Time limit: %s.\n", timeString(limit));
+                    }
+
+                    // IDA must be IDLE
+                    if (auto_is_ok())
+                    {
+                        // Ask for the log file name once
+                        #ifdef LOG_FILE
+                        if(!s_run->logFile)
+                        {
+                            if(char *szFileName = askfile_c(1, "*.txt", "Select a log file name:"))
+                            {
+                                // Open it for appending
+                                s_run->logFile = qfopen(szFileName, "ab");
+                            }
+                        }
+                        if(!s_run->logFile)
+                        {
+                            msg("** Log file open failed! Aborted. **\n");
+                            return;
+                        }
+                        #endif
+
+                        s_run->cursor.seg = NULL;
+                        s_run->unknownDataCount = 0;
+                        s_run->alignFixes = s_run->codeFixes = 0;
+                        s_run->pass1Loops = 0; s_run->funcAttempts = 0;
+                        s_run->segments.clear();
+                        s_run->cursor.active = FALSE;
+                        loadPassRates();
+                        EmbeddedData::load();
+                        selectProfile(Toolchain::fingerprint());
+                        s_run->seed.resetSweeps();
+                        s_run->seed.begin();
+                        #ifdef SDK_TRACE
+                        SdkTrace::begin();
+                        #endif
+                        Profiler::begin(s_run->options.profile != 0);
+                        ProblemList::clear();
+                        s_run->startFuncCount = get_func_qty();
+
+                        if (s_run->startFuncCount > 0)
+                        {
+                            char buffer[32];
+                            msg("Starting function count: %s\n", prettyNumberString(s_run->startFuncCount, buffer));
+                            WaitBox::processIdaEvents();
+
+                            /*
+                            msg("\n=========== Segments ===========\n");
+                            int iSegCount = get_segm_qty();
+                            for(int i = 0; i < iSegCount; i++)
+                            {
+                                if(segment_t *pSegInfo = getnseg(i))
+                                {
+                                char szName[128] = {0};
+                                get_visible_segm_name(pSegInfo, szName, (sizeof(szName) - 1));
+                                char szClass[16] = {0};
+                                get_segm_class(pSegInfo, szClass, (sizeof(szClass) - 1));
+                                msg("[%d] \"%s\", \"%s\".\n", i, szName, szClass);
+                                }
+                            }
+                            */
+
+                            // First chosen seg
+                            #ifdef BENCHMARK
+                            if (ask_yn(ASKBTN_NO, "HIDECANCEL\nBuild and run the synthetic benchmark segment?") == ASKBTN_YES)
+                            {
+                                if (s_run->chosen)
+                                {
+                                    SegSelect::free(s_run->chosen);
+                                    s_run->chosen = NULL;
+                                }
+                                s_run->cursor.seg = Benchmark::begin();
+                            }
+                            else
+                            #endif
+                            if (s_run->chosen && !s_run->chosen->empty())
+                            {
+                                s_run->cursor.seg = s_run->chosen->back();
+                                s_run->chosen->pop_back();
+                            }
+                            else
+                            // Use the first CODE seg
+                            {
+                                int iSegCount = get_segm_qty();
+                                int iIndex = 0;
+                                for (; iIndex < iSegCount; iIndex++)
+                                {
+                                    if (s_run->cursor.seg = getnseg(iIndex))
+                                    {
+                                        qstring sclass;
+                                        if (get_segm_class(&sclass, s_run->cursor.seg) <= 0)
+                                            break;
+                                        else
+                                        if (sclass == "CODE")
+                                            break;
+                                    }
+                                }
+
+                                if (iIndex >= iSegCount)
+                                    s_run->cursor.seg = NULL;
+                            }
+
+                            if (s_run->cursor.seg)
+                            {
+                                WaitBox::show();
+                                WaitBox::updateAndCancelCheck(-1);
+                                s_run->cursor.setSegment(s_run->cursor.seg);
+                                nextState();
+                                break;
+                            }
+                            else
+                                msg("** No code segment found to process! **\n*** Aborted ***\n\n");
+                        }
+                        else
+                            msg("** No functions in DB?! **\n*** Aborted ***\n\n");
+                    }
+                    else
+                        msg("** Wait for IDA to finish processing before starting plugin! **\n*** Aborted ***\n\n");
+
+                    // Canceled or error'ed, bail out
+                    s_run->state = eSTATE_EXIT;
+                }
+                break;
+
+                // Start up process
+                case eSTATE_START:
+                {
+                    // Take the segment census first, see CensusClassifier
+                    if (!s_run->census.valid())
+                    {
+                        if (!s_run->segStream.active())
+                        {
+                            // The guard CF table first, a quantum at a time
+                            if (seedGuardTable(s_run->seed.first, (getTimeStamp() + PASS_QUANTUM)))
+                            {
+                                s_run->seed.first = FALSE;
+                                break;
+                            }
+                            s_run->seed.beginStage();
+                            s_run->cursor.current = 0;
+
+                            qstring name;
+                            if (get_segm_name(&name, s_run->cursor.seg) <= 0)
+                                name = "????";
+                            qstring sclass;
+                            if(get_segm_class(&sclass, s_run->cursor.seg) <= 0)
+                                sclass = "????";
+                            msg("\nProcessing segment: \"%s\", type: %s, address: " EAFORMAT "-" EAFORMAT ", size: %08X\n\n", name.c_str(), sclass.c_str(), s_run->cursor.seg->start_ea, s_run->cursor.seg->end_ea, s_run->cursor.seg->size());
+                            s_run->segStream.begin(s_run->cursor.start, s_run->cursor.end, s_run->options.streamMemory);
+                        }
+
+                        if (s_run->segStream.step(s_run->census))
+                        {
+                            s_run->cursor.current = s_run->segStream.position();
+                            break;
+                        }
+
+                        // A partial census stays invalid, the steps then go over the whole segment
+                        if (!s_run->segStream.failed())
+                        {
+                            PROFILE_CALL("census gaps", s_run->census.finish());
+                            char buffer[32], buffer2[32], buffer3[32], buffer4[32];
+                            msg("Census: %s data items, %s padding runs, %s unknown runs, %s function gaps.\n\n", prettyNumberString(s_run->census.dataItems(), buffer),
+                                prettyNumberString(s_run->census.paddingRuns(), buffer2), prettyNumberString(s_run->census.unknownRuns(), buffer3), prettyNumberString(s_run->census.funcGaps(), buffer4));
+                        }
+                    }
+
+                    // Move to first process state
+                    s_run->startTime = getTimeStamp();
+                    nextState();
+                }
+                break;
+
+
+                // The passes, a quantum at a time, see runPass()
+                case eSTATE_PASS_1:
+                case eSTATE_PASS_2:
+                case eSTATE_PASS_3:
+                case eSTATE_PASS_4:
+                {
+                    if (!runPass())
+                        nextState();
+                }
+                break;
+
+
+                // Finished processing
+                case eSTATE_FINISH:
+                {
+                    nextState();
+                }
+                break;
+
+                // Done processing
+                case eSTATE_EXIT:
+                {
+					WaitBox::hide();
+                    nextState();
+                    goto BailOut;
+                }
+                break;
+            };
+
+            // Check & bail out on 'break' press, or time out
+			if (checkBreak() || checkDeadline())
+			{
+				// The exit cleanup, stopping the stream threads and closing the profile and trace
+				WaitBox::hide();
+				nextState();
+				goto BailOut;
+			}
+        };
+
+        BailOut:;
+    }
+    CATCH()
+	return true;
+}
+
+
+// Do next state logic
+static void nextState()
+{
+	// Account the pass we're leaving before the rewind
+	endPass();
+
+	// Rewind
+	if(s_run->state < eSTATE_FINISH)
+	{
+		// Top of code seg
+		s_run->cursor.rewind();
+		//SafeJumpTo(s_uCurrentAddress);
+		auto_wait();
+	}
+
+	// Logic
+	switch(s_run->state)
+	{
+		// Init
+		case eSTATE_INIT:
+		{
+			s_run->state = eSTATE_START;
+		}
+		break;
+
+		// Start
+		case eSTATE_START:
+		{
+			if(s_run->options.doDataToBytes)
+			{
+				msg("===== Fixing bad code bytes =====\n");
+				s_run->stepTime = getTimeStamp();
+				s_run->state = eSTATE_PASS_1;
+			}
+			else
+			if(s_run->options.doAlignBlocks)
+			{
+				msg("===== Missing align blocks =====\n");
+				s_run->stepTime = getTimeStamp();
+				s_run->state = eSTATE_PASS_2;
+			}
+			else
+			if(s_run->options.doMissingCode)
+			{
+				msg("===== Missing code =====\n");
+				s_run->stepTime = getTimeStamp();
+				s_run->state = eSTATE_PASS_3;
+			}
+			else
+			if(s_run->options.doMissingFunc)
+			{
+				msg("===== Missing functions =====\n");
+                WaitBox::processIdaEvents();
+				s_run->stepTime = getTimeStamp();
+                buildGapList(FALSE);
+				s_run->state = eSTATE_PASS_4;
+			}
+			else
+				s_run->state = eSTATE_FINISH;
+
+            WaitBox::processIdaEvents();
+		}
+		break;
+
+		// Find unknown data in code space
+		case eSTATE_PASS_1:
+		{
+			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_run->stepTime));
+
+			if(s_run->options.doAlignBlocks)
+			{
+				msg("===== Missing align blocks =====\n");
+				s_run->stepTime = getTimeStamp();
+				s_run->state = eSTATE_PASS_2;
+			}
+			else
+			if(s_run->options.doMissingCode)
+			{
+				msg("===== Missing code =====\n");
+				s_run->stepTime = getTimeStamp();
+				s_run->state = eSTATE_PASS_3;
+			}
+			else
+			if(s_run->options.doMissingFunc)
+			{
+				msg("===== Missing functions =====\n");
+                WaitBox::processIdaEvents();
+				s_run->stepTime = getTimeStamp();
+                buildGapList(FALSE);
+				s_run->state = eSTATE_PASS_4;
+			}
+			else
+				s_run->state = eSTATE_FINISH;
+
+            WaitBox::processIdaEvents();
+		}
+		break;
+
+
+		// From missing align block pass
+		case eSTATE_PASS_2:
+		{
+			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_run->stepTime));
+
+			if(s_run->options.doMissingCode)
+			{
+				msg("===== Missing code =====\n");
+				s_run->stepTime = getTimeStamp();
+				s_run->state = eSTATE_PASS_3;
+			}
+			else
+			if(s_run->options.doMissingFunc)
+			{
+				msg("===== Missing functions =====\n");
+                WaitBox::processIdaEvents();
+				s_run->stepTime = getTimeStamp();
+                buildGapList(FALSE);
+				s_run->state = eSTATE_PASS_4;
+			}
+			else
+				s_run->state = eSTATE_FINISH;
+
+            WaitBox::processIdaEvents();
+		}
+		break;
+
+		// From missing code pass
+		case eSTATE_PASS_3:
+		{
+			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_run->stepTime));
+
+			if(s_run->options.doMissingFunc)
+			{
+				msg("===== Missing functions =====\n");
+                WaitBox::processIdaEvents();
+				s_run->stepTime = getTimeStamp();
+                buildGapList(FALSE);
+				s_run->state = eSTATE_PASS_4;
+			}
+			else
+				s_run->state = eSTATE_FINISH;
+
+            WaitBox::processIdaEvents();
+		}
+		break;
+
+		// From missing function pass part
+		case eSTATE_PASS_4:
+		{
+			msg("Time: %s.\n\n", timeString(getTimeStamp() - s_run->stepTime));
+			s_run->gapList.clear();
+			s_run->state = eSTATE_FINISH;
+
+            WaitBox::processIdaEvents();
+		}
+		break;
+
+
+		// From final pass, we're done
+		case eSTATE_FINISH:
+		{
+			// If there are more code segments to process, do next
+			auto_wait();
+            if (s_run->chosen && !s_run->chosen->empty())
+			{
+				s_run->cursor.seg = s_run->chosen->back();
+                s_run->chosen->pop_back();
+				s_run->cursor.setSegment(s_run->cursor.seg);
+				s_run->state = eSTATE_START;
+			}
+			else
+			{
+				msg("\n===== Done =====\n");
+				savePassRates();
+				showEndStats();
+				#ifdef BENCHMARK
+				Benchmark::report();
+				#endif
+                refresh_idaview_anyway();
+				ProblemList::show();
+				WaitBox::hide();
+                WaitBox::processIdaEvents();
+
+				// Optionally play completion sound
+				if(s_run->options.audioAlertWhenDone)
+				{
+                    // Only if processing took at least a few seconds
+                    if ((getTimeStamp() - s_run->startTime) > 2.2)
+                    {
+
+                        WaitBox::processIdaEvents();
+                        OggPlay::playFromMemory((const PVOID)complete_ogg, complete_ogg_len);
+                        OggPlay::endPlay();
+                    }
+				}
+
+				if (s_run->options.resident)
+					startResident();
+				s_run->state = eSTATE_EXIT;
+			}
+		}
+		break;
+
+		// Exit plugin run back to IDA control
+		case eSTATE_EXIT:
+		{
+			// In case we aborted some place and list still exists..
+            if (s_run->chosen)
+            {
+                SegSelect::free(s_run->chosen);
+                s_run->chosen = NULL;
+            }
+			s_run->segStream.end();
+			s_run->pipeline.end();
+			// The background mode keeps using them
+			if (!Incremental::active())
+			{
+				EmbeddedData::clear();
+				NoReturn::clear();
+			}
+			#ifdef BENCHMARK
+			Benchmark::end();
+			#endif
+			#ifdef SDK_TRACE
+			SdkTrace::end();
+			#endif
+			Profiler::end();
+			s_run->state = eSTATE_INIT;
+		}
+		break;
+	};
+
+	if (s_run->state == eSTATE_START)
+	{
+		s_run->census.reset(s_run->cursor.start, s_run->cursor.end);
+		s_run->segments.push_back(range_t(s_run->cursor.start, s_run->cursor.end));
+	}
+	else
+	if ((s_run->state >= eSTATE_PASS_1) && (s_run->state <= eSTATE_PASS_4))
+		beginPass();
+}
+
+
+// Print out end stats
+static void showEndStats()
+{
+    char buffer[32];
+	msg("Total time: %s\n", timeString(getTimeStamp() - s_run->startTime));
+    msg("Alignments: %s\n", prettyNumberString(s_run->alignFixes, buffer));
+    int functionsDelta = ((int) get_func_qty() - s_run->startFuncCount);
+	if (functionsDelta != 0)
+		msg(" Functions: %c%s\n", ((functionsDelta >= 0) ? '+' : '-'), prettyNumberString(labs(functionsDelta), buffer)); // Can be negative
+	else
+		msg(" Functions: 0\n");
+
+	// Deadline mode pass coverage
+	if (s_run->deadline)
+	{
+		static const char * const passNames[PASS_COUNT] = { "Unknown data", "Align blocks", "Missing code", "Missing functions" };
+		for (int i = 0; i < PASS_COUNT; i++)
+		{
+			if (isPassEnabled(i) && (s_run->passInfo[i].total > 0))
+				msg("%17s: %.1f%% covered\n", passNames[i], ((s_run->passInfo[i].done * 100.0) / s_run->passInfo[i].total));
+		}
+	}
+
+	// Pass run times, less the UI and checks between the quanta
+	for (int i = 0; i < PASS_COUNT; i++)
+	{
+		if (s_run->passInfo[i].quanta)
+			msg("%17s: %s, %u quanta\n", stateNames[eSTATE_PASS_1 + i], timeString(s_run->passInfo[i].time), s_run->passInfo[i].quanta);
+	}
+
+	//msg("Code fixes: %u\n", s_uCodeFixes);
+	//msg("Code fails: %u\n", s_uCodeFixFails);
+	//msg("Align fails: %d\n", s_uAlignFails);
+	//msg("  Unknowns: %u\n", s_uUnknowns);
+
+	msg(" \n");
+}
+
+// Returns TRUE if the head at "ea" is an align item or starts padding of the profile's kinds, see Padding
+template<class PROFILE> static BOOL isPaddingHead(ea_t ea, flags_t flags, ea_t end)
+{
+	const flags_t ALIGN_VALUE1 = (FF_IVL | 0xCC); // 0xCC (single byte "int 3") byte type
+	const flags_t ALIGN_VALUE2 = (FF_IVL | 0x90); // NOP byte type
+
+	if (is_align(flags))
+		return(TRUE);
+	flags_t value = (flags & (FF_IVL | MS_VAL));
+	if (((PROFILE::FILLS & FILL_BIT(FILL_CC)) && (value == ALIGN_VALUE1)) || ((PROFILE::FILLS & FILL_BIT(NOP)) && (value == ALIGN_VALUE2)))
+		return(TRUE);
+	if (is_data(flags) || !(flags & FF_IVL) || !Padding::isLeadByte((BYTE) (flags & MS_VAL)))
+		return(FALSE);
+
+	Padding::KIND kind;
+	return((Padding::lengthAt(ea, end, s_run->cursor.seg->is_64bit(), kind) != 0) && (PROFILE::FILLS & (1 << kind)));
+}
+
+// Return if flag is data type we want to convert to unknown bytes
+static bool idaapi is_data(flags_t flags, void *ud)
+{
+	return(!is_align(flags) && is_data(flags));
+}
+
+
+// Try to make an "align" block out of an align byte run found by eSTATE_PASS_2
+//#define PASS2_DEBUG
+static void tryAlignRun(ea_t startAddress, UINT alignByteCount, UINT alignment)
+{
+	PROFILE_SCOPE("tryAlignRun");
+    // Do these bytes bring about the profile's alignment? 16 (could be 32) for most, 4 for Borland
+    if (((startAddress + alignByteCount) & (alignment - 1)) != 0)
+        return;
+
+    // If short count, only try alignment if the line above or a below us has n xref
+    // We don't want to try to align odd code and switch table bytes, etc.
+    if (alignByteCount <= 2)
+    {
+        BOOL hasRef = FALSE;
+
+        // Before us
+        ea_t endAddress = (startAddress + alignByteCount);
+        ea_t ref = get_first_cref_from(endAddress);
+        if (ref != BADADDR)
+        {
+            //msg(EAFORMAT " cref from end.\n", endAddress);
+            hasRef = TRUE;
+        }
+        else
+        {
+            ref = get_first_cref_to(endAddress);
+            if (ref != BADADDR)
+            {
+                //msg(EAFORMAT " cref to end.\n", endAddress);
+                hasRef = TRUE;
+            }
+        }
+
+        // After us
+        if (ref == BADADDR)
+        {
+            ea_t foreAddress = (startAddress - 1);
+            ref = get_first_cref_from(foreAddress);
+            if (ref != BADADDR)
+            {
+                //msg(EAFORMAT " cref from start.\n", eaForeAddress);
+                hasRef = TRUE;
+            }
+            else
+            {
+                ref = get_first_cref_to(foreAddress);
+                if (ref != BADADDR)
+                {
+                    //msg(EAFORMAT " cref to start.\n", eaForeAddress);
+                    hasRef = TRUE;
+                }
+            }
+        }
+
+        // No code ref, now look for a broken code ref
+        if (ref == BADADDR)
+        {
+            // This is still not complete as it could still be code, but pointing to a vftable
+            // entry in data.
+            // But should be fixed on more passes.
+            ea_t endAddress = (startAddress + alignByteCount);
+            ref = get_first_dref_from(endAddress);
+            if (ref != BADADDR)
+            {
+                // If it the ref points to code assume code is just broken here
+                if (is_code(get_flags(ref)))
+                {
+                    //msg(EAFORMAT " dref from end %08X.\n", eaRef, eaEndAddress);
+                    hasRef = TRUE;
+                }
+            }
+            else
+            {
+                ref = get_first_dref_to(endAddress);
+                if (ref != BADADDR)
+                {
+                    if (is_code(get_flags(ref)))
+                    {
+                        //msg(EAFORMAT " dref to end %08X.\n", eaRef, eaEndAddress);
+                        hasRef = TRUE;
+                    }
+                }
+            }
+
+            if (ref == BADADDR)
+            {
+                //msg(EAFORMAT " NO REF.\n", eaStartAddress);
+            }
+        }
+
+        // Assume it's not an alignment byte(s) and bail out
+        if (!hasRef) return;
+    }
+
+    // Never inside a function, the snapshot could be behind
+	if (get_fchunk(startAddress) || get_fchunk((startAddress + alignByteCount) - 1))
+		return;
+
+    // If it's not an align make block already try to fix it
+	flags_t flags = get_flags(startAddress);
+	UINT itemSize = get_item_size(startAddress);
+	if (!is_align(flags) || (itemSize != alignByteCount))
+	{
+		// An item running past the end gets undone too, the pipeline's later windows have it stale
+		ea_t editEnd = std::max((startAddress + alignByteCount), get_item_end((startAddress + alignByteCount) - 1));
+		makeUnknown(startAddress, ((startAddress + alignByteCount) - 1));
+		s_run->pipeline.invalidate(startAddress, editEnd);
+		BOOL result = PROFILE_CALL("create_align", create_align(startAddress, alignByteCount, 0));
+		PROFILE_CALL("auto_wait", auto_wait());
+		#ifdef PASS2_DEBUG
+		msg(EAFORMAT" %d %d  %d %d %d DO ALIGN.\n", startAddress, alignByteCount, result, is_align(flags), itemSize, get_item_size(startAddress));
+		#endif
+		if (result)
+		{
+			#ifdef PASS2_DEBUG
+			//msg(EAFORMAT" %d ALIGN.\n", startAddress, alignByteCount);
+			#endif
+			s_run->alignFixes++;
+		}
+		else
+		{
+			// There are cases were IDA will fail even when the alignment block is obvious.
+			// Usually when it's an ALIGN(32) and there is a run of 16 align bytes
+			// Could at least do a code analyze on it. Then IDA will at least make a mini array of it
+			#ifdef PASS2_DEBUG
+			msg(EAFORMAT" %d ALIGN FAIL ***\n", startAddress, alignByteCount);
+			//s_alignFails++;
+			#endif
+		}
+	}
+}
+
+
+// Try adding a function at specified address.
+// Optionally returns if a newly made function ended as expected (with a return, jump, etc.)
+static BOOL tryFunction(ea_t codeStart, ea_t codeEnd, ea_t &current, BOOL *expected = NULL)
+{
+	PROFILE_SCOPE("tryFunction");
+	BOOL result = FALSE;
+
+	auto_wait();
+	#ifdef LOG_FILE
+	Log(s_run->logFile, EAFORMAT " " EAFORMAT " Trying function.\n", codeStart, current);
+	#endif
+	//msg("  " EAFORMAT " " EAFORMAT " Trying function.\n", codeStart, codeEnd);
+
+	/// *** Don't use "get_func()" it has a bug, use "get_fchunk()" instead ***
+
+	// Could belong as a chunk to an existing function already or already a function here recovered already between steps.
+	if(func_t *f = get_fchunk(codeStart))
+	{
+  		#ifdef LOG_FILE
+        Log(s_run->logFile, "  " EAFORMAT " " EAFORMAT " " EAFORMAT " F: %08X already function.\n", f->end_ea, f->start_ea, codeStart, get_flags(codeStart));
+		#endif
+		//msg("  " EAFORMAT " " EAFORMAT " " EAFORMAT " F: %08X already a function.\n", f->end_ea, f->start_ea, codeStart, get_full_flags(codeStart));
+		current = prev_head(f->end_ea, codeStart); // Advance to end of the function -1 location (for a follow up "next_head()")
+		result = TRUE;
+	}
+	else
+	{
+		// Try function here
+		//flags_t flags = get_full_flags(codeEnd);
+		//flags = flags;
+		//if (add_func(codeStart, codeEnd /*BADADDR*/))
+
+		s_run->funcAttempts++;
+		if(PROFILE_CALL("add_func", add_func(codeStart, BADADDR)))
+		{
+			// Wait till IDA is done possibly creating the function, then get it's info
+			PROFILE_CALL("auto_wait", auto_wait());
+			if(func_t *f = get_fchunk(codeStart)) // get_func
+			{
+				// Could be a no-return one, check before the tail is judged
+				NoReturn::added(codeStart);
+
+				#ifdef LOG_FILE
+				Log(s_run->logFile, "  " EAFORMAT " function success.\n", codeStart);
+				#endif
+				#ifdef VBDEV
+				msg("  " EAFORMAT " function success.\n", codeStart);
+				#endif
+
+				// Look at function tail instruction
+				auto_wait();
+				BOOL isExpected = FALSE;
+				ea_t tailEa = prev_head(f->end_ea, codeStart);
+				if(tailEa != BADADDR)
+				{
+					insn_t cmd;
+					UINT tailItype = 0;
+					ProblemList::REASON reason = ProblemList::UNDECODED;
+					if(decode_insn(&cmd, tailEa))
+					{
+						tailItype = cmd.itype;
+						BYTE itypeClasses = itypeClass(cmd.itype);
+						reason = ((itypeClasses & IC_CALL) ? ProblemList::CALL_RETURNS : ProblemList::FALLS_THROUGH);
+
+						// A return or a jump? (chain to another function, etc.)
+						// Or a conditional branch to another incongruent chunk
+						if(itypeClasses & (IC_TERMINATOR | IC_CONDBRANCH))
+							isExpected = TRUE;
+						else
+						// A single align byte that was mistakenly made a function?
+						if(itypeClasses & IC_PADDING)
+						{
+							if(f->size() == 1)
+							{
+								// Try to make it an align
+                                makeUnknown(tailEa, (tailEa + 1));
+								if(!create_align(tailEa, 1, 0))
+								{
+									// If it fails, make it an instruction at least
+									//msg("  " EAFORMAT " ALIGN fail.\n", tailEA);
+									create_insn(tailEa);
+								}
+                                auto_wait();
+								//msg("  " EAFORMAT " ALIGN\n", tailEA);
+								isExpected = TRUE;
+							}
+						}
+						else
+						{
+							// Return-less exception or exit handler?
+							if(itypeClasses & IC_CALL)
+							{
+								ea_t eaCRef = get_first_cref_from(tailEa);
+								if(NoReturn::isNoReturn(eaCRef))
+									isExpected = TRUE;
+								else
+								if(eaCRef != BADADDR)
+								{
+                                    qstring str;
+                                    if (get_name(&str, eaCRef) > 0)
+                                    {
+                                        char name[MAXNAMELEN + 1];
+                                        strncpy(name, str.c_str(), SIZESTR(name));
+                                        _strlwr(name);
+
+										static const char * const exitNames[] =
+										{
+											"exception",
+											"handler",
+											"exitprocess",
+											"fatalappexit",
+											"_abort",
+											"_exit",
+										};
+
+										for(int i = 0; i < (sizeof(exitNames) / sizeof(const char *)); i++)
+										{
+											if(strstr(name, exitNames[i]))
+											{
+												//msg("  " EAFORMAT " Exception\n", CodeStartEA);
+												isExpected = TRUE;
+												break;
+											}
+										}
+									}
+								}
+							}
+
+							// Allow if function has attribute "noreturn"
+							if(!isExpected && (f->flags & FUNC_NORET))
+							{
+								//msg("  " EAFORMAT " NORETURN\n", tailEA);
+								isExpected = TRUE;
+							}
+						}
+					}
+
+					if(!isExpected)
+					{
+						// Listed at the end, see ProblemList
+						ProblemList::add(f->start_ea, tailEa, tailItype, reason);
+
+						#ifdef LOG_FILE
+						Log(s_run->logFile, EAFORMAT " problem? <click me>\n", tailEa);
+						//Log(s_hLogFile, "  T: %d\n", cmd.itype);
+						#endif
+					}
+				}
+
+				if (expected)
+					*expected = isExpected;
+
+				// Update current look position to the end of this function
+				current = tailEa; // Advance to end of the function -1 location (for a follow up "next_head()")
+				result = TRUE;
+			}
+		}
+	}
+
+	return(result);
+}
+
+
+// Score a function gap by what it likely holds, returns 0 if there is nothing to try.
+// Code bytes, referenced heads, and aligned heads that start with one of the profile's prologues
+// weigh the most. Big gaps are sampled at spans spread over them, not just their head, and the sample is extrapolated.
+template<class PROFILE> static UINT scoreFuncGap(ea_t start, ea_t end, UINT &budget)
+{
+	UINT codeBytes = 0, refs = 0, prologues = 0;
+	UINT64 sampled = 0;
+	BOOL is64 = s_run->cursor.seg->is_64bit();
+	ea_t last = start;
+	for (UINT span = 0; span < GAP_SCAN_SPANS; span++)
+	{
+		ea_t spanStart = std::max(last, (ea_t) (start + (((UINT64) (end - start) * span) / GAP_SCAN_SPANS)));
+		ea_t spanEnd = (ea_t) (start + (((UINT64) (end - start) * (span + 1)) / GAP_SCAN_SPANS));
+		if (spanStart >= spanEnd)
+			continue;
+
+		ea_t ea = spanStart;
+		if (!is_head(get_flags(ea)))
+			ea = next_head(ea, spanEnd);
+
+		UINT heads = 0;
+		while ((ea != BADADDR) && (ea < spanEnd) && (heads < (GAP_SCAN_HEADS / GAP_SCAN_SPANS)))
+		{
+			flags_t flags = get_full_flags(ea);
+			if (is_code(flags))
+				codeBytes += (UINT) get_item_size(ea);
+			if (flags & FF_REF)
+				refs++;
+			heads++;
+
+			BYTE bytes[16];
+			if (((ea & (PROFILE::ALIGN - 1)) == 0) && !is_data(flags) && (get_bytes(bytes, sizeof(bytes), ea) == sizeof(bytes)) && PROFILE::isPrologue(bytes, is64))
+				prologues++;
+
+			ea = next_head(ea, spanEnd);
+		};
+
+		// Span done, or cut short where the sample stopped
+		last = (((ea == BADADDR) || (ea > spanEnd)) ? spanEnd : ea);
+		sampled += (last - spanStart);
+	}
+
+	// Sample cut short, scale up to the whole gap
+	if (sampled && (sampled < (UINT64) (end - start)))
+		codeBytes = (UINT) (((UINT64) codeBytes * (end - start)) / sampled);
+
+	if ((codeBytes == 0) && (refs == 0) && (prologues == 0))
+		return(0);
+
+	budget = (GAP_MIN_BUDGET + refs + prologues + (codeBytes >> 6));
+	return(codeBytes + ((refs + prologues) * 64) + 1);
+}
+
+// Instance the passes for a toolchain profile, see Toolchain.
+// The profile's choices are compiled into each instance, so the passes don't check them per item.
+template<class PROFILE> static void useProfile()
+{
+	// The context's own; its pipeline may still hold the old one
+	s_run->pipeline.end();
+	delete s_run->alignRuns;
+	s_run->alignRuns = new AlignRunClassifier<PROFILE>();
+	s_run->isPaddingHead = isPaddingHead<PROFILE>;
+	s_run->scoreFuncGap = scoreFuncGap<PROFILE>;
+
+	// Data in code is expected, leave it be
+	if (!PROFILE::PASS1_SAFE && s_run->options.doDataToBytes)
+	{
+		msg("Data to bytes pass is off for this toolchain.\n");
+		s_run->options.doDataToBytes = FALSE;
+	}
+}
+
+static void selectProfile(Toolchain::FAMILY family)
+{
+	s_run->family = family;
+	switch (family)
+	{
+		case Toolchain::MSVC:    useProfile<Toolchain::MsvcProfile>(); break;
+		case Toolchain::GNU:     useProfile<Toolchain::GnuProfile>(); break;
+		case Toolchain::BORLAND: useProfile<Toolchain::BorlandProfile>(); break;
+		default:                 useProfile<Toolchain::GenericProfile>(); break;
+	};
+	msg("Toolchain profile: %s\n", Toolchain::name(family));
+}
+
+// Gather and score the function gaps of the current segment for eSTATE_PASS_4.
+// Built at the pass start for the seed stages, then again after them for the gap walk, the one reported.
+static void buildGapList(BOOL report)
+{
+	PROFILE_SCOPE("buildGapList");
+	s_run->gapList.clear();
+	size_t count = get_func_qty();
+	for (size_t i = 1; i < count; i++)
+	{
+		func_t *f1 = getn_func(i - 1);
+		func_t *f2 = getn_func(i);
+		if (!f1 || !f2)
+			continue;
+		if ((f2->start_ea <= s_run->cursor.start) || (f1->end_ea >= s_run->cursor.end))
+			continue;
+
+		ea_t start = std::max(f1->end_ea, s_run->cursor.start);
+		ea_t end   = std::min(f2->start_ea, s_run->cursor.end);
+		if (end > start)
+		{
+			GAPNODE gap = { start, (UINT) (end - start), 0, GAP_MIN_BUDGET };
+			gap.score = s_run->scoreFuncGap(start, end, gap.budget);
+			if (gap.score)
+				s_run->gapList.push_back(gap);
+		}
+	}
+
+	std::make_heap(s_run->gapList.begin(), s_run->gapList.end());
+	s_run->gapCount = s_run->gapList.size();
+	s_run->gapBytes = 0;
+	for (GAPLIST::iterator it = s_run->gapList.begin(); it != s_run->gapList.end(); ++it)
+		s_run->gapBytes += it->size;
+
+	if (report && !s_run->background)
+	{
+		char buffer[32];
+		msg("Function gaps to try: %s\n", prettyNumberString(s_run->gapCount, buffer));
+	}
+}
+
+
+// Process the gap from the end of one function to the start of the next
+// looking for missing functions in between.
+// Stops after "budget" function attempts, returning the address to resume from, else BADADDR when done.
+static ea_t processFuncGap(ea_t start, UINT size, UINT budget)
+{
+	PROFILE_SCOPE("processFuncGap");
+	UINT attemptStart = s_run->funcAttempts;
+    s_run->cursor.current = start;
+	ea_t end = (start + size);
+	#ifdef LOG_FILE
+	Log(s_run->logFile, "\nS: " EAFORMAT ", E: " EAFORMAT " ==== PFG START ====\n", start, end);
+	#endif
+	#ifdef VBDEV
+	msg(EAFORMAT " " EAFORMAT " ==== Gap\n", start, end);
+	#endif
+
+	// Walk backwards at the end to trim alignments
+	auto_wait();
+	ea_t ea = prev_head(end, start);
+	if (ea == BADADDR)
+		return(BADADDR);
+	else
+	{
+		while (ea >= start)
+		{
+			flags_t flags = get_full_flags(ea);
+			if (s_run->isPaddingHead(ea, flags, end))
+			{
+				ea = prev_head(ea, start);
+				if (ea == BADADDR)
+					return(BADADDR);
+			}
+			else
+			{
+				end = next_head(ea, end);
+				// Can fail in some odd circumstances, so reset it back to whole gap size
+				if (end == BADADDR)
+					end = (start + size);
+				break;
+			}
+		};
+	}
+
+    // Traverse gap
+	ea_t codeStart = BADADDR;
+	ea = start;
+    while(ea < end)
+    {
+		// Out of attempts for this visit?
+		if (((s_run->funcAttempts - attemptStart) >= budget) || (s_run->options.funcBudget && (s_run->funcAttempts >= s_run->options.funcBudget)))
+			return((codeStart != BADADDR) ? codeStart : ea);
+
+		// Info flags for this address
+        flags_t flags = get_full_flags(ea);
+		#ifdef LOG_FILE
+		Log(s_run->logFile, "  C: " EAFORMAT ", F: %08X, \"%s\".\n", ea, flags, getDisasmText(ea));
+		#endif
+		#ifdef VBDEV
+		qstring disStr;
+		getDisasmText(ea, disStr);
+		msg(" C: " EAFORMAT ", F: %08X, \"%s\".\n", ea, flags, disStr.c_str());
+		#endif
+
+		if(ea < start)
+		{
+			#ifdef LOG_FILE
+			Log(s_run->logFile, "**** Out of start range! " EAFORMAT " " EAFORMAT " " EAFORMAT " ****\n", ea, start, end);
+			#endif
+			return(BADADDR);
+		}
+        else
+		if(ea > end)
+		{
+			#ifdef LOG_FILE
+			Log(s_run->logFile, "**** Out of end range! " EAFORMAT " " EAFORMAT " " EAFORMAT " ****\n", ea, start, end);
+			#endif
+			return(BADADDR);
+		}
+
+		// Skip over "align" blocks, and padding that isn't one yet (multi-byte NOPs, zero fill, etc.)
+		// #1 we will typically see more of these then anything else
+		if(s_run->isPaddingHead(ea, flags, end))
+		{
+			// Function between code start?
+			if(codeStart != BADADDR)
+			{
+				#ifdef LOG_FILE
+				Log(s_run->logFile, "  " EAFORMAT " Trying function #1\n", codeStart);
+				#endif
+				#ifdef VBDEV
+				msg(">" EAFORMAT " Trying function #1\n", codeStart);
+				#endif
+				tryFunction(codeStart, end, ea);
+			}
+
+			codeStart = BADADDR;
+		}
+		else
+		// #2 case, we'll typically see data
+		if(is_data(flags))
+		{
+			// Function between code start?
+			if(codeStart != BADADDR)
+			{
+				#ifdef LOG_FILE
+				Log(s_run->logFile, "  " EAFORMAT " Trying function #2\n", codeStart);
+				#endif
+				#ifdef VBDEV
+				msg(">" EAFORMAT " Trying function #2\n", codeStart);
+				#endif
+				tryFunction(codeStart, end, ea);
+			}
+
+			codeStart = BADADDR;
+		}
+		else
+		// Hit some code?
+		if(is_code(flags))
+		{
+			// Yes, mark the start of a possible code block
+			if(codeStart == BADADDR)
+			{
+				codeStart  = ea;
+
+				#ifdef LOG_FILE
+				Log(s_run->logFile, "  " EAFORMAT " Trying function #3, assumed func start\n", codeStart);
+				#endif
+				#ifdef VBDEV
+				msg(">" EAFORMAT " Trying function #3, assumed func start\n", codeStart);
+				#endif
+				if(tryFunction(codeStart, end, ea))
+					codeStart = BADADDR;
+			}
+		}
+		else
+		// Undefined?
+		// Usually 0xCC align bytes
+		if(is_unknown(flags))
+		{
+			#ifdef LOG_FILE
+			Log(s_run->logFile, "  C: " EAFORMAT " , Unknown type.\n", ea);
+			#endif
+			#ifdef VBDEV
+			msg("  C: " EAFORMAT ", Unknown type.\n", ea);
+			#endif
+			codeStart = BADADDR;
+		}
+		else
+		{
+			#ifdef LOG_FILE
+			Log(s_run->logFile, "  " EAFORMAT " ** unknown data type! **\n", ea);
+			#endif
+			#ifdef VBDEV
+			msg("  " EAFORMAT " ** unknown data type! **\n", ea);
+			#endif
+			codeStart = BADADDR;
+		}
+
+		// Next item
+		auto_wait();
+		ea_t nextEa = BADADDR;
+		if(ea != BADADDR)
+		{
+			nextEa = next_head(ea, end);
+			if(nextEa != BADADDR)
+				ea = nextEa;
+		}
+
+		if((nextEa == BADADDR) || (ea == BADADDR))
+		{
+			// If have code and at the end, try a function from the start
+			if(codeStart != BADADDR)
+			{
+				#ifdef LOG_FILE
+				Log(s_run->logFile, "  " EAFORMAT " Trying function #4\n", codeStart);
+				#endif
+				#ifdef VBDEV
+				msg(">" EAFORMAT " Trying function #4\n", codeStart);
+				#endif
+				tryFunction(codeStart, end, ea);
+				auto_wait();
+			}
+
+			#ifdef LOG_FILE
+			Log(s_run->logFile, " Gap end: " EAFORMAT ".\n", ea);
+			#endif
+			#ifdef VBDEV
+			msg(" Gap end: " EAFORMAT ".\n", ea);
+			#endif
+
+            break;
+		}
+
+    }; // while(ea < start)
+
+	return(BADADDR);
+}
+
+
+// The seed stage's gathered seeds, created a batch per call; returns TRUE while there are more
+static BOOL createSeeds()
+{
+	SEEDSTATE &seed = s_run->seed;
+	if (!seed.creating)
+	{
+		FuncSeed::prepare(seed.seeds);
+		seed.creating = TRUE;
+	}
+	return(FuncSeed::createBatch(seed.seeds, seed.nextSeed, seed.created));
+}
+
+// A seed stage's last steps, creating its seeds then showing "what" was found and the functions made.
+// Returns TRUE while there's more to create.
+static BOOL endSeedStage(const char *what)
+{
+	if (createSeeds())
+		return(TRUE);
+
+	char buffer[32], buffer2[32];
+	msg("%s: %s, functions made: %s\n", what, prettyNumberString(s_run->seed.found, buffer), prettyNumberString(s_run->seed.created, buffer2));
+	return(FALSE);
+}
+
+// Script binding stub clusters.
+// Many targets have thousands of byte identical, or near identical, small stubs in the function gaps.
+// Short code sequences ending in a return or jump are hashed with their branch displacements and
+// in image addresses masked out. One member of each hash class gets the full tryFunction() check,
+// if it turns out a good function the rest of the class is created in bulk as is.
+#define STUB_MAX_BYTES 64
+#define STUB_MAX_INSNS 16
+#define STUB_MIN_CLASS 3
+#define STUB_VERIFY_TRIES 2
+
+// Returns the normalized hash of the stub at "start", or 0 if it's not one
+static UINT64 hashStub(ea_t start, UINT &size)
+{
+	UINT64 hash = 14695981039346656037ULL; // FNV-1a
+	ea_t ea = start;
+	for (int i = 0; i < STUB_MAX_INSNS; i++)
+	{
+		insn_t cmd;
+		int length = decode_insn(&cmd, ea);
+		if ((length <= 0) || ((ea + length - start) > STUB_MAX_BYTES))
+			return(0);
+
+		BYTE bytes[32];
+		if (get_bytes(bytes, length, ea) != length)
+			return(0);
+
+		for (int j = 0; j < UA_MAXOP; j++)
+		{
+			const op_t &op = cmd.ops[j];
+			if (op.type == o_void)
+				break;
+
+			// Relative branch displacement runs to the end of the instruction
+			int maskStart = 0, maskEnd = 0;
+			if ((op.type == o_near) || (op.type == o_far))
+			{
+				maskStart = op.offb;
+				maskEnd = length;
+			}
+			else
+			// Address into the image, data pointer, string, handler, etc.
+			if (((op.type == o_imm) && is_mapped(op.value)) || (((op.type == o_mem) || (op.type == o_displ)) && is_mapped(op.addr)))
+			{
+				maskStart = op.offb;
+				maskEnd = std::min((op.offb + 4), length);
+			}
+			for (int k = maskStart; (k > 0) && (k < maskEnd); k++)
+				bytes[k] = 0;
+		}
+
+		for (int j = 0; j < length; j++)
+		{
+			hash ^= bytes[j];
+			hash *= 1099511628211ULL;
+		}
+
+		ea += length;
+		if (isItype(cmd.itype, (IC_RETURN | IC_JUMP)))
+		{
+			size = (UINT) (ea - start);
+			return(hash ^ size);
+		}
+	}
+	return(0);
+}
+
+// Gather the stub hash classes in the current function gaps and create the verified ones.
+// In steps: a gap at a time, a class verify at a time, then a creation batch at a time.
+static BOOL seedStubClusters(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedStubClusters");
+	SEEDSTATE &seed = s_run->seed;
+	if (seed.creating)
+		return(endSeedStage("Stub clusters"));
+
+	// Hash the stubs of the next gap
+	if (seed.phase == 0)
+	{
+		if (seed.index < s_run->gapList.size())
+		{
+			const GAPNODE &gap = s_run->gapList[seed.index++];
+
+			// Stubs start at code following anything else, or code not flowed into, as after the
+			// "ret" or "jmp" ending a back to back stub
+			ea_t end = (gap.start + gap.size);
+			BOOL prevCode = FALSE;
+			for (ea_t ea = gap.start; (ea < end) && (ea != BADADDR); ea = next_head(ea, end))
+			{
+				flags_t flags = get_flags(ea);
+				if (is_code(flags) && (!prevCode || !is_flow(flags)) && !get_fchunk(ea))
+				{
+					UINT size = 0;
+					if (UINT64 hash = hashStub(ea, size))
+					{
+						STUBCLASS &stubClass = seed.stubHashes[hash];
+						stubClass.size = size;
+						stubClass.members.push_back(ea);
+					}
+				}
+				prevCode = is_code(flags);
+			}
+			return(TRUE);
+		}
+
+		// Then the classes big enough
+		for (std::unordered_map<UINT64, STUBCLASS>::iterator it = seed.stubHashes.begin(); it != seed.stubHashes.end(); ++it)
+		{
+			if (it->second.members.size() >= STUB_MIN_CLASS)
+				seed.stubClasses.push_back(it->second);
+		}
+		seed.stubHashes.clear();
+		seed.index = 0;
+		seed.phase = 1;
+	}
+
+	// Verify a member of the next class the long way, must make a function of just the stub that ends as expected
+	if (seed.index < seed.stubClasses.size())
+	{
+		const STUBCLASS &stubClass = seed.stubClasses[seed.index++];
+		size_t verified = stubClass.members.size();
+		for (size_t i = 0; (i < STUB_VERIFY_TRIES) && (i < stubClass.members.size()); i++)
+		{
+			ea_t start = stubClass.members[i], current = start;
+			BOOL expected = FALSE;
+			if (tryFunction(start, BADADDR, current, &expected) && expected)
+			{
+				func_t *f = get_fchunk(start);
+				if (f && (f->start_ea == start) && (f->end_ea == (start + stubClass.size)))
+				{
+					verified = i;
+					break;
+				}
+			}
+		}
+		if (verified < stubClass.members.size())
+		{
+			seed.found++;
+			for (size_t i = (verified + 1); i < stubClass.members.size(); i++)
+			{
+				FUNCNODE node = { stubClass.members[i], stubClass.size };
+				seed.seeds.push_back(node);
+			}
+		}
+		return(TRUE);
+	}
+	return(endSeedStage("Stub clusters"));
+}
+// ----------------------------------------------------------------------------
+// No-return functions, see NoReturn. Once per run and ahead of everything that makes functions,
+// so the tails of the ones made after are judged against the propagated set.
+static BOOL seedNoReturn(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedNoReturn");
+	if (first)
+	{
+		if (s_run->seed.noretBuilt)
+			return(FALSE);
+		s_run->seed.noretBuilt = TRUE;
+		NoReturn::begin();
+	}
+	if (NoReturn::build(quantumEnd))
+		return(TRUE);
+
+	char buffer[32];
+	msg("No-return functions propagated: %s\n", prettyNumberString((UINT) NoReturn::marked(), buffer));
+	return(FALSE);
+}
+// ----------------------------------------------------------------------------
+// Control Flow Guard function table, see GuardCF. Once per run, the table covers the whole image.
+// Exact, so made in eSTATE_START ahead of the passes, whatever steps are on; they then work around its functions.
+static BOOL seedGuardTable(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedGuardTable");
+	SEEDSTATE &seed = s_run->seed;
+	if (first)
+	{
+		if (seed.guardSwept)
+			return(FALSE);
+		seed.guardSwept = TRUE;
+		seed.found = GuardCF::begin();
+		if (!seed.found)
+			return(FALSE);
+	}
+	if (!seed.creating && GuardCF::collect(seed.seeds, quantumEnd))
+		return(TRUE);
+	if (endSeedStage("Guard CF functions"))
+		return(TRUE);
+	msg("\n");
+	return(FALSE);
+}
+// ----------------------------------------------------------------------------
+// C++ EH catch and unwind funclets, and SEH filters, from the frame handler tables; see EhTables.
+// Once per run, the tables cover the whole image.
+static BOOL seedEhFunclets(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedEhFunclets");
+	SEEDSTATE &seed = s_run->seed;
+	if (first)
+	{
+		if (seed.ehSwept)
+			return(FALSE);
+		seed.ehSwept = TRUE;
+		EhTables::begin();
+	}
+	if (!seed.creating)
+	{
+		if (EhTables::collect(seed.seeds, quantumEnd))
+			return(TRUE);
+		seed.found = EhTables::tables();
+	}
+	return(endSeedStage("EH tables"));
+}
+// ----------------------------------------------------------------------------
+// Direct call and jump targets of the segment's code that IDA never made functions.
+// One snapshot sweep over the segment, then the lot is created in sorted batches.
+static BOOL seedCallTargets(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedCallTargets");
+	if (first)
+	{
+		s_run->callTargets.reset();
+		s_run->segStream.begin(s_run->cursor.start, s_run->cursor.end, s_run->options.streamMemory);
+		return(TRUE);
+	}
+	if (!s_run->seed.creating)
+	{
+		if (s_run->segStream.step(s_run->callTargets))
+			return(TRUE);
+		s_run->seed.seeds.swap(s_run->callTargets.seeds());
+		s_run->callTargets.reset();
+	}
+	if (createSeeds())
+		return(TRUE);
+
+	char buffer[32];
+	msg("Call targets, functions made: %s\n", prettyNumberString(s_run->seed.created, buffer));
+	return(FALSE);
+}
+// ----------------------------------------------------------------------------
+// Absolute pointers into the segment from the relocation table, kept by IDA as fixups.
+// Callbacks, dispatch tables, thread entries, etc. The targets outside of any function that decode
+// as a few instructions, and aren't just jumped to or flowed into (switch cases), are made functions.
+#define RELOC_CHECK_INSNS 3
+
+// Quick function start check of a relocation target
+static BOOL isRelocEntry(ea_t ea)
+{
+	flags_t flags = get_flags(ea);
+	if (is_tail(flags) || is_data(flags) || is_func(flags) || is_flow(flags) || get_fchunk(ea) || EmbeddedData::isPinned(ea))
+		return(FALSE);
+
+	xrefblk_t xb;
+	for (bool ok = xb.first_to(ea, XREF_FAR); ok; ok = xb.next_to())
+	{
+		if ((xb.type == fl_JN) || (xb.type == fl_JF))
+			return(FALSE);
+	}
+
+	ea_t current = ea;
+	for (int i = 0; i < RELOC_CHECK_INSNS; i++)
+	{
+		insn_t cmd;
+		int length = decode_insn(&cmd, current);
+		if (length <= 0)
+			return(FALSE);
+		if (isItype(cmd.itype, IC_TERMINATOR))
+			break;
+		current += length;
+	}
+	return(TRUE);
+}
+
+static BOOL seedRelocTargets(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedRelocTargets");
+	SEEDSTATE &seed = s_run->seed;
+	if (first)
+		seed.ea = get_first_fixup_ea();
+
+	for (BOOL worked = FALSE; !seed.creating && (seed.ea != BADADDR); seed.ea = get_next_fixup_ea(seed.ea), worked = TRUE)
+	{
+		if (worked && (getTimeStamp() >= quantumEnd))
+			return(TRUE);
+
+		fixup_data_t fd;
+		if (!get_fixup(&fd, seed.ea))
+			continue;
+
+		ea_t target;
+		switch (fd.get_type())
+		{
+			case FIXUP_OFF32: target = (ea_t) get_dword(seed.ea); break;
+			case FIXUP_OFF64: target = (ea_t) get_qword(seed.ea); break;
+			default: continue;
+		};
+		if ((target < s_run->cursor.start) || (target >= s_run->cursor.end))
+			continue;
+
+		seed.found++;
+		if (isRelocEntry(target))
+		{
+			FUNCNODE node = { target, 0 };
+			seed.seeds.push_back(node);
+		}
+	}
+	return(endSeedStage("Relocations into segment"));
+}
+// ----------------------------------------------------------------------------
+// Code pointer tables (vtables, callback and dispatch tables) in the data segments.
+// Swept once per run, a data segment per stream; the targets IDA missed are made functions.
+
+// Loaded data segment with room for pointer tables
+static BOOL isTableSegment(segment_t *seg)
+{
+	if (!seg || (seg->perm & SEGPERM_EXEC) || (seg->type == SEG_CODE))
+		return(FALSE);
+	switch (seg->type)
+	{
+		case SEG_NORM:
+		case SEG_DATA:
+		return(TRUE);
+	};
+	return(FALSE);
+}
+
+// Executable and data segment ranges, for the pointer sweeps
+static void getSegmentRanges(std::vector<range_t> &execRanges, std::vector<range_t> *dataRanges)
+{
+	for (int i = 0; i < get_segm_qty(); i++)
+	{
+		segment_t *seg = getnseg(i);
+		if (seg && ((seg->perm & SEGPERM_EXEC) || (seg->type == SEG_CODE)))
+			execRanges.push_back(range_t(seg->start_ea, seg->end_ea));
+		else
+		if (dataRanges && isTableSegment(seg))
+			dataRanges->push_back(range_t(seg->start_ea, seg->end_ea));
+	}
+}
+
+static BOOL seedPointerTables(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedPointerTables");
+	if (s_run->seed.creating)
+		return(endSeedStage("Code pointer tables"));
+	if (first)
+	{
+		if (s_run->seed.tablesSwept)
+			return(FALSE);
+		s_run->seed.tablesSwept = TRUE;
+
+		std::vector<range_t> execRanges;
+		getSegmentRanges(execRanges, NULL);
+		if (execRanges.empty())
+			return(FALSE);
+		s_run->pointerTables.setup(execRanges);
+		s_run->seed.tableSegIndex = -1;
+	}
+	else
+	if (s_run->segStream.step(s_run->pointerTables))
+		return(TRUE);
+
+	// Next data segment
+	while (++s_run->seed.tableSegIndex < get_segm_qty())
+	{
+		segment_t *seg = getnseg(s_run->seed.tableSegIndex);
+		if (isTableSegment(seg))
+		{
+			s_run->pointerTables.begin(seg->is_64bit() ? 8 : 4);
+			s_run->segStream.begin(seg->start_ea, seg->end_ea, s_run->options.streamMemory);
+			return(TRUE);
+		}
+	}
+
+	s_run->seed.found = s_run->pointerTables.tables();
+	s_run->seed.seeds.swap(s_run->pointerTables.seeds());
+	return(endSeedStage("Code pointer tables"));
+}
+
+// ----------------------------------------------------------------------------
+// Vtables found through their MSVC RTTI locators, see VtableClassifier.
+// Swept once per run like the pointer tables, but gets the vtables with less than PTR_TABLE_MIN_RUN slots too.
+static BOOL seedVtables(BOOL first, TIMESTAMP quantumEnd)
+{
+	PROFILE_SCOPE("seedVtables");
+	if (s_run->seed.creating)
+		return(endSeedStage("RTTI vtables"));
+	if (first)
+	{
+		if (s_run->seed.vtablesSwept)
+			return(FALSE);
+		s_run->seed.vtablesSwept = TRUE;
+
+		std::vector<range_t> execRanges, dataRanges;
+		getSegmentRanges(execRanges, &dataRanges);
+		if (execRanges.empty() || dataRanges.empty())
+			return(FALSE);
+		s_run->vtables.setup(execRanges, dataRanges);
+		s_run->seed.tableSegIndex = -1;
+	}
+	else
+	if (s_run->segStream.step(s_run->vtables))
+		return(TRUE);
+
+	// Next data segment
+	while (++s_run->seed.tableSegIndex < get_segm_qty())
+	{
+		segment_t *seg = getnseg(s_run->seed.tableSegIndex);
+		if (isTableSegment(seg))
+		{
+			s_run->vtables.begin(seg->is_64bit() ? 8 : 4);
+			s_run->segStream.begin(seg->start_ea, seg->end_ea, s_run->options.streamMemory);
+			return(TRUE);
+		}
+	}
+
+	s_run->seed.found = s_run->vtables.vtables();
+	s_run->seed.seeds.swap(s_run->vtables.seeds());
+	return(endSeedStage("RTTI vtables"));
+}
+
+// === Background incremental mode, see Incremental ===
+// The dirty ranges are worked in their own run context, swapped in for each time slice.
+static RUNCONTEXT s_idleRun;
+static int s_idleFuncs;
+
+// Next pass to redo after "state", eSTATE_FINISH when done.
+// Not the unknown data pass, it would undo the analyst's own data.
+static eSTATES nextIdlePass(eSTATES state)
+{
+	for (int next = std::max((state + 1), (int) eSTATE_PASS_2); next <= eSTATE_PASS_4; next++)
+	{
+		if (isPassEnabled(next - eSTATE_PASS_1))
+			return((eSTATES) next);
+	}
+	return(eSTATE_FINISH);
+}
+
+static void beginIdlePass()
+{
+	if (s_run->state == eSTATE_FINISH)
+		return;
+	s_run->cursor.rewind();
+	auto_wait();
+	s_run->stepTime = getTimeStamp();
+	if (s_run->state == eSTATE_PASS_4)
+		buildGapList(FALSE);
+	beginPass();
+}
+
+// Leave the range part way, ending its streams
+static void endIdleRange()
+{
+	endPass();
+	s_run->gapList.clear();
+	s_run->segStream.end();
+	s_run->pipeline.end();
+	s_run->state = eSTATE_FINISH;
+}
+
+// Incremental::RANGEWORK, census then the align block, missing code and missing function passes, a quantum per call
+static BOOL idleWork(const range_t &range, BOOL first)
+{
+	s_run = &s_idleRun;
+	BOOL more = FALSE;
+	try
+	{
+		if (first)
+		{
+			s_run->state = eSTATE_FINISH;
+			s_run->startFuncCount = get_func_qty();
+			s_run->funcAttempts = 0;
+			if (segment_t *seg = getseg(range.start_ea))
+			{
+				s_run->cursor.setRange(seg, range.start_ea, std::min(range.end_ea, seg->end_ea));
+				s_run->cursor.current = s_run->cursor.start;
+				s_run->census.reset(s_run->cursor.start, s_run->cursor.end);
+				s_run->segStream.begin(s_run->cursor.start, s_run->cursor.end, s_run->options.streamMemory);
+				s_run->state = eSTATE_START;
+			}
+		}
+
+		// The range's census first, see CensusClassifier
+		if (s_run->state == eSTATE_START)
+		{
+			TIMESTAMP quantumEnd = (getTimeStamp() + PASS_QUANTUM);
+			for (more = TRUE; more && (getTimeStamp() < quantumEnd);)
+				more = s_run->segStream.step(s_run->census);
+			if (!more)
+			{
+				if (!s_run->segStream.failed())
+					s_run->census.finish();
+				s_run->state = nextIdlePass(eSTATE_START);
+				beginIdlePass();
+			}
+		}
+		else
+		if (s_run->state != eSTATE_FINISH)
+		{
+			if (!runPass())
+			{
+				endPass();
+				s_run->gapList.clear();
+				s_run->state = nextIdlePass(s_run->state);
+				beginIdlePass();
+			}
+		}
+		more = (s_run->state != eSTATE_FINISH);
+	}
+	CATCH()
+
+	if (!more)
+	{
+		endIdleRange();
+		s_idleFuncs += ((int) get_func_qty() - (int) s_run->startFuncCount);
+
+		// Report the batch once the last dirty range is done
+		if ((Incremental::pending() == 0) && (s_run->alignFixes || s_run->codeFixes || s_idleFuncs))
+		{
+			msg("ExtraPass background: %u alignments, %u code fixes, %+d functions.\n", s_run->alignFixes, s_run->codeFixes, s_idleFuncs);
+			s_run->alignFixes = s_run->codeFixes = 0;
+			s_idleFuncs = 0;
+			refresh_idaview_anyway();
+		}
+	}
+	s_run = &s_mainRun;
+	return(more);
+}
+
+// Incremental::RANGEDROP
+static void idleDrop()
+{
+	s_run = &s_idleRun;
+	endIdleRange();
+	s_run = &s_mainRun;
+}
+
+// Stay resident, redoing the passes on the ranges of the processed segments edited from here on
+static void startResident()
+{
+	s_idleRun.options = s_mainRun.options;
+	s_idleRun.background = TRUE;
+	s_idleRun.state = eSTATE_FINISH;
+	s_idleRun.alignFixes = s_idleRun.codeFixes = 0;
+	s_idleRun.funcAttempts = 0;
+	s_idleFuncs = 0;
+	s_run = &s_idleRun;
+	selectProfile(s_mainRun.family);
+	s_run = &s_mainRun;
+
+	if (Incremental::start(s_mainRun.segments, idleWork, idleDrop))
+		msg("Background incremental mode on, until the plugin is run again.\n");
+	else
+		msg("** Failed to hook the IDB events, no background incremental mode! **\n");
+}
+
+// ============================================================================
+
+const char PLUGIN_NAME[] = "ExtraPass";
+
+// Plug-in description block
+extern "C" ALIGN(16) plugin_t PLUGIN =
+{
+	IDP_INTERFACE_VERSION,	// IDA version plug-in is written for
+	0,						// Plug-in flags, stays loaded for the non-modal problem list and the background incremental mode
+	plugin_init,			// Initialization function
+	plugin_exit,	        // Clean-up function
+	plugin_run,	            // Main plug-in body
+	PLUGIN_NAME,	        // Comment - unused
+	PLUGIN_NAME,	        // As above - unused
+	PLUGIN_NAME,	        // Plug-in name shown in Edit->Plugins menu
+	NULL                    // Hot key to run the plug-in
+};
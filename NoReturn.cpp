@@ -0,0 +1,240 @@
+// No-return function propagation
+#include "stdafx.h"
+#include <unordered_set>
+#include <deque>
+#include "NoReturn.h"
+#include "ItypeClass.h"
+#include "Profiler.h"
+
+namespace NoReturn
+{
+	// Known no-return runtime functions and imports, without the leading underscores
+	static const char * const s_names[] =
+	{
+		"exit",
+		"abort",
+		"ExitProcess",
+		"ExitThread",
+		"FatalExit",
+		"FatalAppExitA",
+		"FatalAppExitW",
+		"CxxThrowException",
+		"std_terminate",
+		"terminate",
+		"invalid_parameter_noinfo_noreturn",
+		"invoke_watson",
+		"report_gsfailure",
+		"report_rangecheckfailure",
+		"longjmp",
+	};
+
+	static std::unordered_set<ea_t> s_noret;
+	static std::deque<ea_t> s_work;
+	static size_t s_marked = 0;
+	static BOOL s_built = FALSE;
+
+	// Known name, skipping import and thunk prefixes
+	static BOOL isKnownName(const char *name)
+	{
+		if (strncmp(name, "__imp_", 6) == 0)
+			name += 6;
+		else
+		if (strncmp(name, "j_", 2) == 0)
+			name += 2;
+		while (*name == '_')
+			name++;
+
+		for (size_t i = 0; i < qnumber(s_names); i++)
+		{
+			if (strcmp(name, s_names[i]) == 0)
+				return(TRUE);
+		}
+		return(FALSE);
+	}
+
+	// Call or jump target of the instruction at "ea", direct or through an import pointer
+	static ea_t branchTarget(ea_t ea)
+	{
+		xrefblk_t xb;
+		if (xb.first_from(ea, XREF_FAR))
+			return(xb.to);
+		if (xb.first_from(ea, XREF_DATA))
+			return(xb.to);
+		return(BADADDR);
+	}
+
+	// Queue the functions that call or jump to "ea"
+	static void queueCallers(ea_t ea)
+	{
+		xrefblk_t xb;
+		for (bool ok = xb.first_to(ea, XREF_ALL); ok; ok = xb.next_to())
+		{
+			if (!xb.iscode && !is_code(get_flags(xb.from)))
+				continue;
+			if (func_t *f = get_fchunk(xb.from))
+			{
+				// Chunks belong to their owner
+				if (f->flags & FUNC_TAIL)
+					f = get_fchunk(f->owner);
+				if (f && !(f->flags & FUNC_NORET))
+					s_work.push_back(f->start_ea);
+			}
+		}
+	}
+
+	// Walk the function's flow chart, returns TRUE if no path gets to a return
+	static BOOL neverReturns(func_t *f)
+	{
+		qflow_chart_t fc("", f, BADADDR, BADADDR, FC_NOEXT);
+		int count = fc.size();
+		if (count <= 0)
+			return(FALSE);
+
+		std::vector<BYTE> visited(count, 0);
+		std::vector<int> stack(1, 0);
+		visited[0] = TRUE;
+		while (!stack.empty())
+		{
+			int node = stack.back();
+			stack.pop_back();
+			const qbasic_block_t &block = fc.blocks[node];
+
+			// A call to a no-return function ends the path
+			BOOL ended = FALSE;
+			ea_t last = BADADDR;
+			for (ea_t ea = block.start_ea; (ea < block.end_ea) && (ea != BADADDR); ea = next_head(ea, block.end_ea))
+			{
+				last = ea;
+				insn_t cmd;
+				if ((decode_insn(&cmd, ea) > 0) && isItype(cmd.itype, IC_CALL) && isNoReturn(branchTarget(ea)))
+				{
+					ended = TRUE;
+					break;
+				}
+			}
+			if (ended)
+				continue;
+
+			if (fc.nsucc(node) == 0)
+			{
+				// Exit block; a trap, or a tail jump to a no-return function, don't return
+				insn_t cmd;
+				if ((last == BADADDR) || (decode_insn(&cmd, last) <= 0))
+					return(FALSE);
+				BYTE classes = itypeClass(cmd.itype);
+				if (classes & IC_TRAP)
+					continue;
+				if ((classes & IC_JUMP) && !(classes & IC_INDIRECT) && isNoReturn(branchTarget(last)))
+					continue;
+				if ((classes & IC_CALL) && isNoReturn(branchTarget(last)))
+					continue;
+				return(FALSE);
+			}
+
+			for (int i = 0; i < fc.nsucc(node); i++)
+			{
+				int next = fc.succ(node, i);
+				if ((next >= 0) && (next < count) && !visited[next])
+				{
+					visited[next] = TRUE;
+					stack.push_back(next);
+				}
+			}
+		}
+		return(TRUE);
+	}
+
+	// Mark the function no-return, have IDA redo its callers and check them in turn
+	static void mark(func_t *f)
+	{
+		s_noret.insert(f->start_ea);
+		f->flags |= FUNC_NORET;
+		update_func(f);
+		reanalyze_callers(f->start_ea, true);
+		s_marked++;
+		queueCallers(f->start_ea);
+	}
+
+	// Work the queue to the fixed point, or until "until" when given; returns TRUE if there's more
+	static BOOL propagate(TIMESTAMP until = 0)
+	{
+		for (BOOL worked = FALSE; !s_work.empty(); worked = TRUE)
+		{
+			if (worked && until && (getTimeStamp() >= until))
+				return(TRUE);
+
+			ea_t start = s_work.front();
+			s_work.pop_front();
+			if (s_noret.find(start) != s_noret.end())
+				continue;
+
+			func_t *f = get_fchunk(start);
+			if (f && (f->start_ea == start) && !(f->flags & FUNC_NORET) && neverReturns(f))
+				mark(f);
+		}
+		return(FALSE);
+	}
+
+	void begin()
+	{
+		PROFILE_SCOPE("NoReturn::begin");
+		clear();
+
+		size_t count = get_func_qty();
+		for (size_t i = 0; i < count; i++)
+		{
+			func_t *f = getn_func(i);
+			if (f && (f->flags & FUNC_NORET))
+				s_noret.insert(f->start_ea);
+		}
+		for (size_t i = 0; i < get_nlist_size(); i++)
+		{
+			if (isKnownName(get_nlist_name(i)))
+				s_noret.insert(get_nlist_ea(i));
+		}
+
+		for (std::unordered_set<ea_t>::iterator it = s_noret.begin(); it != s_noret.end(); ++it)
+			queueCallers(*it);
+	}
+
+	BOOL build(TIMESTAMP until)
+	{
+		PROFILE_SCOPE("NoReturn::build");
+		if (propagate(until))
+			return(TRUE);
+		s_built = TRUE;
+		return(FALSE);
+	}
+
+	void clear()
+	{
+		s_noret.clear();
+		s_work.clear();
+		s_marked = 0;
+		s_built = FALSE;
+	}
+
+	void added(ea_t start)
+	{
+		if (!s_built)
+			return;
+		s_work.push_back(start);
+		propagate();
+	}
+
+	BOOL isNoReturn(ea_t ea)
+	{
+		if (ea == BADADDR)
+			return(FALSE);
+		if (s_noret.find(ea) != s_noret.end())
+			return(TRUE);
+
+		func_t *f = get_fchunk(ea);
+		return(f && (f->start_ea == ea) && (f->flags & FUNC_NORET));
+	}
+
+	size_t marked()
+	{
+		return(s_marked);
+	}
+};
@@ -0,0 +1,23 @@
+// No-return function propagation.
+// A function is no-return when every path through it ends in a call or jump to a no-return function,
+// or in a trap. Worked out to a fixed point from the known ones up the call graph, then kept up to
+// date as functions are added.
+#pragma once
+
+namespace NoReturn
+{
+	// Seed from the FUNC_NORET functions and the known no-return runtime names, then propagate
+	// with build() until it returns FALSE; it works until "until" per call
+	void begin();
+	BOOL build(TIMESTAMP until);
+	void clear();
+
+	// A function was added, check it and propagate if it turned out no-return
+	void added(ea_t start);
+
+	// TRUE if "ea" is a known or propagated no-return function or import
+	BOOL isNoReturn(ea_t ea);
+
+	// Functions marked by the propagation
+	size_t marked();
+};
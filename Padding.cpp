@@ -0,0 +1,183 @@
+// Code padding recognizer
+#include "stdafx.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include "Padding.h"
+
+// Not exported by the SDK headers, see Main.cpp
+#define FF_IVL 0x00000100LU	// Byte has value ?
+
+namespace Padding
+{
+	// Standard NOP and filler forms, each matched with one 16 byte compare
+	struct NOPFORM
+	{
+		BYTE length;
+		BOOL x86Only;	// 32 bit only, a 32 bit register write in 64 bit code
+		KIND kind;		// NOP, or a toolchain's FILLER
+		BYTE bytes[16];
+	};
+
+	static const NOPFORM s_forms[] =
+	{
+		// Longest first
+		{ 15, FALSE, NOP,    { 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 14, FALSE, NOP,    { 0x66, 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 13, FALSE, NOP,    { 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 12, FALSE, NOP,    { 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 11, FALSE, NOP,    { 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 10, FALSE, NOP,    { 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },	// nop cs:[rax+rax+0]
+		{  9, FALSE, NOP,    { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },		// nop [rax+rax+0]
+		{  8, FALSE, NOP,    { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{  7, FALSE, NOP,    { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 } },					// nop [rax+0]
+		{  7, TRUE,  NOP,    { 0x8D, 0xA4, 0x24, 0x00, 0x00, 0x00, 0x00 } },					// lea esp,[esp+0]
+		{  6, FALSE, NOP,    { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 } },
+		{  6, TRUE,  NOP,    { 0x8D, 0x9B, 0x00, 0x00, 0x00, 0x00 } },							// lea ebx,[ebx+0]
+		{  5, FALSE, NOP,    { 0x0F, 0x1F, 0x44, 0x00, 0x00 } },
+		{  4, FALSE, NOP,    { 0x0F, 0x1F, 0x40, 0x00 } },
+		{  4, TRUE,  NOP,    { 0x8D, 0x64, 0x24, 0x00 } },										// lea esp,[esp+0]
+		{  4, TRUE,  FILLER, { 0x8D, 0x44, 0x20, 0x00 } },										// lea eax,[eax+0], Delphi/BCB
+		{  3, FALSE, NOP,    { 0x0F, 0x1F, 0x00 } },
+		{  3, TRUE,  NOP,    { 0x8D, 0x49, 0x00 } },											// lea ecx,[ecx+0]
+		{  3, TRUE,  FILLER, { 0x8D, 0x40, 0x00 } },											// lea eax,[eax+0], Delphi/BCB
+		{  2, FALSE, NOP,    { 0x66, 0x90 } },													// xchg ax,ax
+		{  2, TRUE,  FILLER, { 0x8B, 0xC0 } },													// mov eax,eax, Delphi/BCB
+		{  1, FALSE, NOP,    { 0x90 } },
+	};
+	static const int FORM_COUNT = (sizeof(s_forms) / sizeof(NOPFORM));
+
+	// Compare masks, the low "length" bits
+	static inline UINT lengthMask(UINT length) { return((1 << length) - 1); }
+
+	// Same byte run length, 16 at a time
+	static UINT runLength(const BYTE *bytes, UINT size)
+	{
+		__m128i value = _mm_set1_epi8((char) bytes[0]);
+		UINT length = 0;
+		while ((length + 16) <= size)
+		{
+			UINT equal = (UINT) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (bytes + length)), value));
+			if (equal != 0xFFFF)
+			{
+				unsigned long index;
+				_BitScanForward(&index, ~equal);
+				return(length + (UINT) index);
+			}
+			length += 16;
+		}
+		while ((length < size) && (bytes[length] == bytes[0]))
+			length++;
+		return(length);
+	}
+
+	UINT match(const BYTE *bytes, UINT size, BOOL is64, KIND &kind)
+	{
+		kind = NONE;
+		if (size == 0)
+			return(0);
+
+		if (!isLeadByte(bytes[0]))
+			return(0);
+		if (bytes[0] == 0xCC)
+		{
+			kind = FILL_CC;
+			return(runLength(bytes, size));
+		}
+		if (bytes[0] == 0x00)
+		{
+			kind = FILL_ZERO;
+			return(runLength(bytes, size));
+		}
+
+		// Needs 16 readable bytes, else work on a copy
+		BYTE copy[16];
+		if (size < 16)
+		{
+			memset(copy, 0xFF, sizeof(copy));
+			memcpy(copy, bytes, size);
+			bytes = copy;
+		}
+
+		__m128i data = _mm_loadu_si128((const __m128i *) bytes);
+		for (int i = 0; i < FORM_COUNT; i++)
+		{
+			const NOPFORM &form = s_forms[i];
+			if ((form.length > size) || (form.x86Only && is64))
+				continue;
+
+			UINT equal = (UINT) _mm_movemask_epi8(_mm_cmpeq_epi8(data, _mm_loadu_si128((const __m128i *) form.bytes)));
+			UINT mask = lengthMask(form.length);
+			if ((equal & mask) == mask)
+			{
+				kind = form.kind;
+				return(form.length);
+			}
+		}
+		return(0);
+	}
+
+	void matchAll(const BYTE *bytes, UINT size, BOOL is64, BYTE *units)
+	{
+		// Back to front, so each fill byte gets the rest of its run
+		UINT run = 0;
+		for (UINT i = size; i-- > 0;)
+		{
+			BYTE value = bytes[i];
+			if ((value == 0xCC) || (value == 0x00))
+			{
+				run = ((((i + 1) < size) && (bytes[i + 1] == value)) ? std::min((run + 1), (UINT) UNIT_MAX_LENGTH) : 1);
+				units[i] = packUnit(((value == 0xCC) ? FILL_CC : FILL_ZERO), run);
+			}
+			else
+			{
+				KIND kind = NONE;
+				UINT length = (isLeadByte(value) ? match(&bytes[i], (size - i), is64, kind) : 0);
+				units[i] = (length ? packUnit(kind, length) : 0);
+				run = 0;
+			}
+		}
+	}
+
+	void packWindow(const FLAGWINDOW &window, std::vector<BYTE> &bytes)
+	{
+		size_t count = window.flags.size();
+		bytes.resize(count + 16);
+		const flags_t *flags = window.flags.data();
+		BYTE *out = bytes.data();
+
+		// 16 flags to 16 bytes
+		const __m128i valueMask = _mm_set1_epi32(0xFF), hasValue = _mm_set1_epi32((int) FF_IVL);
+		size_t i = 0;
+		for (; (i + 16) <= count; i += 16)
+		{
+			__m128i packed[4];
+			for (int j = 0; j < 4; j++)
+			{
+				__m128i f = _mm_loadu_si128((const __m128i *) (flags + i + (j * 4)));
+				__m128i noValue = _mm_cmpeq_epi32(_mm_and_si128(f, hasValue), _mm_setzero_si128());
+				packed[j] = _mm_or_si128(_mm_and_si128(f, valueMask), _mm_and_si128(noValue, valueMask));
+			}
+			__m128i words = _mm_packs_epi32(packed[0], packed[1]);
+			__m128i words2 = _mm_packs_epi32(packed[2], packed[3]);
+			_mm_storeu_si128((__m128i *) (out + i), _mm_packus_epi16(words, words2));
+		}
+		for (; i < count; i++)
+			out[i] = ((flags[i] & FF_IVL) ? (BYTE) flags[i] : 0xFF);
+		memset(out + count, 0xFF, 16);
+	}
+
+	UINT lengthAt(ea_t ea, ea_t end, BOOL is64, KIND &kind)
+	{
+		kind = NONE;
+		if (ea >= end)
+			return(0);
+
+		// Enough for a NOP form, or a fill run up to the next 16 byte boundary and one more
+		BYTE bytes[32];
+		UINT size = (UINT) std::min((ea_t) sizeof(bytes), (ea_t) (end - ea));
+		ssize_t got = get_bytes(bytes, size, ea);
+		if (got <= 0)
+			return(0);
+		return(match(bytes, (UINT) got, is64, kind));
+	}
+};
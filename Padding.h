@@ -0,0 +1,53 @@
+// Code padding recognizer
+// Besides the 0xCC and 0x90 fill bytes, compilers pad with the multi-byte NOP forms (GCC, Clang,
+// and newer MSVC), "lea reg,[reg+0]" fillers (older 32 bit MSVC), "mov eax,eax" and "lea" fillers
+// (Delphi/BCB), and sometimes zero bytes.
+#pragma once
+#include "SegStream.h"
+
+// Longest packed unit, see matchAll()
+#define UNIT_MAX_LENGTH 31
+
+namespace Padding
+{
+	// Padding unit kinds, a run is made of one kind
+	enum KIND
+	{
+		NONE,
+		FILL_CC,	// 0xCC "int 3" bytes
+		FILL_ZERO,	// 0x00 bytes
+		NOP,		// 0x90 and the multi-byte NOP forms
+		FILLER,		// Delphi/BCB "mov eax,eax" and "lea eax,[eax+0]", real code elsewhere
+	};
+
+	// TRUE if "value" can start a padding unit
+	inline BOOL isLeadByte(BYTE value)
+	{
+		switch (value)
+		{
+			case 0xCC: case 0x00: case 0x90: case 0x66: case 0x0F: case 0x8D: case 0x8B:
+			return(TRUE);
+		};
+		return(FALSE);
+	}
+
+	// Length of the padding unit at "bytes", with "size" bytes available, else zero.
+	// A fill unit is the whole same byte run, a NOP or filler unit is one instruction.
+	// Valueless bytes must be given as 0xFF, as get_bytes() does.
+	UINT match(const BYTE *bytes, UINT size, BOOL is64, KIND &kind);
+
+	// Unit at every position of "bytes", packed in a byte each as below; fill runs in chunks of up to UNIT_MAX_LENGTH.
+	// "bytes" needs 16 bytes of slack past "size", as packWindow() gives.
+	void matchAll(const BYTE *bytes, UINT size, BOOL is64, BYTE *units);
+
+	// Packed units, the kind in the top three bits
+	inline BYTE packUnit(KIND kind, UINT length) { return((BYTE) ((kind << 5) | length)); }
+	inline KIND unitKind(BYTE unit) { return((KIND) (unit >> 5)); }
+	inline UINT unitLength(BYTE unit) { return(unit & UNIT_MAX_LENGTH); }
+
+	// Pack a window's flag values to bytes, valueless ones as 0xFF, followed by 16 bytes of slack
+	void packWindow(const FLAGWINDOW &window, std::vector<BYTE> &bytes);
+
+	// Length of the padding unit at "ea", limited to "end", else zero; reads the database
+	UINT lengthAt(ea_t ea, ea_t end, BOOL is64, KIND &kind);
+};
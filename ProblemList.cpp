@@ -0,0 +1,138 @@
+// Problem function list
+#include "stdafx.h"
+#include <vector>
+#include "ProblemList.h"
+
+namespace ProblemList
+{
+	struct PROBLEM
+	{
+		ea_t func;
+		ea_t tail;
+		UINT itype;
+		REASON reason;
+	};
+	static std::vector<PROBLEM> s_problems;
+
+	static const char * const reasonNames[] =
+	{
+		"Falls through",
+		"Call may return",
+		"Undecoded tail",
+	};
+
+	static void getFuncName(qstring &name, ea_t ea)
+	{
+		if (get_name(&name, ea) <= 0)
+			name = "unknown";
+	}
+
+	// Export the list as tab separated text
+	static void exportList()
+	{
+		char *path = ask_file(true, "*.txt", "Export the problem function list to:");
+		if (!path)
+			return;
+
+		if (FILE *file = qfopen(path, "wb"))
+		{
+			qfprintf(file, "Tail\tFunction\tName\tReason\tInstruction\tItype\n");
+			for (std::vector<PROBLEM>::const_iterator it = s_problems.begin(); it != s_problems.end(); ++it)
+			{
+				qstring name, mnem;
+				getFuncName(name, it->func);
+				if (!print_insn_mnem(&mnem, it->tail))
+					mnem = "?";
+				qfprintf(file, EAFORMAT "\t" EAFORMAT "\t%s\t%s\t%s\t%u\n", it->tail, it->func, name.c_str(), reasonNames[it->reason], mnem.c_str(), it->itype);
+			}
+			qfclose(file);
+			msg("Problem function list exported to \"%s\".\n", path);
+		}
+		else
+			msg("** Export file \"%s\" open failed! **\n", path);
+	}
+
+	// Not named as chooser_t's members, which would shadow them in ProblemChooser
+	static const int columnWidths[] = { (CHCOL_HEX | 16), 32, 16, 10 };
+	static const char * const columnNames[] = { "Tail", "Function", "Reason", "Instruction" };
+	static const char chooserTitle[] = "ExtraPass: Problem functions";
+
+	// Non-modal, sortable by column; "Insert" is renamed to the export command
+	class ProblemChooser : public chooser_t
+	{
+	public:
+		ProblemChooser() : chooser_t((CH_KEEP | CH_CAN_INS), qnumber(columnWidths), columnWidths, columnNames, chooserTitle)
+		{
+			popup_names[POPUP_INS] = "Export...";
+		}
+
+		const void *get_obj_id(size_t *len) const
+		{
+			*len = strlen(chooserTitle);
+			return(chooserTitle);
+		}
+
+		size_t idaapi get_count() const { return(s_problems.size()); }
+
+		void idaapi get_row(qstrvec_t *cols, int *icon, chooser_item_attrs_t *attrs, size_t n) const
+		{
+			const PROBLEM &problem = s_problems[n];
+			(*cols)[0].sprnt(EAFORMAT, problem.tail);
+			getFuncName((*cols)[1], problem.func);
+			(*cols)[2] = reasonNames[problem.reason];
+			if (!print_insn_mnem(&(*cols)[3], problem.tail))
+				(*cols)[3] = "?";
+		}
+
+		ea_t idaapi get_ea(size_t n) const { return(s_problems[n].tail); }
+
+		cbret_t idaapi ins(ssize_t n)
+		{
+			exportList();
+			return(cbret_t(n, 0));
+		}
+	};
+
+	static ProblemChooser s_chooser;
+
+	void clear()
+	{
+		s_problems.clear();
+		refresh_chooser(chooserTitle);
+	}
+
+	void add(ea_t func, ea_t tail, UINT itype, REASON reason)
+	{
+		PROBLEM problem = { func, tail, itype, reason };
+		s_problems.push_back(problem);
+
+		if (s_problems.size() <= PROBLEM_MSG_LIMIT)
+		{
+			qstring name;
+			getFuncName(name, func);
+			msg(EAFORMAT " \"%s\" problem? <click me>\n", tail, name.c_str());
+			if (s_problems.size() == PROBLEM_MSG_LIMIT)
+				msg("More problem functions are only in the list shown at the end.\n");
+		}
+	}
+
+	size_t count()
+	{
+		return(s_problems.size());
+	}
+
+	void show()
+	{
+		if (s_problems.empty())
+			return;
+
+		char buffer[32];
+		msg("Problem functions: %s\n", prettyNumberString(s_problems.size(), buffer));
+		s_chooser.choose();
+	}
+
+	void close()
+	{
+		close_chooser(chooserTitle);
+	}
+};
@@ -0,0 +1,27 @@
+// Problem function list.
+// Functions tryFunction() made that don't end as expected are collected here rather than each one
+// written to the output window, then shown in one chooser at the end of the run.
+#pragma once
+
+// Problems also written to the output window as found, the rest are only in the list
+#define PROBLEM_MSG_LIMIT 10
+
+namespace ProblemList
+{
+	enum REASON
+	{
+		FALLS_THROUGH,	// Tail instruction flows on out of the function
+		CALL_RETURNS,	// Ends with a call to something not known as no-return
+		UNDECODED,		// Tail didn't decode
+	};
+
+	void clear();
+	void add(ea_t func, ea_t tail, UINT itype, REASON reason);
+	size_t count();
+
+	// Summary message and the chooser, if there are any
+	void show();
+
+	// Close the chooser, it's non-modal and mustn't outlive the plugin
+	void close();
+};
@@ -0,0 +1,189 @@
+// Scoped hot path profiler
+#include "stdafx.h"
+#include <vector>
+#include <algorithm>
+#include <string>
+#include "Profiler.h"
+
+// Duration histogram, quarter octave buckets of TSC ticks
+#define HISTOGRAM_SUB     4
+#define HISTOGRAM_BUCKETS (64 * HISTOGRAM_SUB)
+
+// Call sites listed in the output window report
+#define REPORT_TOP 25
+
+namespace Profiler
+{
+	BOOL enabled = FALSE;
+
+	struct NODE
+	{
+		const char *name;
+		UINT parent;
+		UINT64 count, ticks;
+		std::vector<UINT> children;
+		std::vector<UINT> histogram;
+	};
+
+	// Node 0 is the root
+	static std::vector<NODE> s_nodes;
+	static UINT s_current = 0;
+	static UINT64 s_startTicks = 0;
+	static TIMESTAMP s_startTime = 0;
+
+	static UINT newNode(const char *name, UINT parent)
+	{
+		NODE node;
+		node.name = name;
+		node.parent = parent;
+		node.count = node.ticks = 0;
+		s_nodes.push_back(node);
+		return((UINT) (s_nodes.size() - 1));
+	}
+
+	static UINT bucketOf(UINT64 ticks)
+	{
+		if (ticks < HISTOGRAM_SUB)
+			return((UINT) ticks);
+		DWORD top;
+		#ifdef _M_X64
+		_BitScanReverse64(&top, ticks);
+		#else
+		// x86 has no 64 bit scan
+		if (_BitScanReverse(&top, (DWORD) (ticks >> 32)))
+			top += 32;
+		else
+			_BitScanReverse(&top, (DWORD) ticks);
+		#endif
+		UINT sub = (UINT) ((ticks >> (top - 2)) & (HISTOGRAM_SUB - 1));
+		return(std::min((UINT) ((top * HISTOGRAM_SUB) + sub), (UINT) (HISTOGRAM_BUCKETS - 1)));
+	}
+
+	// Bucket's lower bound ticks
+	static UINT64 bucketTicks(UINT bucket)
+	{
+		UINT top = (bucket / HISTOGRAM_SUB), sub = (bucket % HISTOGRAM_SUB);
+		if (top < 2)
+			return(bucket);
+		return(((UINT64) (HISTOGRAM_SUB + sub)) << (top - 2));
+	}
+
+	void begin(BOOL enable)
+	{
+		s_nodes.clear();
+		newNode("ExtraPass", 0);
+		s_current = 0;
+		s_startTicks = __rdtsc();
+		s_startTime = getTimeStamp();
+		enabled = enable;
+	}
+
+	UINT enter(const char *name)
+	{
+		NODE &current = s_nodes[s_current];
+		for (std::vector<UINT>::iterator it = current.children.begin(); it != current.children.end(); ++it)
+		{
+			if ((s_nodes[*it].name == name) || (strcmp(s_nodes[*it].name, name) == 0))
+				return(s_current = *it);
+		}
+
+		UINT node = newNode(name, s_current);
+		s_nodes[s_current].children.push_back(node);
+		return(s_current = node);
+	}
+
+	void leave(UINT node, UINT64 start)
+	{
+		UINT64 ticks = (__rdtsc() - start);
+		NODE &n = s_nodes[node];
+		n.count++;
+		n.ticks += ticks;
+		if (n.histogram.empty())
+			n.histogram.resize(HISTOGRAM_BUCKETS);
+		n.histogram[bucketOf(ticks)]++;
+		s_current = n.parent;
+	}
+
+	static std::string pathOf(UINT node)
+	{
+		std::string path = s_nodes[node].name;
+		while (node)
+		{
+			node = s_nodes[node].parent;
+			path.insert(0, ";");
+			path.insert(0, s_nodes[node].name);
+		}
+		return(path);
+	}
+
+	static UINT64 selfTicks(const NODE &node)
+	{
+		UINT64 childTicks = 0;
+		for (std::vector<UINT>::const_iterator it = node.children.begin(); it != node.children.end(); ++it)
+			childTicks += s_nodes[*it].ticks;
+		return((node.ticks > childTicks) ? (node.ticks - childTicks) : 0);
+	}
+
+	static UINT64 percentile(const NODE &node, double fraction)
+	{
+		UINT64 target = (UINT64) ((double) node.count * fraction), seen = 0;
+		for (UINT i = 0; i < node.histogram.size(); i++)
+		{
+			seen += node.histogram[i];
+			if (seen > target)
+				return(bucketTicks(i));
+		}
+		return(0);
+	}
+
+	static bool byTicks(UINT a, UINT b) { return(s_nodes[a].ticks > s_nodes[b].ticks); }
+
+	void end()
+	{
+		if (!enabled)
+			return;
+		enabled = FALSE;
+
+		TIMESTAMP seconds = (getTimeStamp() - s_startTime);
+		UINT64 ticks = (__rdtsc() - s_startTicks);
+		double usPerTick = ((ticks && (seconds > 0)) ? ((seconds * 1e6) / (double) ticks) : 0);
+		s_nodes[0].count = 1;
+		s_nodes[0].ticks = ticks;
+
+		// Call sites by total time
+		std::vector<UINT> order;
+		for (UINT i = 1; i < s_nodes.size(); i++)
+			order.push_back(i);
+		std::sort(order.begin(), order.end(), byTicks);
+
+		msg("\n===== Profile =====\n");
+		msg("%10s %10s %10s %9s %9s %9s  %s\n", "Count", "Total ms", "Self ms", "p50 us", "p90 us", "p99 us", "Call site");
+		for (size_t i = 0; (i < order.size()) && (i < REPORT_TOP); i++)
+		{
+			const NODE &node = s_nodes[order[i]];
+			msg("%10llu %10.1f %10.1f %9.1f %9.1f %9.1f  %s\n", node.count, ((node.ticks * usPerTick) / 1000.0), ((selfTicks(node) * usPerTick) / 1000.0),
+				(percentile(node, 0.50) * usPerTick), (percentile(node, 0.90) * usPerTick), (percentile(node, 0.99) * usPerTick), pathOf(order[i]).c_str());
+		}
+
+		// Collapsed stacks, self time per path
+		qstring path(get_path(PATH_TYPE_IDB));
+		path += ".profile.txt";
+		if (FILE *file = qfopen(path.c_str(), "wb"))
+		{
+			for (UINT i = 0; i < s_nodes.size(); i++)
+			{
+				UINT64 us = (UINT64) (selfTicks(s_nodes[i]) * usPerTick);
+				if (us)
+					qfprintf(file, "%s %llu\n", pathOf(i).c_str(), us);
+			}
+			qfclose(file);
+			msg("Collapsed stacks written to \"%s\".\n", path.c_str());
+		}
+		else
+			msg("** Profile file \"%s\" open failed! **\n", path.c_str());
+		msg(" \n");
+
+		std::vector<NODE> empty;
+		s_nodes.swap(empty);
+	}
+};
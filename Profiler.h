@@ -0,0 +1,48 @@
+// Scoped hot path profiler.
+// Compiled in, but the scopes cost just a flag test unless enabled for the run. Main thread only,
+// don't use it in WindowClassifier::classify() or other worker code.
+// Scopes nest into a call tree; at the end of the run it's reported by call site with counts and
+// percentiles, and written in collapsed stack form ("a;b;c <self microseconds>") for flame graphs.
+#pragma once
+
+namespace Profiler
+{
+	extern BOOL enabled;
+
+	void begin(BOOL enable);
+	void end();	// Report, write "<IDB>.profile.txt" and free it
+
+	UINT enter(const char *name);
+	void leave(UINT node, UINT64 start);
+
+	class Scope
+	{
+	public:
+		Scope(const char *name) : m_node(0), m_start(0)
+		{
+			if (enabled)
+			{
+				m_node = enter(name);
+				m_start = __rdtsc();
+			}
+		}
+		~Scope()
+		{
+			if (m_start && enabled)
+				leave(m_node, m_start);
+		}
+
+	private:
+		UINT m_node;
+		UINT64 m_start;
+	};
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+
+// Time the rest of the enclosing block
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(_profileScope, __LINE__)(name)
+
+// Time an expression, a call site usually, keeping its value: if (PROFILE_CALL("add_func", add_func(ea))) ..
+#define PROFILE_CALL(name, expression) (Profiler::Scope(name), (expression))
@@ -0,0 +1,152 @@
+// Code pointer table finder for data segments; vtables, callback and dispatch tables, etc.
+#include "stdafx.h"
+#include <thread>
+#include <algorithm>
+#include "PtrTables.h"
+
+// Smallest window chunk worth a thread of its own
+#define MIN_CHUNK (64 * 1024)
+
+static bool rangeLess(const range_t &a, const range_t &b) { return(a.start_ea < b.start_ea); }
+
+PointerTableClassifier::PointerTableClassifier() : m_pointerSize(4), m_tables(0)
+{
+	m_carry.start = BADADDR;
+	m_carry.count = 0;
+}
+
+void PointerTableClassifier::setup(const std::vector<range_t> &execRanges)
+{
+	m_exec = execRanges;
+	std::sort(m_exec.begin(), m_exec.end(), rangeLess);
+	m_seeds.clear();
+	m_tables = 0;
+}
+
+void PointerTableClassifier::begin(UINT pointerSize)
+{
+	m_pointerSize = pointerSize;
+	m_carry.start = BADADDR;
+	m_carry.count = 0;
+	m_carry.targets.clear();
+}
+
+BOOL PointerTableClassifier::isExec(ea_t ea) const
+{
+	std::vector<range_t>::const_iterator it = std::upper_bound(m_exec.begin(), m_exec.end(), range_t(ea, ea), rangeLess);
+	if (it == m_exec.begin())
+		return(FALSE);
+	--it;
+	return(it->contains(ea));
+}
+
+// Gather the pointer runs of a window chunk, worker thread safe
+void PointerTableClassifier::findRuns(const FLAGWINDOW &window, ea_t from, ea_t to, std::vector<PTRRUN> &runs) const
+{
+	ea_t ea = ((from + (m_pointerSize - 1)) & ~((ea_t) m_pointerSize - 1));
+	PTRRUN *run = NULL;
+	for (; (ea < to) && ((ea + m_pointerSize) <= window.end); ea += m_pointerSize)
+	{
+		// Little endian pointer from the byte values, all must be initialized
+		UINT64 value = 0;
+		BOOL loaded = TRUE;
+		for (int i = (m_pointerSize - 1); i >= 0; i--)
+		{
+			flags_t flags = window[ea + i];
+			loaded &= has_value(flags);
+			value = ((value << 8) | (flags & 0xFF));
+		}
+
+		if (loaded && isExec((ea_t) value))
+		{
+			if (!run)
+			{
+				runs.push_back(PTRRUN());
+				run = &runs.back();
+				run->start = ea;
+				run->count = 0;
+			}
+			run->count++;
+			run->targets.push_back((ea_t) value);
+		}
+		else
+			run = NULL;
+	}
+}
+
+// Run complete, keep its targets if long enough to be a table
+void PointerTableClassifier::endRun()
+{
+	if (m_carry.count >= PTR_TABLE_MIN_RUN)
+	{
+		m_targets.insert(m_targets.end(), m_carry.targets.begin(), m_carry.targets.end());
+		m_tables++;
+	}
+	m_carry.start = BADADDR;
+	m_carry.count = 0;
+	m_carry.targets.clear();
+}
+
+void PointerTableClassifier::classify(const FLAGWINDOW &window)
+{
+	// Split on pointer aligned chunk boundaries over the hardware threads
+	size_t size = (size_t) (window.ownedEnd - window.start);
+	size_t threads = std::max((UINT) 1, std::thread::hardware_concurrency());
+	threads = std::max((size_t) 1, std::min(threads, (size / MIN_CHUNK)));
+	size_t chunkSize = (((size / threads) + m_pointerSize) & ~((size_t) m_pointerSize - 1));
+
+	std::vector<std::vector<PTRRUN> > chunkRuns(threads);
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < threads; i++)
+	{
+		ea_t from = (ea_t) (window.start + (i * chunkSize));
+		ea_t to = ((i == (threads - 1)) ? window.ownedEnd : (ea_t) std::min((UINT64) window.ownedEnd, ((UINT64) from + chunkSize)));
+		if (from >= to)
+			break;
+		if (i == 0)
+			findRuns(window, from, to, chunkRuns[i]);
+		else
+			workers.push_back(std::thread(&PointerTableClassifier::findRuns, this, std::cref(window), from, to, std::ref(chunkRuns[i])));
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	// Merge in address order, joining the runs that continue over chunk and window boundaries
+	for (size_t i = 0; i < chunkRuns.size(); i++)
+	{
+		for (std::vector<PTRRUN>::iterator it = chunkRuns[i].begin(); it != chunkRuns[i].end(); ++it)
+		{
+			if ((m_carry.count > 0) && ((m_carry.start + (m_carry.count * m_pointerSize)) == it->start))
+			{
+				m_carry.count += it->count;
+				m_carry.targets.insert(m_carry.targets.end(), it->targets.begin(), it->targets.end());
+			}
+			else
+			{
+				endRun();
+				m_carry.start = it->start;
+				m_carry.count = it->count;
+				m_carry.targets.swap(it->targets);
+			}
+		}
+	}
+
+	// Keep the open run only if it can continue in the next window
+	if (window.last || ((m_carry.count > 0) && ((m_carry.start + (m_carry.count * m_pointerSize)) < (window.ownedEnd - (m_pointerSize - 1)))))
+		endRun();
+}
+
+// Keep the targets that could be a function start, not inside an instruction or data
+void PointerTableClassifier::apply()
+{
+	for (std::vector<ea_t>::iterator it = m_targets.begin(); it != m_targets.end(); ++it)
+	{
+		flags_t flags = get_flags(*it);
+		if (is_tail(flags) || is_data(flags) || is_func(flags))
+			continue;
+
+		FUNCNODE seed = { *it, 0 };
+		m_seeds.push_back(seed);
+	}
+	m_targets.clear();
+}
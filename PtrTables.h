@@ -0,0 +1,42 @@
+// Code pointer table finder for data segments; vtables, callback and dispatch tables, etc.
+#pragma once
+#include <vector>
+#include "SegStream.h"
+#include "FuncSeed.h"
+
+// Minimal run of consecutive code pointers taken as a table
+#define PTR_TABLE_MIN_RUN 3
+
+// Finds aligned runs of pointers into executable segments in a data segment stream.
+// classify() splits each window over the hardware threads; runs are carried across chunks and windows.
+class PointerTableClassifier : public WindowClassifier
+{
+public:
+	PointerTableClassifier();
+
+	void setup(const std::vector<range_t> &execRanges);	// Sorted executable ranges
+	void begin(UINT pointerSize);							// Per data segment
+	void classify(const FLAGWINDOW &window);
+	void apply();
+
+	FUNCLIST &seeds() { return(m_seeds); }
+	UINT tables() const { return(m_tables); }
+
+	struct PTRRUN
+	{
+		ea_t start;
+		UINT count;
+		std::vector<ea_t> targets;
+	};
+
+private:
+	void findRuns(const FLAGWINDOW &window, ea_t from, ea_t to, std::vector<PTRRUN> &runs) const;
+	BOOL isExec(ea_t ea) const;
+	void endRun();
+
+	std::vector<range_t> m_exec;
+	std::vector<ea_t> m_targets;
+	FUNCLIST m_seeds;
+	PTRRUN m_carry;
+	UINT m_pointerSize, m_tables;
+};
@@ -0,0 +1,8 @@
+// Replay SDK shim, the IDA_Util sound player; silent
+#pragma once
+
+namespace OggPlay
+{
+	void playFromMemory(const void *source, int length, BOOL async = FALSE);
+	void endPlay();
+};
@@ -0,0 +1,13 @@
+// Replay SDK shim, the IDA_Util segment chooser; nothing chosen, the run takes the first code segment
+#pragma once
+#include <vector>
+
+struct segment_t;
+namespace SegSelect
+{
+	typedef std::vector<segment_t *> segments;
+	enum { CODE_HINT = 1, DATA_HINT = 2 };
+
+	segments *select(UINT flags, const char *title = NULL, const char *styleSheet = NULL, const char *icon = NULL);
+	void free(segments *&list);
+};
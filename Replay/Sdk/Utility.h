@@ -0,0 +1,20 @@
+// Replay SDK shim, the IDA_Util "Utility.h" support the plugin uses
+#pragma once
+#include <windows.h>
+
+#ifdef __EA64__
+#define EAFORMAT "%016llX"
+#else
+#define EAFORMAT "%08X"
+#endif
+
+#define ALIGN(_x) __attribute__((aligned(_x)))
+#define SIZESTR(_x) (sizeof(_x) - 1)
+#define CATCH() catch (...) { msg("** Exception in %s()! **\n", __FUNCTION__); }
+
+// Seconds
+typedef double TIMESTAMP;
+TIMESTAMP getTimeStamp();
+const char *timeString(TIMESTAMP seconds);
+const char *prettyNumberString(UINT64 n, char *buffer);
+void refreshUI();
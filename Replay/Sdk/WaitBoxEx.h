@@ -0,0 +1,11 @@
+// Replay SDK shim, the IDA_Util wait box; never shown, never canceled
+#pragma once
+
+namespace WaitBox
+{
+	void show(const char *titleText = NULL, const char *labelText = NULL, const char *styleSheet = NULL, const char *icon = NULL);
+	void hide();
+	BOOL isUpdateTime();
+	BOOL updateAndCancelCheck(int progress = 0);
+	void processIdaEvents();
+};
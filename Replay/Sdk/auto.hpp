@@ -0,0 +1,11 @@
+// Replay SDK shim, "auto.hpp"
+#pragma once
+#include "pro.h"
+
+typedef ushort atype_t;
+#define AU_UNK  10
+#define AU_CODE 20
+
+bool auto_wait();
+bool auto_is_ok();
+void auto_mark_range(ea_t start, ea_t end, atype_t type);
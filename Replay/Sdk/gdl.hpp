@@ -0,0 +1,22 @@
+// Replay SDK shim, "gdl.hpp", the flow charts come from the trace
+#pragma once
+#include "idp.hpp"
+
+#define FC_NOEXT 0x0002
+
+struct qbasic_block_t : range_t {};
+
+class qflow_chart_t
+{
+public:
+	qflow_chart_t(const char *title, func_t *pfn, ea_t ea1, ea_t ea2, int flags);
+
+	int size() const { return((int) blocks.size()); }
+	int nsucc(int node) const { return((int) m_succs[node].size()); }
+	int succ(int node, int i) const { return(m_succs[node][i]); }
+
+	qvector<qbasic_block_t> blocks;
+
+private:
+	std::vector< std::vector<int> > m_succs;
+};
@@ -0,0 +1,310 @@
+// Replay SDK shim, the IDB, instruction and UI interfaces the plugin uses.
+// Flag, operand and xref values are IDA's, they come back from the trace as is.
+// "../StandIn.cpp" implements them against the trace's stand-in database.
+#pragma once
+#include "pro.h"
+
+// ---- bytes.hpp ----
+typedef uint32 flags_t;
+
+#define MS_VAL  0x000000FFLU
+#define FF_IVL  0x00000100LU
+#define MS_CLS  0x00000600LU
+#define FF_CODE 0x00000600LU
+#define FF_DATA 0x00000400LU
+#define FF_TAIL 0x00000200LU
+#define FF_UNK  0x00000000LU
+#define FF_REF  0x00001000LU
+#define FF_FLOW 0x00010000LU
+#define MS_0TYPE 0x00F00000LU
+#define FF_0OFF 0x00500000LU
+#define DT_TYPE 0xF0000000LU
+#define FF_BYTE 0x00000000LU
+#define FF_ALIGN 0xB0000000LU
+#define FF_FUNC 0x10000000LU
+
+inline bool is_code(flags_t flags) { return((flags & MS_CLS) == FF_CODE); }
+inline bool is_data(flags_t flags) { return((flags & MS_CLS) == FF_DATA); }
+inline bool is_tail(flags_t flags) { return((flags & MS_CLS) == FF_TAIL); }
+inline bool is_unknown(flags_t flags) { return((flags & MS_CLS) == FF_UNK); }
+inline bool is_head(flags_t flags) { return((flags & FF_DATA) != 0); }
+inline bool is_flow(flags_t flags) { return((flags & FF_FLOW) != 0); }
+inline bool has_value(flags_t flags) { return((flags & FF_IVL) != 0); }
+inline bool is_func(flags_t flags) { return(is_code(flags) && ((flags & FF_FUNC) != 0)); }
+inline bool is_align(flags_t flags) { return(is_data(flags) && ((flags & DT_TYPE) == FF_ALIGN)); }
+
+typedef bool idaapi testf_t(flags_t flags, void *ud);
+
+flags_t get_flags(ea_t ea);
+flags_t get_full_flags(ea_t ea);
+uint32 get_dword(ea_t ea);
+uint64 get_qword(ea_t ea);
+ssize_t get_bytes(void *buf, ssize_t size, ea_t ea, int gmb_flags = 0, void *mask = NULL);
+bool is_mapped(ea_t ea);
+ea_t next_head(ea_t ea, ea_t maxea);
+ea_t prev_head(ea_t ea, ea_t minea);
+ea_t next_that(ea_t ea, ea_t maxea, testf_t *testf, void *ud = NULL);
+ea_t next_unknown(ea_t ea, ea_t maxea);
+ea_t get_item_end(ea_t ea);
+asize_t get_item_size(ea_t ea);
+
+#define DELIT_SIMPLE  0x0000
+#define DELIT_NOTRUNC 0x0004
+bool del_items(ea_t ea, int flags = 0, asize_t nbytes = 1, bool (idaapi *may_destroy)(ea_t ea) = NULL);
+bool create_byte(ea_t ea, asize_t length);
+bool create_align(ea_t ea, asize_t length, int alignment);
+
+// ---- ua.hpp ----
+enum { o_void, o_reg, o_mem, o_phrase, o_displ, o_imm, o_far, o_near };
+enum { dt_byte, dt_word, dt_dword, dt_float, dt_double, dt_tbyte, dt_packreal, dt_qword, dt_byte16 };
+
+struct op_t
+{
+	uchar n;
+	uchar type;
+	char offb, offo;
+	uchar flags;
+	char dtype;
+	union
+	{
+		ushort reg;
+		ushort phrase;
+	};
+	uval_t value;
+	ea_t addr;
+};
+
+#define UA_MAXOP 8
+struct insn_t
+{
+	ea_t ea;
+	uint16 itype;
+	uint16 size;
+	op_t ops[UA_MAXOP];
+};
+
+int decode_insn(insn_t *out, ea_t ea);
+ea_t decode_prev_insn(insn_t *out, ea_t ea);
+int create_insn(ea_t ea, insn_t *out = NULL);
+bool print_insn_mnem(qstring *out, ea_t ea);
+
+// ---- xref.hpp ----
+#define XREF_ALL  0x00
+#define XREF_FAR  0x01
+#define XREF_DATA 0x02
+enum cref_t { fl_U, fl_CF = 16, fl_CN, fl_JF, fl_JN, fl_USobsolete, fl_F };
+
+struct xrefblk_t
+{
+	ea_t from, to;
+	uchar iscode;
+	uchar type;
+	uchar user;
+	int flags;	// Stand-in, the iteration's XREF_ flags
+
+	bool first_from(ea_t from, int flags);
+	bool next_from();
+	bool first_to(ea_t to, int flags);
+	bool next_to();
+};
+
+ea_t get_first_cref_from(ea_t from);
+ea_t get_first_cref_to(ea_t to);
+ea_t get_first_dref_from(ea_t from);
+ea_t get_first_dref_to(ea_t to);
+
+// ---- funcs.hpp ----
+#define FUNC_NORET 0x00000001
+#define FUNC_THUNK 0x00000080
+#define FUNC_TAIL  0x00008000
+
+struct func_t : range_t
+{
+	uint64 flags;
+	ea_t owner;	// Tails, the function's start
+};
+
+func_t *get_func(ea_t ea);
+func_t *get_fchunk(ea_t ea);
+func_t *get_prev_fchunk(ea_t ea);
+func_t *get_next_fchunk(ea_t ea);
+func_t *get_next_func(ea_t ea);
+func_t *getn_func(size_t n);
+size_t get_func_qty();
+bool add_func(ea_t ea1, ea_t ea2 = BADADDR);
+bool update_func(func_t *pfn);
+void reanalyze_callers(ea_t ea, bool noret);
+
+// ---- segment.hpp ----
+#define SEG_NORM 0
+#define SEG_CODE 2
+#define SEG_DATA 3
+#define SEGPERM_EXEC  1
+#define SEGPERM_WRITE 2
+#define SEGPERM_READ  4
+
+struct segment_t : range_t
+{
+	uchar perm;
+	uchar bitness;
+	uchar type;
+
+	bool is_64bit() const { return(bitness == 2); }
+};
+
+segment_t *getseg(ea_t ea);
+segment_t *getnseg(int n);
+int get_segm_qty();
+ssize_t get_segm_name(qstring *buf, const segment_t *s, int flags = 0);
+ssize_t get_segm_class(qstring *buf, const segment_t *s);
+
+// ---- nalt.hpp ----
+#define SWI_SPARSE   0x00000001
+#define SWI_INDIRECT 0x00010000
+
+struct switch_info_t
+{
+	uint32 flags;
+	ushort ncases;
+	ea_t jumps;
+	ea_t values;
+	int jcases;
+	int jsize, vsize;	// Stand-in, the recorded table element sizes
+
+	int get_jtable_element_size() const { return(jsize); }
+	int get_vtable_element_size() const { return(vsize); }
+};
+
+ssize_t get_switch_info(switch_info_t *out, ea_t ea);
+ssize_t get_input_file_path(char *buf, size_t bufsize);
+ea_t get_imagebase();
+
+// ---- fixup.hpp ----
+#define FIXUP_OFF32 4
+#define FIXUP_OFF64 12
+typedef uint16 fixup_type_t;
+
+struct fixup_data_t
+{
+	fixup_type_t type;
+	fixup_type_t get_type() const { return(type); }
+};
+
+ea_t get_first_fixup_ea();
+ea_t get_next_fixup_ea(ea_t ea);
+bool get_fixup(fixup_data_t *fd, ea_t source);
+
+// ---- netnode.hpp ----
+#define BADNODE ((nodeidx_t) -1)
+
+class netnode
+{
+public:
+	netnode(const char *name, size_t namlen = 0, bool do_create = false);
+
+	nodeidx_t altval(nodeidx_t alt, uchar tag = 'A') const;
+	bool altset(nodeidx_t alt, nodeidx_t value, uchar tag = 'A');
+	bool altdel(nodeidx_t alt, uchar tag = 'A');
+	nodeidx_t altfirst(uchar tag = 'A') const;
+	nodeidx_t altnext(nodeidx_t cur, uchar tag = 'A') const;
+	ssize_t supval(nodeidx_t alt, void *buf, size_t bufsize, uchar tag = 'S') const;
+	bool supset(nodeidx_t alt, const void *value, size_t length = 0, uchar tag = 'S');
+	ssize_t valobj(void *buf, size_t bufsize) const;
+
+	operator nodeidx_t() const { return(m_index); }
+
+private:
+	nodeidx_t m_index;
+};
+
+// ---- ida.hpp, idp.hpp ----
+struct idainfo
+{
+	ea_t min_ea, max_ea;
+	bool is64;	// Stand-in
+
+	bool is_64bit() const { return(is64); }
+};
+extern idainfo inf;
+
+#define PLFM_386 0
+struct processor_t
+{
+	int id;
+};
+extern processor_t ph;
+
+enum path_type_t { PATH_TYPE_CMD, PATH_TYPE_IDB, PATH_TYPE_ID0 };
+const char *get_path(path_type_t pt);
+
+// ---- kernwin.hpp ----
+class TWidget;
+int msg(const char *format, ...);
+int ask_form(const char *form, ...);
+char *ask_file(bool for_saving, const char *defval, const char *format, ...);
+bool open_url(const char *url);
+void refresh_idaview_anyway();
+void set_user_defined_prefix(size_t width, void (idaapi *get_user_defined_prefix)(qstring *buf, ea_t ea, int lnnum, int indent, const char *line));
+
+typedef struct qtimer_t__ *qtimer_t;
+qtimer_t register_timer(int interval, int (idaapi *callback)(void *ud), void *ud);
+bool unregister_timer(qtimer_t t);
+
+enum hook_type_t { HT_IDP, HT_UI, HT_DBG, HT_IDB, HT_DEV, HT_VIEW, HT_OUTPUT, HT_GRAPH, HT_IDD, HT_LAST };
+typedef ssize_t idaapi hook_cb_t(void *user_data, int notification_code, va_list va);
+bool hook_to_notification_point(hook_type_t hook_type, hook_cb_t *cb, void *user_data = NULL);
+int unhook_from_notification_point(hook_type_t hook_type, hook_cb_t *cb, void *user_data = NULL);
+
+// The stand-in fires the item ones, make_code, make_data and destroyed_items; the rest only need their names
+namespace idb_event
+{
+	enum event_code_t
+	{
+		closebase, segm_added, segm_deleted, segm_start_changed, segm_end_changed, segm_moved,
+		func_added, func_updated, set_func_start, set_func_end, deleting_func, func_tail_appended,
+		deleting_func_tail, func_tail_deleted, tail_owner_changed, make_code, make_data, destroyed_items,
+	};
+};
+
+#define CH_KEEP    0x00000002
+#define CH_CAN_INS 0x00000400
+#define CHCOL_PLAIN 0x00000000
+#define CHCOL_HEX   0x00010000
+
+struct chooser_item_attrs_t;
+class chooser_t
+{
+public:
+	struct cbret_t
+	{
+		ssize_t idx;
+		int changed;
+
+		cbret_t() : idx(-1), changed(0) {}
+		cbret_t(ssize_t index, int change = 1) : idx(index), changed(change) {}
+	};
+	enum { POPUP_INS, POPUP_DEL, POPUP_EDIT, POPUP_REFRESH, NSTDPOPUPS };
+
+	chooser_t(uint32 flags = 0, int columns = 0, const int *widths = NULL, const char *const *header = NULL, const char *title = NULL) :
+		popup_names(), flags(flags), columns(columns), widths(widths), header(header), title(title) {}
+	virtual ~chooser_t() {}
+
+	virtual const void *get_obj_id(size_t *len) const { *len = 0; return(NULL); }
+	virtual size_t idaapi get_count() const = 0;
+	virtual void idaapi get_row(qstrvec_t *cols, int *icon, chooser_item_attrs_t *attrs, size_t n) const = 0;
+	virtual ea_t idaapi get_ea(size_t n) const { return(BADADDR); }
+	virtual cbret_t idaapi enter(size_t n) { return(cbret_t()); }
+	virtual cbret_t idaapi ins(ssize_t n) { return(cbret_t()); }
+	virtual void idaapi closed() {}
+	ssize_t choose(ssize_t deflt = 0) const;
+
+	const char *popup_names[NSTDPOPUPS];
+	uint32 flags;
+	int columns;
+	const int *widths;
+	const char *const *header;
+	const char *title;
+};
+
+bool close_chooser(const char *title);
+bool refresh_chooser(const char *title);
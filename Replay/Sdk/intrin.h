@@ -0,0 +1,30 @@
+// Replay SDK shim, the MSVC intrinsics the plugin uses
+#pragma once
+#include <x86intrin.h>
+
+inline unsigned char _BitScanForward(unsigned long *index, unsigned long mask)
+{
+	if (!mask)
+		return(0);
+	*index = (unsigned long) __builtin_ctzl(mask);
+	return(1);
+}
+
+inline unsigned char _BitScanReverse(unsigned long *index, unsigned long mask)
+{
+	if (!mask)
+		return(0);
+	*index = (unsigned long) (31 - __builtin_clz((unsigned int) mask));
+	return(1);
+}
+
+inline unsigned char _BitScanReverse64(unsigned long *index, unsigned long long mask)
+{
+	if (!mask)
+		return(0);
+	*index = (unsigned long) (63 - __builtin_clzll(mask));
+	return(1);
+}
+
+inline unsigned int __popcnt(unsigned int value) { return((unsigned int) __builtin_popcount(value)); }
+#define _byteswap_ulong __builtin_bswap32
@@ -0,0 +1,21 @@
+// Replay SDK shim, "loader.hpp"
+#pragma once
+#include "pro.h"
+
+#define IDP_INTERFACE_VERSION 700
+#define PLUGIN_SKIP 0
+#define PLUGIN_OK   1
+#define PLUGIN_KEEP 2
+
+struct plugin_t
+{
+	int version;
+	int flags;
+	int (idaapi *init)();
+	void (idaapi *term)();
+	bool (idaapi *run)(size_t arg);
+	const char *comment;
+	const char *help;
+	const char *wanted_name;
+	const char *wanted_hotkey;
+};
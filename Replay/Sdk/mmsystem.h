@@ -0,0 +1,2 @@
+// Replay SDK shim, nothing the plugin uses
+#pragma once
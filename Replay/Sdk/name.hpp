@@ -0,0 +1,9 @@
+// Replay SDK shim, "name.hpp"
+#pragma once
+#include "pro.h"
+
+ssize_t get_name(qstring *out, ea_t ea, int gtn_flags = 0);
+ea_t get_name_ea(ea_t from, const char *name);
+size_t get_nlist_size();
+ea_t get_nlist_ea(size_t idx);
+const char *get_nlist_name(size_t idx);
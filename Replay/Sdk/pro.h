@@ -0,0 +1,109 @@
+// Replay SDK shim, the "pro.h" basics the plugin uses.
+// Same names, values and layouts where the trace or the pass code depends on them.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define idaapi
+#define idaman
+#define ida_export
+#define THREAD_SAFE
+#define ENUM_SIZE(_type) : _type
+
+typedef uint8_t  uchar;
+typedef uint16_t ushort;
+typedef int8_t   int8;
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef int32_t  int32;
+typedef uint32_t uint32;
+typedef int64_t  int64;
+typedef uint64_t uint64;
+
+#ifdef __EA64__
+typedef uint64 ea_t;
+typedef uint64 asize_t;
+typedef uint64 uval_t;
+typedef int64  sval_t;
+typedef int64  adiff_t;
+#else
+typedef uint32 ea_t;
+typedef uint32 asize_t;
+typedef uint32 uval_t;
+typedef int32  sval_t;
+typedef int32  adiff_t;
+#endif
+typedef ea_t tid_t;
+typedef uval_t nodeidx_t;
+
+#define BADADDR ((ea_t) -1)
+#define MAXNAMELEN 512
+#define QMAXPATH   260
+#define qnumber(_array) (sizeof(_array) / sizeof((_array)[0]))
+
+template<class T> class qvector : public std::vector<T>
+{
+public:
+	void push_back(const T &value) { std::vector<T>::push_back(value); }
+	T &push_back() { this->emplace_back(); return(this->back()); }
+	void qclear() { this->clear(); }
+};
+
+class qstring
+{
+public:
+	qstring() {}
+	qstring(const char *text) : m_text(text) {}
+
+	const char *c_str() const { return(m_text.c_str()); }
+	size_t length() const { return(m_text.length()); }
+	bool empty() const { return(m_text.empty()); }
+	void clear() { m_text.clear(); }
+	char operator[](size_t index) const { return(m_text[index]); }
+	bool operator==(const char *text) const { return(m_text == text); }
+	qstring &operator=(const char *text) { m_text = text; return(*this); }
+	qstring &operator+=(const char *text) { m_text += text; return(*this); }
+	size_t sprnt(const char *format, ...);
+	size_t cat_sprnt(const char *format, ...);
+
+private:
+	std::string m_text;
+};
+typedef qvector<qstring> qstrvec_t;
+
+struct range_t
+{
+	ea_t start_ea, end_ea;
+
+	range_t(ea_t start = 0, ea_t end = 0) : start_ea(start), end_ea(end) {}
+	asize_t size() const { return(end_ea - start_ea); }
+	bool contains(ea_t ea) const { return((ea >= start_ea) && (ea < end_ea)); }
+	bool empty() const { return(end_ea <= start_ea); }
+};
+
+// Sorted, merged ranges
+class rangeset_t
+{
+public:
+	bool add(const range_t &range);
+	bool sub(const range_t &range);
+	size_t nranges() const { return(m_ranges.size()); }
+	const range_t &getrange(int index) const { return(m_ranges[index]); }
+	bool empty() const { return(m_ranges.empty()); }
+	void clear() { m_ranges.clear(); }
+
+private:
+	std::vector<range_t> m_ranges;
+};
+
+FILE *qfopen(const char *file, const char *mode);
+int qfclose(FILE *fp);
+ssize_t qfread(FILE *fp, void *buf, size_t size);
+ssize_t qfwrite(FILE *fp, const void *buf, size_t size);
+int qfprintf(FILE *fp, const char *format, ...);
+bool qgetenv(const char *varname, qstring *buf = NULL);
+char *qstrncpy(char *dst, const char *src, size_t dstsize);
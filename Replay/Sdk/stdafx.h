@@ -0,0 +1,3 @@
+// The plugin's sources include "stdafx.h", Linux file names are case sensitive
+#pragma once
+#include "../../StdAfx.h"
@@ -0,0 +1,51 @@
+// Replay SDK shim, the Win32 types and macros the plugin uses
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned int UINT;
+typedef unsigned long DWORD;
+typedef void *PVOID;
+typedef int32_t INT32;
+typedef int64_t INT64;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+
+#define TRUE  1
+#define FALSE 0
+
+#define MAKEWORD(_low, _high) ((WORD) (((BYTE) (_low)) | (((WORD) ((BYTE) (_high))) << 8)))
+#define LOBYTE(_w) ((BYTE) (_w))
+#define HIBYTE(_w) ((BYTE) (((WORD) (_w) >> 8) & 0xFF))
+
+#define __forceinline inline
+#define __declspec(_x)
+
+struct IMAGE_DOS_HEADER
+{
+	WORD e_magic;
+	BYTE e_reserved[58];
+	INT32 e_lfanew;
+};
+
+inline void *_aligned_malloc(size_t size, size_t alignment)
+{
+	void *p = NULL;
+	return((posix_memalign(&p, alignment, size) == 0) ? p : NULL);
+}
+inline void _aligned_free(void *p) { free(p); }
+
+inline char *_strlwr(char *text)
+{
+	for (char *p = text; *p; p++)
+		*p = (char) tolower(*p);
+	return(text);
+}
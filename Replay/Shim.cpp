@@ -0,0 +1,208 @@
+// Replay SDK shim, the parts with no database behind them: "pro.h" support, the UI, IDA_Util.
+// A replay has no user; dialogs take their defaults, nothing is shown or canceled.
+#include "stdafx.h"
+#include <chrono>
+#include <algorithm>
+#include <SegSelect.h>
+#include <IdaOgg.h>
+
+// ---- pro.h ----
+size_t qstring::sprnt(const char *format, ...)
+{
+	char buffer[1024];
+	va_list va;
+	va_start(va, format);
+	vsnprintf(buffer, sizeof(buffer), format, va);
+	va_end(va);
+	m_text = buffer;
+	return(m_text.length());
+}
+
+size_t qstring::cat_sprnt(const char *format, ...)
+{
+	char buffer[1024];
+	va_list va;
+	va_start(va, format);
+	vsnprintf(buffer, sizeof(buffer), format, va);
+	va_end(va);
+	m_text += buffer;
+	return(m_text.length());
+}
+
+bool rangeset_t::add(const range_t &range)
+{
+	if (range.empty())
+		return(false);
+
+	// Merge with every range it touches
+	range_t merged = range;
+	std::vector<range_t>::iterator it = m_ranges.begin();
+	while ((it != m_ranges.end()) && (it->end_ea < merged.start_ea))
+		++it;
+	std::vector<range_t>::iterator first = it;
+	for (; (it != m_ranges.end()) && (it->start_ea <= merged.end_ea); ++it)
+	{
+		merged.start_ea = std::min(merged.start_ea, it->start_ea);
+		merged.end_ea   = std::max(merged.end_ea, it->end_ea);
+	}
+	it = m_ranges.erase(first, it);
+	m_ranges.insert(it, merged);
+	return(true);
+}
+
+bool rangeset_t::sub(const range_t &range)
+{
+	if (range.empty())
+		return(false);
+
+	bool changed = false;
+	std::vector<range_t> result;
+	for (std::vector<range_t>::iterator it = m_ranges.begin(); it != m_ranges.end(); ++it)
+	{
+		if ((it->end_ea <= range.start_ea) || (it->start_ea >= range.end_ea))
+		{
+			result.push_back(*it);
+			continue;
+		}
+		changed = true;
+		if (it->start_ea < range.start_ea)
+			result.push_back(range_t(it->start_ea, range.start_ea));
+		if (it->end_ea > range.end_ea)
+			result.push_back(range_t(range.end_ea, it->end_ea));
+	}
+	m_ranges.swap(result);
+	return(changed);
+}
+
+FILE *qfopen(const char *file, const char *mode) { return(fopen(file, mode)); }
+int qfclose(FILE *fp) { return(fclose(fp)); }
+ssize_t qfread(FILE *fp, void *buf, size_t size) { return((ssize_t) fread(buf, 1, size, fp)); }
+ssize_t qfwrite(FILE *fp, const void *buf, size_t size) { return((ssize_t) fwrite(buf, 1, size, fp)); }
+
+int qfprintf(FILE *fp, const char *format, ...)
+{
+	va_list va;
+	va_start(va, format);
+	int result = vfprintf(fp, format, va);
+	va_end(va);
+	return(result);
+}
+
+bool qgetenv(const char *varname, qstring *buf)
+{
+	const char *value = getenv(varname);
+	if (!value)
+		return(false);
+	if (buf)
+		*buf = value;
+	return(true);
+}
+
+char *qstrncpy(char *dst, const char *src, size_t dstsize)
+{
+	if (dstsize)
+	{
+		strncpy(dst, src, (dstsize - 1));
+		dst[dstsize - 1] = 0;
+	}
+	return(dst);
+}
+
+// ---- kernwin.hpp ----
+int msg(const char *format, ...)
+{
+	va_list va;
+	va_start(va, format);
+	int result = vprintf(format, va);
+	va_end(va);
+	return(result);
+}
+
+// The run's options as the plugin pre-fills them
+int ask_form(const char *form, ...) { return(1); }
+char *ask_file(bool for_saving, const char *defval, const char *format, ...) { return(NULL); }
+bool open_url(const char *url) { return(false); }
+void refresh_idaview_anyway() {}
+void set_user_defined_prefix(size_t width, void (idaapi *get_user_defined_prefix)(qstring *buf, ea_t ea, int lnnum, int indent, const char *line)) {}
+
+// No event loop, timers never fire; the IDB events come from the stand-in, see StandIn.cpp
+qtimer_t register_timer(int interval, int (idaapi *callback)(void *ud), void *ud) { return((qtimer_t) callback); }
+bool unregister_timer(qtimer_t t) { return(true); }
+
+ssize_t chooser_t::choose(ssize_t deflt) const { return(deflt); }
+bool close_chooser(const char *title) { return(true); }
+bool refresh_chooser(const char *title) { return(true); }
+
+// ---- IDA_Util ----
+TIMESTAMP getTimeStamp()
+{
+	return(std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+const char *timeString(TIMESTAMP seconds)
+{
+	static char buffer[64];
+	if (seconds < 60.0)
+		snprintf(buffer, sizeof(buffer), "%.2f seconds", seconds);
+	else
+	if (seconds < (60.0 * 60.0))
+		snprintf(buffer, sizeof(buffer), "%.2f minutes", (seconds / 60.0));
+	else
+		snprintf(buffer, sizeof(buffer), "%.2f hours", (seconds / (60.0 * 60.0)));
+	return(buffer);
+}
+
+// With thousands separators
+const char *prettyNumberString(UINT64 n, char *buffer)
+{
+	char digits[32];
+	int length = snprintf(digits, sizeof(digits), "%llu", (unsigned long long) n);
+	char *out = buffer;
+	for (int i = 0; i < length; i++)
+	{
+		if (i && (((length - i) % 3) == 0))
+			*out++ = ',';
+		*out++ = digits[i];
+	}
+	*out = 0;
+	return(buffer);
+}
+
+void refreshUI() {}
+
+namespace WaitBox
+{
+	static TIMESTAMP s_lastUpdate = 0;
+
+	void show(const char *titleText, const char *labelText, const char *styleSheet, const char *icon) {}
+	void hide() {}
+	void processIdaEvents() {}
+
+	// Same once a second pace as the real one
+	BOOL isUpdateTime()
+	{
+		TIMESTAMP now = getTimeStamp();
+		if ((now - s_lastUpdate) < 1.0)
+			return(FALSE);
+		s_lastUpdate = now;
+		return(TRUE);
+	}
+
+	BOOL updateAndCancelCheck(int progress) { return(FALSE); }
+};
+
+namespace SegSelect
+{
+	segments *select(UINT flags, const char *title, const char *styleSheet, const char *icon) { return(NULL); }
+	void free(segments *&list)
+	{
+		delete list;
+		list = NULL;
+	}
+};
+
+namespace OggPlay
+{
+	void playFromMemory(const void *source, int length, BOOL async) {}
+	void endPlay() {}
+};
@@ -0,0 +1,1205 @@
+// Stand-in IDB for trace replay, the SDK shim's database side.
+// The database starts as the trace prologue's copy of the IDB. Flags and item walks, functions,
+// segments, names, fixups and the netnodes are answered from it. The rest (instruction decodes,
+// cross references, switch tables, flow charts, mutation results, "auto_wait") are answered from
+// the recorded calls: the k-th asking of a question gets its k-th recorded answer, and the changes
+// IDA made while answering it, the call's own and the auto-analyzer's, are applied to the database.
+// A question the trace never saw means the pass code has diverged from the recorded run; it's
+// counted, and answered as IDA would for an empty address.
+// Item changes are told to the hooked IDB event callbacks from inside the changing call, as IDA does.
+#include "stdafx.h"
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include "../TraceFormat.h"
+#include "StandIn.h"
+
+// Flags database page size, in addresses
+#define PAGE_BITS 12
+#define PAGE_SIZE (1 << PAGE_BITS)
+
+idainfo inf;
+processor_t ph = { PLFM_386 };
+
+namespace StandIn
+{
+	// ---- Flags database ----
+	class FlagsDb
+	{
+	public:
+		BOOL known(ea_t ea) const
+		{
+			const PAGE *page = find(ea);
+			return(page && page->known[ea & (PAGE_SIZE - 1)]);
+		}
+
+		flags_t flags(ea_t ea) const
+		{
+			const PAGE *page = find(ea);
+			return(page ? page->flags[ea & (PAGE_SIZE - 1)] : 0);
+		}
+
+		void setFlags(ea_t ea, flags_t flags)
+		{
+			PAGE &page = m_pages[ea >> PAGE_BITS];
+			if (page.flags.empty())
+			{
+				page.flags.resize(PAGE_SIZE);
+				page.known.resize(PAGE_SIZE);
+			}
+			page.flags[ea & (PAGE_SIZE - 1)] = flags;
+			page.known[ea & (PAGE_SIZE - 1)] = true;
+		}
+
+		// Make an item, keeping the byte values; "head" is the head's class and type
+		void setItem(ea_t ea, asize_t size, flags_t head)
+		{
+			for (asize_t i = 0; i < size; i++)
+				setFlags((ea + i), ((flags(ea + i) & (MS_VAL | FF_IVL)) | (i ? FF_TAIL : head)));
+		}
+
+		void setUnknown(ea_t ea, asize_t size)
+		{
+			for (asize_t i = 0; i < size; i++)
+				setFlags((ea + i), (flags(ea + i) & (MS_VAL | FF_IVL)));
+		}
+
+		ea_t nextHead(ea_t ea, ea_t maxea) const
+		{
+			for (ea++; ea < maxea; ea++)
+			{
+				if (is_head(flags(ea)))
+					return(ea);
+			}
+			return(BADADDR);
+		}
+
+		ea_t prevHead(ea_t ea, ea_t minea) const
+		{
+			while (ea-- > minea)
+			{
+				if (is_head(flags(ea)))
+					return(ea);
+			}
+			return(BADADDR);
+		}
+
+		ea_t nextUnknown(ea_t ea, ea_t maxea) const
+		{
+			for (ea++; ea < maxea; ea++)
+			{
+				if (known(ea) && is_unknown(flags(ea)))
+					return(ea);
+			}
+			return(BADADDR);
+		}
+
+		ea_t itemEnd(ea_t ea) const
+		{
+			for (ea++; is_tail(flags(ea)); ea++);
+			return(ea);
+		}
+
+	private:
+		struct PAGE
+		{
+			std::vector<flags_t> flags;
+			std::vector<bool> known;
+		};
+
+		const PAGE *find(ea_t ea) const
+		{
+			std::unordered_map<ea_t, PAGE>::const_iterator it = m_pages.find(ea >> PAGE_BITS);
+			return((it != m_pages.end()) ? &it->second : NULL);
+		}
+
+		std::unordered_map<ea_t, PAGE> m_pages;
+	};
+
+	struct SEGMENT
+	{
+		segment_t seg;
+		TRACESEGNAMES names;
+	};
+
+	struct NODE
+	{
+		std::string name;
+		std::map<std::pair<uchar, nodeidx_t>, nodeidx_t> alts;
+		std::map<std::pair<uchar, nodeidx_t>, std::vector<BYTE> > sups;
+		std::vector<BYTE> value;
+	};
+
+	static FlagsDb s_db;
+	static std::vector<SEGMENT> s_segments;
+	static std::map<ea_t, func_t> s_chunks;
+	static std::vector<func_t *> s_funcs;	// Function entry chunks in order, rebuilt on demand
+	static BOOL s_funcsDirty = TRUE;
+	static std::vector< std::pair<ea_t, std::string> > s_names;
+	static std::unordered_map<std::string, ea_t> s_nameEas;
+	static std::map<ea_t, fixup_type_t> s_fixups;
+	static std::vector<NODE> s_nodes;
+	static ea_t s_imageBase = 0;
+	static std::string s_path;
+
+	// ---- Recorded calls ----
+	struct CALL
+	{
+		const TRACEREC *rec;
+		const BYTE *payload;
+		UINT32 firstEvent, endEvent;	// The IDB changes IDA made answering it
+		BOOL applied;
+	};
+
+	struct KEY
+	{
+		UINT64 arg0, arg1;
+		UINT32 call;
+
+		bool operator==(const KEY &other) const { return((arg0 == other.arg0) && (arg1 == other.arg1) && (call == other.call)); }
+	};
+
+	struct KEYHASH
+	{
+		size_t operator()(const KEY &key) const
+		{
+			UINT64 hash = ((key.arg0 * 0x9E3779B97F4A7C15ULL) ^ (key.arg1 + (key.arg1 << 17)) ^ ((UINT64) key.call << 56));
+			return((size_t) (hash ^ (hash >> 29)));
+		}
+	};
+
+	struct ANSWERS
+	{
+		std::vector<UINT32> calls;
+		size_t next;
+	};
+
+	struct CALLSTATS
+	{
+		UINT64 recorded, recordedTicks;
+		UINT64 asked, missing, ticks;
+	};
+
+	static std::vector<BYTE> s_trace;
+	static std::vector<CALL> s_calls;
+	static std::vector<const TRACEREC *> s_events;
+	static std::unordered_map<KEY, ANSWERS, KEYHASH> s_answers;
+	static CALLSTATS s_stats[TC_COUNT];
+	static UINT64 s_recordedTicks = 0;
+	static double s_recordedSeconds = 0;
+
+	static inline ea_t toEa(UINT64 addr) { return((addr == TRACE_BADADDR) ? BADADDR : (ea_t) addr); }
+	static inline UINT64 toAddr(ea_t ea) { return((ea == BADADDR) ? TRACE_BADADDR : (UINT64) ea); }
+
+	// Calls answered from the recording; the others come from the database
+	static BOOL isRecordedAnswer(UINT32 call)
+	{
+		switch (call)
+		{
+			case TC_DECODE_INSN:
+			case TC_CREATE_INSN:
+			case TC_DECODE_PREV_INSN:
+			case TC_ADD_FUNC:
+			case TC_DEL_ITEMS:
+			case TC_CREATE_BYTE:
+			case TC_CREATE_ALIGN:
+			case TC_AUTO_WAIT:
+			case TC_AUTO_MARK_RANGE:
+			case TC_GET_FIRST_CREF_FROM:
+			case TC_GET_FIRST_CREF_TO:
+			case TC_GET_FIRST_DREF_FROM:
+			case TC_GET_FIRST_DREF_TO:
+			case TC_XREF_FIRST_FROM:
+			case TC_XREF_NEXT_FROM:
+			case TC_XREF_FIRST_TO:
+			case TC_XREF_NEXT_TO:
+			case TC_GET_SWITCH_INFO:
+			case TC_FLOW_CHART:
+			return(TRUE);
+		};
+		return(FALSE);
+	}
+
+	// The question's key; "arg1" is part of it where it's an input
+	static KEY makeKey(UINT32 call, UINT64 arg0, UINT64 arg1, UINT32 flags)
+	{
+		KEY key = { arg0, 0, call };
+		switch (call)
+		{
+			case TC_ADD_FUNC:
+			case TC_DEL_ITEMS:
+			case TC_CREATE_BYTE:
+			case TC_CREATE_ALIGN:
+			case TC_AUTO_MARK_RANGE:
+			case TC_XREF_FIRST_FROM:
+			case TC_XREF_FIRST_TO:
+			key.arg1 = arg1;
+			break;
+
+			// The iteration's flags too
+			case TC_XREF_NEXT_FROM:
+			case TC_XREF_NEXT_TO:
+			key.arg1 = (arg1 ^ ((UINT64) flags << 56));
+			break;
+		};
+		return(key);
+	}
+
+	static size_t payloadSize(const TRACEREC &rec)
+	{
+		switch (rec.call)
+		{
+			case TC_FLAGS_RUN: return((size_t) (rec.arg1 * sizeof(UINT32)));
+			case TC_DECODE_INSN:
+			case TC_CREATE_INSN:
+			case TC_DECODE_PREV_INSN: return(rec.extra[0] * sizeof(TRACEOP));
+			case TC_GET_SWITCH_INFO: return(((INT64) rec.result > 0) ? sizeof(TRACESWITCH) : 0);
+			case TC_FLOW_CHART: return((size_t) TRACE_PAYLOAD_SIZE((rec.arg1 * sizeof(TRACEBLOCK)) + (rec.result * sizeof(UINT32))));
+			case TC_SEGMENT: return(sizeof(TRACESEGNAMES));
+			case TC_NAME:
+			case TC_BLOB: return((size_t) TRACE_PAYLOAD_SIZE(rec.arg1));
+		};
+		return(0);
+	}
+
+	// ---- IDB events ----
+	struct HOOK
+	{
+		hook_cb_t *cb;
+		void *ud;
+	};
+	static std::vector<HOOK> s_idbHooks;
+
+	static void notify(int code, ...)
+	{
+		// A callback can unhook
+		std::vector<HOOK> hooks = s_idbHooks;
+		for (std::vector<HOOK>::iterator it = hooks.begin(); it != hooks.end(); ++it)
+		{
+			va_list va;
+			va_start(va, code);
+			it->cb(it->ud, code, va);
+			va_end(va);
+		}
+	}
+
+	static void madeCode(ea_t ea, asize_t size)
+	{
+		s_db.setItem(ea, size, FF_CODE);
+		insn_t insn;
+		memset(&insn, 0, sizeof(insn));
+		insn.ea = ea;
+		insn.size = (uint16) size;
+		notify(idb_event::make_code, (const insn_t *) &insn);
+	}
+
+	static void madeData(ea_t ea, asize_t size, flags_t head)
+	{
+		s_db.setItem(ea, size, head);
+		notify(idb_event::make_data, ea, head, (tid_t) BADADDR, size);
+	}
+
+	static void destroyed(ea_t start, ea_t end)
+	{
+		s_db.setUnknown(start, (asize_t) (end - start));
+		notify(idb_event::destroyed_items, start, end, false);
+	}
+
+	// ---- Database changes ----
+	static NODE &node(const char *name)
+	{
+		for (std::vector<NODE>::iterator it = s_nodes.begin(); it != s_nodes.end(); ++it)
+		{
+			if (it->name == name)
+				return(*it);
+		}
+		s_nodes.push_back(NODE());
+		s_nodes.back().name = name;
+		return(s_nodes.back());
+	}
+
+	static void setChunk(const TRACEREC &rec)
+	{
+		func_t &chunk = s_chunks[toEa(rec.arg0)];
+		chunk.start_ea = toEa(rec.arg0);
+		chunk.end_ea   = toEa(rec.arg1);
+		chunk.owner    = toEa(rec.result);
+		chunk.flags    = (rec.extra[0] | (rec.extra[1] << 8) | (rec.extra[2] << 16));
+		s_funcsDirty = TRUE;
+	}
+
+	// A function's tails go with it
+	static void deleteChunk(ea_t start)
+	{
+		std::map<ea_t, func_t>::iterator it = s_chunks.find(start);
+		if (it == s_chunks.end())
+			return;
+		if (!(it->second.flags & FUNC_TAIL))
+		{
+			for (std::map<ea_t, func_t>::iterator tail = s_chunks.begin(); tail != s_chunks.end();)
+			{
+				if ((tail->second.flags & FUNC_TAIL) && (tail->second.owner == start))
+					tail = s_chunks.erase(tail);
+				else
+					++tail;
+			}
+		}
+		s_chunks.erase(start);
+		s_funcsDirty = TRUE;
+	}
+
+	static void applyEvent(const TRACEREC &rec)
+	{
+		switch (rec.call)
+		{
+			case TC_EV_CODE:
+			madeCode(toEa(rec.arg0), (asize_t) rec.arg1);
+			break;
+
+			case TC_EV_DATA:
+			madeData(toEa(rec.arg0), (asize_t) rec.arg1, (FF_DATA | ((flags_t) rec.result & DT_TYPE)));
+			break;
+
+			case TC_EV_DESTROYED:
+			destroyed(toEa(rec.arg0), toEa(rec.arg1));
+			break;
+
+			case TC_CHUNK:
+			setChunk(rec);
+			break;
+
+			case TC_EV_CHUNK_DEL:
+			deleteChunk(toEa(rec.arg0));
+			break;
+		};
+	}
+
+	// The next recorded answer to the question, see the top
+	static const CALL *answer(TRACECALL call, UINT64 arg0, UINT64 arg1 = 0, UINT32 flags = 0)
+	{
+		std::unordered_map<KEY, ANSWERS, KEYHASH>::iterator it = s_answers.find(makeKey(call, arg0, arg1, flags));
+		if (it == s_answers.end())
+		{
+			s_stats[call].missing++;
+			return(NULL);
+		}
+
+		ANSWERS &answers = it->second;
+		CALL &recorded = s_calls[answers.calls[std::min(answers.next, (answers.calls.size() - 1))]];
+		if (answers.next < answers.calls.size())
+			answers.next++;
+		if (!recorded.applied)
+		{
+			for (UINT32 i = recorded.firstEvent; i < recorded.endEvent; i++)
+				applyEvent(*s_events[i]);
+			recorded.applied = TRUE;
+		}
+		return(&recorded);
+	}
+
+	// A recorded answer without taking it
+	static const CALL *peek(TRACECALL call, UINT64 arg0)
+	{
+		std::unordered_map<KEY, ANSWERS, KEYHASH>::const_iterator it = s_answers.find(makeKey(call, arg0, 0, 0));
+		return((it != s_answers.end()) ? &s_calls[it->second.calls.back()] : NULL);
+	}
+
+	// Counts and times a shim call
+	class CallTimer
+	{
+	public:
+		CallTimer(TRACECALL call) : m_call(call), m_start(__rdtsc()) {}
+		~CallTimer()
+		{
+			s_stats[m_call].asked++;
+			s_stats[m_call].ticks += (__rdtsc() - m_start);
+		}
+
+	private:
+		TRACECALL m_call;
+		UINT64 m_start;
+	};
+
+	static int fillInsn(insn_t *out, ea_t ea, const CALL *call)
+	{
+		memset(out, 0, sizeof(*out));
+		out->ea = ea;
+		if (!call)
+			return(0);
+
+		int size = (int) (INT64) call->rec->result;
+		out->itype = (uint16) call->rec->arg1;
+		out->size  = (uint16) std::max(size, 0);
+		const TRACEOP *ops = (const TRACEOP *) call->payload;
+		for (int i = 0; (i < call->rec->extra[0]) && (i < UA_MAXOP); i++)
+		{
+			op_t &op = out->ops[i];
+			op.n     = (uchar) i;
+			op.type  = ops[i].type;
+			op.dtype = (char) ops[i].dtype;
+			op.offb  = (char) ops[i].offb;
+			op.flags = ops[i].flags;
+			op.reg   = ops[i].reg;
+			op.value = (uval_t) ops[i].value;
+			op.addr  = toEa(ops[i].addr);
+		}
+		return(size);
+	}
+
+	static bool fillXref(xrefblk_t *xb, const CALL *call, BOOL to)
+	{
+		if (!call || (call->rec->result == TRACE_BADADDR))
+			return(false);
+		if (to)
+		{
+			xb->to   = toEa(call->rec->arg0);
+			xb->from = toEa(call->rec->result);
+		}
+		else
+		{
+			xb->from = toEa(call->rec->arg0);
+			xb->to   = toEa(call->rec->result);
+		}
+		xb->type   = call->rec->extra[0];
+		xb->iscode = call->rec->extra[1];
+		xb->user   = 0;
+		return(true);
+	}
+
+	static void buildFuncs()
+	{
+		if (!s_funcsDirty)
+			return;
+		s_funcs.clear();
+		for (std::map<ea_t, func_t>::iterator it = s_chunks.begin(); it != s_chunks.end(); ++it)
+		{
+			if (!(it->second.flags & FUNC_TAIL))
+				s_funcs.push_back(&it->second);
+		}
+		s_funcsDirty = FALSE;
+	}
+
+	// ---- Loading ----
+	BOOL load(const char *path)
+	{
+		FILE *file = fopen(path, "rb");
+		if (!file)
+		{
+			fprintf(stderr, "Can't open \"%s\"\n", path);
+			return(FALSE);
+		}
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		s_trace.resize((size > 0) ? (size_t) size : 0);
+		BOOL read = (!s_trace.empty() && (fread(s_trace.data(), 1, s_trace.size(), file) == s_trace.size()));
+		fclose(file);
+		s_path = path;
+
+		const TRACEHEADER *header = (const TRACEHEADER *) s_trace.data();
+		if (!read || (s_trace.size() < sizeof(TRACEHEADER)) || (header->magic != TRACE_MAGIC) || (header->version != TRACE_VERSION))
+		{
+			fprintf(stderr, "Not a version %d trace file\n", TRACE_VERSION);
+			return(FALSE);
+		}
+		if (header->eaSize != sizeof(ea_t))
+		{
+			fprintf(stderr, "Recorded with %u bit addresses, this replay is built for %u; rebuild %s -D__EA64__\n", (header->eaSize * 8), (UINT) (sizeof(ea_t) * 8), ((header->eaSize == 8) ? "with" : "without"));
+			return(FALSE);
+		}
+
+		BOOL prologue = TRUE;
+		UINT32 firstEvent = 0;
+		const BYTE *end = (s_trace.data() + s_trace.size());
+		for (const BYTE *p = (s_trace.data() + sizeof(TRACEHEADER)); (p + sizeof(TRACEREC)) <= end;)
+		{
+			const TRACEREC &rec = *((const TRACEREC *) p);
+			const BYTE *payload = (p + sizeof(TRACEREC));
+			if (rec.call >= TC_COUNT)
+			{
+				fprintf(stderr, "Bad record, call %u\n", rec.call);
+				return(FALSE);
+			}
+			if ((payload + payloadSize(rec)) > end)
+			{
+				fprintf(stderr, "Trace truncated\n");
+				break;
+			}
+			p = (payload + payloadSize(rec));
+
+			if (rec.call == TC_END)
+			{
+				s_recordedTicks = rec.arg0;
+				memcpy(&s_recordedSeconds, &rec.result, sizeof(s_recordedSeconds));
+				break;
+			}
+
+			if (prologue)
+			{
+				switch (rec.call)
+				{
+					case TC_INFO:
+					s_imageBase = toEa(rec.arg0);
+					inf.min_ea = toEa(rec.arg1);
+					inf.max_ea = toEa(rec.result);
+					inf.is64   = (rec.extra[0] != 0);
+					break;
+
+					case TC_SEGMENT:
+					{
+						SEGMENT segment = SEGMENT();
+						segment.seg.start_ea = toEa(rec.arg0);
+						segment.seg.end_ea   = toEa(rec.arg1);
+						segment.seg.type     = (uchar) rec.result;
+						segment.seg.bitness  = rec.extra[0];
+						segment.seg.perm     = rec.extra[1];
+						memcpy(&segment.names, payload, sizeof(segment.names));
+						segment.names.name[sizeof(segment.names.name) - 1] = segment.names.sclass[sizeof(segment.names.sclass) - 1] = 0;
+						s_segments.push_back(segment);
+					}
+					break;
+
+					case TC_CHUNK:
+					setChunk(rec);
+					break;
+
+					case TC_NAME:
+					{
+						std::string name((const char *) payload, (size_t) rec.arg1);
+						s_names.push_back(std::make_pair(toEa(rec.arg0), name));
+						s_nameEas[name] = toEa(rec.arg0);
+					}
+					break;
+
+					case TC_FIXUP:
+					s_fixups[toEa(rec.arg0)] = (fixup_type_t) rec.arg1;
+					break;
+
+					case TC_ALTVAL:
+					node(NETNODE_NAME).alts[std::make_pair(rec.extra[0], (nodeidx_t) rec.arg0)] = (nodeidx_t) rec.arg1;
+					break;
+
+					case TC_BLOB:
+					if (rec.arg0 == TB_PE_HEADER)
+						node("$ PE header").value.assign(payload, (payload + rec.arg1));
+					else
+					if (rec.arg0 == TB_PASS_RATES)
+						node(NETNODE_NAME).sups[std::make_pair((uchar) 'R', (nodeidx_t) 0)].assign(payload, (payload + rec.arg1));
+					break;
+
+					case TC_FLAGS_RUN:
+					{
+						const UINT32 *flags = (const UINT32 *) payload;
+						for (UINT64 i = 0; i < rec.arg1; i++)
+							s_db.setFlags(toEa(rec.arg0 + i), flags[i]);
+					}
+					break;
+
+					case TC_PROLOGUE_END:
+					prologue = FALSE;
+					break;
+				};
+				continue;
+			}
+
+			// The run
+			CALLSTATS &stat = s_stats[(rec.call == TC_FLAGS_RUN) ? TC_GET_FULL_FLAGS : rec.call];
+			stat.recorded += ((rec.call == TC_FLAGS_RUN) ? rec.arg1 : 1);
+			stat.recordedTicks += rec.ticks;
+
+			if ((rec.call == TC_CHUNK) || (rec.call >= TC_EV_CODE))
+				s_events.push_back(&rec);
+			else
+			if (isRecordedAnswer(rec.call))
+			{
+				CALL call = { &rec, payload, firstEvent, (UINT32) s_events.size(), FALSE };
+				firstEvent = call.endEvent;
+				UINT32 flags = (((rec.call == TC_XREF_NEXT_FROM) || (rec.call == TC_XREF_NEXT_TO)) ? rec.extra[2] : 0);
+				ANSWERS &answers = s_answers[makeKey(rec.call, rec.arg0, rec.arg1, flags)];
+				answers.calls.push_back((UINT32) s_calls.size());
+				answers.next = 0;
+				s_calls.push_back(call);
+			}
+		}
+
+		if (prologue)
+		{
+			fprintf(stderr, "No database prologue in the trace\n");
+			return(FALSE);
+		}
+		if (!s_recordedTicks)
+			printf("No end record, trace incomplete.\n");
+
+		UINT64 recorded = 0;
+		for (int i = 0; i < TC_COUNT; i++)
+			recorded += s_stats[i].recorded;
+		char buffer[32], buffer2[32], buffer3[32];
+		printf("Trace: %u bit ea, %.2f seconds recorded, %s calls, %s segments, %s function chunks.\n", (header->eaSize * 8), s_recordedSeconds,
+			   prettyNumberString(recorded, buffer), prettyNumberString(s_segments.size(), buffer2), prettyNumberString(s_chunks.size(), buffer3));
+		return(TRUE);
+	}
+
+	void report(double seconds)
+	{
+		UINT64 standInTicks = 0, missing = 0;
+		for (int i = 0; i < TC_COUNT; i++)
+		{
+			standInTicks += s_stats[i].ticks;
+			missing += s_stats[i].missing;
+		}
+		double recordedTicksPerSecond = ((s_recordedTicks && (s_recordedSeconds > 0)) ? ((double) s_recordedTicks / s_recordedSeconds) : 0.0);
+
+		// This machine's TSC rate, over a short wait
+		TIMESTAMP startTime = getTimeStamp();
+		UINT64 startTicks = __rdtsc();
+		while ((getTimeStamp() - startTime) < 0.05);
+		double ticksPerSecond = ((double) (__rdtsc() - startTicks) / (getTimeStamp() - startTime));
+		double standInSeconds = (standInTicks / ticksPerSecond);
+
+		printf("\nReplay: %.3f seconds, pass code %.3f, stand-in %.3f.\n", seconds, std::max((seconds - standInSeconds), 0.0), standInSeconds);
+		if (missing)
+			printf("%llu questions had no recorded answer, the pass code diverged from the recorded run.\n", (unsigned long long) missing);
+
+		printf("\n%-22s %12s %12s %12s %12s %10s\n", "Call", "Recorded", "IDA s", "Replayed", "Stand-in s", "No answer");
+		for (int i = 1; i < TC_INFO; i++)
+		{
+			const CALLSTATS &stat = s_stats[i];
+			if (!stat.recorded && !stat.asked)
+				continue;
+
+			char ida[16] = "-";
+			if (recordedTicksPerSecond > 0)
+				snprintf(ida, sizeof(ida), "%.3f", (stat.recordedTicks / recordedTicksPerSecond));
+			printf("%-22s %12llu %12s %12llu %12.3f %10llu\n", TRACE_CALL_NAMES[i], (unsigned long long) stat.recorded, ida, (unsigned long long) stat.asked,
+				   (stat.ticks / ticksPerSecond), (unsigned long long) stat.missing);
+		}
+	}
+};
+using namespace StandIn;
+
+// ---- bytes.hpp ----
+flags_t get_flags(ea_t ea)
+{
+	CallTimer timer(TC_GET_FLAGS);
+	return(s_db.flags(ea) & ~MS_VAL);
+}
+
+flags_t get_full_flags(ea_t ea)
+{
+	CallTimer timer(TC_GET_FULL_FLAGS);
+	return(s_db.flags(ea));
+}
+
+// Stops at the first byte without a value
+ssize_t get_bytes(void *buf, ssize_t size, ea_t ea, int gmb_flags, void *mask)
+{
+	BYTE *bytes = (BYTE *) buf;
+	for (ssize_t i = 0; i < size; i++)
+	{
+		flags_t flags = s_db.flags(ea + i);
+		if (!has_value(flags))
+			return(i);
+		bytes[i] = (BYTE) (flags & MS_VAL);
+	}
+	return(size);
+}
+
+uint32 get_dword(ea_t ea)
+{
+	uint32 value = 0;
+	for (int i = 3; i >= 0; i--)
+		value = ((value << 8) | (s_db.flags(ea + i) & MS_VAL));
+	return(value);
+}
+
+uint64 get_qword(ea_t ea)
+{
+	return(((uint64) get_dword(ea + 4) << 32) | get_dword(ea));
+}
+
+bool is_mapped(ea_t ea) { return(getseg(ea) != NULL); }
+
+ea_t next_head(ea_t ea, ea_t maxea)
+{
+	CallTimer timer(TC_NEXT_HEAD);
+	return(s_db.nextHead(ea, maxea));
+}
+
+ea_t prev_head(ea_t ea, ea_t minea)
+{
+	CallTimer timer(TC_PREV_HEAD);
+	return(s_db.prevHead(ea, minea));
+}
+
+ea_t next_unknown(ea_t ea, ea_t maxea)
+{
+	CallTimer timer(TC_NEXT_UNKNOWN);
+	return(s_db.nextUnknown(ea, maxea));
+}
+
+ea_t next_that(ea_t ea, ea_t maxea, testf_t *testf, void *ud)
+{
+	CallTimer timer(TC_NEXT_THAT);
+	for (ea++; ea < maxea; ea++)
+	{
+		if (testf(s_db.flags(ea), ud))
+			return(ea);
+	}
+	return(BADADDR);
+}
+
+ea_t get_item_end(ea_t ea)
+{
+	CallTimer timer(TC_GET_ITEM_END);
+	return(s_db.itemEnd(ea));
+}
+
+asize_t get_item_size(ea_t ea) { return(s_db.itemEnd(ea) - ea); }
+
+bool del_items(ea_t ea, int flags, asize_t nbytes, bool (idaapi *may_destroy)(ea_t ea))
+{
+	CallTimer timer(TC_DEL_ITEMS);
+	if (const CALL *call = answer(TC_DEL_ITEMS, toAddr(ea), nbytes))
+		return(call->rec->result != 0);
+	destroyed(ea, (ea + nbytes));
+	return(true);
+}
+
+bool create_byte(ea_t ea, asize_t length)
+{
+	CallTimer timer(TC_CREATE_BYTE);
+	if (const CALL *call = answer(TC_CREATE_BYTE, toAddr(ea), length))
+		return(call->rec->result != 0);
+	madeData(ea, length, (FF_DATA | FF_BYTE));
+	return(true);
+}
+
+bool create_align(ea_t ea, asize_t length, int alignment)
+{
+	CallTimer timer(TC_CREATE_ALIGN);
+	if (const CALL *call = answer(TC_CREATE_ALIGN, toAddr(ea), length))
+		return(call->rec->result != 0);
+	madeData(ea, length, (FF_DATA | FF_ALIGN));
+	return(true);
+}
+
+// ---- ua.hpp ----
+int decode_insn(insn_t *out, ea_t ea)
+{
+	CallTimer timer(TC_DECODE_INSN);
+	return(fillInsn(out, ea, answer(TC_DECODE_INSN, toAddr(ea))));
+}
+
+ea_t decode_prev_insn(insn_t *out, ea_t ea)
+{
+	CallTimer timer(TC_DECODE_PREV_INSN);
+	const CALL *call = answer(TC_DECODE_PREV_INSN, toAddr(ea));
+	fillInsn(out, ea, call);
+	if (!call || (call->rec->result == TRACE_BADADDR))
+		return(BADADDR);
+	out->ea = toEa(call->rec->result);
+	out->size = (uint16) (ea - out->ea);
+	return(out->ea);
+}
+
+// Not recorded here, made from a recorded decode of the same address
+int create_insn(ea_t ea, insn_t *out)
+{
+	CallTimer timer(TC_CREATE_INSN);
+	insn_t insn;
+	if (!out)
+		out = &insn;
+	if (const CALL *call = answer(TC_CREATE_INSN, toAddr(ea)))
+		return(fillInsn(out, ea, call));
+
+	int size = fillInsn(out, ea, peek(TC_DECODE_INSN, toAddr(ea)));
+	if (size > 0)
+		madeCode(ea, size);
+	return(size);
+}
+
+bool print_insn_mnem(qstring *out, ea_t ea)
+{
+	insn_t insn;
+	if (fillInsn(&insn, ea, peek(TC_DECODE_INSN, toAddr(ea))) <= 0)
+		return(false);
+	out->sprnt("itype %u", insn.itype);
+	return(true);
+}
+
+// ---- xref.hpp ----
+bool xrefblk_t::first_from(ea_t from, int flags)
+{
+	CallTimer timer(TC_XREF_FIRST_FROM);
+	this->flags = flags;
+	return(fillXref(this, answer(TC_XREF_FIRST_FROM, toAddr(from), flags), FALSE));
+}
+
+bool xrefblk_t::next_from()
+{
+	CallTimer timer(TC_XREF_NEXT_FROM);
+	return(fillXref(this, answer(TC_XREF_NEXT_FROM, toAddr(from), toAddr(to), flags), FALSE));
+}
+
+bool xrefblk_t::first_to(ea_t to, int flags)
+{
+	CallTimer timer(TC_XREF_FIRST_TO);
+	this->flags = flags;
+	return(fillXref(this, answer(TC_XREF_FIRST_TO, toAddr(to), flags), TRUE));
+}
+
+bool xrefblk_t::next_to()
+{
+	CallTimer timer(TC_XREF_NEXT_TO);
+	return(fillXref(this, answer(TC_XREF_NEXT_TO, toAddr(to), toAddr(from), flags), TRUE));
+}
+
+static ea_t firstRef(TRACECALL call, ea_t ea)
+{
+	CallTimer timer(call);
+	const CALL *recorded = answer(call, toAddr(ea));
+	return(recorded ? toEa(recorded->rec->result) : BADADDR);
+}
+
+ea_t get_first_cref_from(ea_t from) { return(firstRef(TC_GET_FIRST_CREF_FROM, from)); }
+ea_t get_first_cref_to(ea_t to) { return(firstRef(TC_GET_FIRST_CREF_TO, to)); }
+ea_t get_first_dref_from(ea_t from) { return(firstRef(TC_GET_FIRST_DREF_FROM, from)); }
+ea_t get_first_dref_to(ea_t to) { return(firstRef(TC_GET_FIRST_DREF_TO, to)); }
+
+// ---- funcs.hpp ----
+func_t *get_fchunk(ea_t ea)
+{
+	CallTimer timer(TC_GET_FCHUNK);
+	std::map<ea_t, func_t>::iterator it = s_chunks.upper_bound(ea);
+	if (it == s_chunks.begin())
+		return(NULL);
+	--it;
+	return(it->second.contains(ea) ? &it->second : NULL);
+}
+
+func_t *get_func(ea_t ea)
+{
+	CallTimer timer(TC_GET_FUNC);
+	func_t *chunk = get_fchunk(ea);
+	if (chunk && (chunk->flags & FUNC_TAIL))
+	{
+		std::map<ea_t, func_t>::iterator it = s_chunks.find(chunk->owner);
+		return((it != s_chunks.end()) ? &it->second : NULL);
+	}
+	return(chunk);
+}
+
+// The chunk before the one at "ea", or before "ea" if it's in none
+func_t *get_prev_fchunk(ea_t ea)
+{
+	std::map<ea_t, func_t>::iterator it = s_chunks.upper_bound(ea);
+	if (it == s_chunks.begin())
+		return(NULL);
+	--it;
+	if (it->second.contains(ea))
+	{
+		if (it == s_chunks.begin())
+			return(NULL);
+		--it;
+	}
+	return(&it->second);
+}
+
+func_t *get_next_fchunk(ea_t ea)
+{
+	std::map<ea_t, func_t>::iterator it = s_chunks.upper_bound(ea);
+	return((it != s_chunks.end()) ? &it->second : NULL);
+}
+
+func_t *get_next_func(ea_t ea)
+{
+	buildFuncs();
+	for (std::map<ea_t, func_t>::iterator it = s_chunks.upper_bound(ea); it != s_chunks.end(); ++it)
+	{
+		if (!(it->second.flags & FUNC_TAIL))
+			return(&it->second);
+	}
+	return(NULL);
+}
+
+func_t *getn_func(size_t n)
+{
+	buildFuncs();
+	return((n < s_funcs.size()) ? s_funcs[n] : NULL);
+}
+
+size_t get_func_qty()
+{
+	buildFuncs();
+	return(s_funcs.size());
+}
+
+bool add_func(ea_t ea1, ea_t ea2)
+{
+	CallTimer timer(TC_ADD_FUNC);
+	const CALL *call = answer(TC_ADD_FUNC, toAddr(ea1), toAddr(ea2));
+	return(call && (call->rec->result != 0));
+}
+
+// The IDB side of these comes with the next recorded answer
+bool update_func(func_t *pfn) { return(true); }
+void reanalyze_callers(ea_t ea, bool noret) {}
+
+// ---- gdl.hpp ----
+qflow_chart_t::qflow_chart_t(const char *title, func_t *pfn, ea_t ea1, ea_t ea2, int flags)
+{
+	CallTimer timer(TC_FLOW_CHART);
+	const CALL *call = answer(TC_FLOW_CHART, toAddr(pfn ? pfn->start_ea : ea1));
+	if (!call)
+		return;
+
+	const TRACEBLOCK *traceBlocks = (const TRACEBLOCK *) call->payload;
+	const UINT32 *succs = (const UINT32 *) (traceBlocks + call->rec->arg1);
+	blocks.resize((size_t) call->rec->arg1);
+	m_succs.resize((size_t) call->rec->arg1);
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		blocks[i].start_ea = toEa(traceBlocks[i].start);
+		blocks[i].end_ea   = toEa(traceBlocks[i].end);
+		m_succs[i].assign((succs + traceBlocks[i].firstSucc), (succs + traceBlocks[i].firstSucc + traceBlocks[i].succCount));
+	}
+}
+
+// ---- segment.hpp ----
+segment_t *getseg(ea_t ea)
+{
+	for (std::vector<SEGMENT>::iterator it = s_segments.begin(); it != s_segments.end(); ++it)
+	{
+		if (it->seg.contains(ea))
+			return(&it->seg);
+	}
+	return(NULL);
+}
+
+segment_t *getnseg(int n) { return(((n >= 0) && (n < (int) s_segments.size())) ? &s_segments[n].seg : NULL); }
+int get_segm_qty() { return((int) s_segments.size()); }
+
+static const SEGMENT *findSegment(const segment_t *s)
+{
+	for (std::vector<SEGMENT>::iterator it = s_segments.begin(); it != s_segments.end(); ++it)
+	{
+		if (&it->seg == s)
+			return(&*it);
+	}
+	return(NULL);
+}
+
+ssize_t get_segm_name(qstring *buf, const segment_t *s, int flags)
+{
+	const SEGMENT *segment = findSegment(s);
+	if (!segment)
+		return(-1);
+	*buf = segment->names.name;
+	return(buf->length());
+}
+
+ssize_t get_segm_class(qstring *buf, const segment_t *s)
+{
+	const SEGMENT *segment = findSegment(s);
+	if (!segment)
+		return(-1);
+	*buf = segment->names.sclass;
+	return(buf->length());
+}
+
+// ---- nalt.hpp ----
+ssize_t get_switch_info(switch_info_t *out, ea_t ea)
+{
+	CallTimer timer(TC_GET_SWITCH_INFO);
+	memset(out, 0, sizeof(*out));
+	const CALL *call = answer(TC_GET_SWITCH_INFO, toAddr(ea));
+	if (!call)
+		return(-1);
+
+	ssize_t result = (ssize_t) (INT64) call->rec->result;
+	if (result > 0)
+	{
+		const TRACESWITCH *info = (const TRACESWITCH *) call->payload;
+		out->flags  = info->flags;
+		out->ncases = info->ncases;
+		out->jumps  = toEa(info->jumps);
+		out->values = toEa(info->values);
+		out->jcases = info->jcases;
+		out->jsize  = info->jsize;
+		out->vsize  = info->vsize;
+	}
+	return(result);
+}
+
+// No input file next to a replay
+ssize_t get_input_file_path(char *buf, size_t bufsize) { return(0); }
+ea_t get_imagebase() { return(s_imageBase); }
+const char *get_path(path_type_t pt) { return(s_path.c_str()); }
+
+// ---- fixup.hpp ----
+ea_t get_first_fixup_ea() { return(s_fixups.empty() ? BADADDR : s_fixups.begin()->first); }
+
+ea_t get_next_fixup_ea(ea_t ea)
+{
+	std::map<ea_t, fixup_type_t>::iterator it = s_fixups.upper_bound(ea);
+	return((it != s_fixups.end()) ? it->first : BADADDR);
+}
+
+bool get_fixup(fixup_data_t *fd, ea_t source)
+{
+	std::map<ea_t, fixup_type_t>::iterator it = s_fixups.find(source);
+	if (it == s_fixups.end())
+		return(false);
+	fd->type = it->second;
+	return(true);
+}
+
+// ---- name.hpp ----
+ssize_t get_name(qstring *out, ea_t ea, int gtn_flags)
+{
+	for (std::vector< std::pair<ea_t, std::string> >::iterator it = s_names.begin(); it != s_names.end(); ++it)
+	{
+		if (it->first == ea)
+		{
+			*out = it->second.c_str();
+			return(out->length());
+		}
+	}
+	return(-1);
+}
+
+ea_t get_name_ea(ea_t from, const char *name)
+{
+	std::unordered_map<std::string, ea_t>::iterator it = s_nameEas.find(name);
+	return((it != s_nameEas.end()) ? it->second : BADADDR);
+}
+
+size_t get_nlist_size() { return(s_names.size()); }
+ea_t get_nlist_ea(size_t idx) { return((idx < s_names.size()) ? s_names[idx].first : BADADDR); }
+const char *get_nlist_name(size_t idx) { return((idx < s_names.size()) ? s_names[idx].second.c_str() : NULL); }
+
+// ---- netnode.hpp ----
+netnode::netnode(const char *name, size_t namlen, bool do_create) : m_index(BADNODE)
+{
+	for (size_t i = 0; i < s_nodes.size(); i++)
+	{
+		if (s_nodes[i].name == name)
+		{
+			m_index = (nodeidx_t) i;
+			return;
+		}
+	}
+	if (do_create)
+	{
+		node(name);
+		m_index = (nodeidx_t) (s_nodes.size() - 1);
+	}
+}
+
+nodeidx_t netnode::altval(nodeidx_t alt, uchar tag) const
+{
+	if (m_index == BADNODE)
+		return(0);
+	const std::map<std::pair<uchar, nodeidx_t>, nodeidx_t> &alts = s_nodes[m_index].alts;
+	std::map<std::pair<uchar, nodeidx_t>, nodeidx_t>::const_iterator it = alts.find(std::make_pair(tag, alt));
+	return((it != alts.end()) ? it->second : 0);
+}
+
+bool netnode::altset(nodeidx_t alt, nodeidx_t value, uchar tag)
+{
+	if (m_index == BADNODE)
+		return(false);
+	s_nodes[m_index].alts[std::make_pair(tag, alt)] = value;
+	return(true);
+}
+
+bool netnode::altdel(nodeidx_t alt, uchar tag)
+{
+	return((m_index != BADNODE) && (s_nodes[m_index].alts.erase(std::make_pair(tag, alt)) != 0));
+}
+
+nodeidx_t netnode::altfirst(uchar tag) const { return(altnext(BADNODE, tag)); }
+
+// From the start when "cur" is BADNODE
+nodeidx_t netnode::altnext(nodeidx_t cur, uchar tag) const
+{
+	if (m_index == BADNODE)
+		return(BADNODE);
+	const std::map<std::pair<uchar, nodeidx_t>, nodeidx_t> &alts = s_nodes[m_index].alts;
+	std::map<std::pair<uchar, nodeidx_t>, nodeidx_t>::const_iterator it = ((cur == BADNODE) ? alts.lower_bound(std::make_pair(tag, (nodeidx_t) 0)) : alts.upper_bound(std::make_pair(tag, cur)));
+	return(((it != alts.end()) && (it->first.first == tag)) ? it->first.second : BADNODE);
+}
+
+ssize_t netnode::supval(nodeidx_t alt, void *buf, size_t bufsize, uchar tag) const
+{
+	if (m_index == BADNODE)
+		return(-1);
+	const std::map<std::pair<uchar, nodeidx_t>, std::vector<BYTE> > &sups = s_nodes[m_index].sups;
+	std::map<std::pair<uchar, nodeidx_t>, std::vector<BYTE> >::const_iterator it = sups.find(std::make_pair(tag, alt));
+	if (it == sups.end())
+		return(-1);
+	size_t size = std::min(bufsize, it->second.size());
+	memcpy(buf, it->second.data(), size);
+	return((ssize_t) it->second.size());
+}
+
+bool netnode::supset(nodeidx_t alt, const void *value, size_t length, uchar tag)
+{
+	if (m_index == BADNODE)
+		return(false);
+	const BYTE *bytes = (const BYTE *) value;
+	s_nodes[m_index].sups[std::make_pair(tag, alt)].assign(bytes, (bytes + length));
+	return(true);
+}
+
+ssize_t netnode::valobj(void *buf, size_t bufsize) const
+{
+	if ((m_index == BADNODE) || s_nodes[m_index].value.empty())
+		return(-1);
+	const std::vector<BYTE> &value = s_nodes[m_index].value;
+	memcpy(buf, value.data(), std::min(bufsize, value.size()));
+	return((ssize_t) value.size());
+}
+
+// ---- idp.hpp ----
+bool hook_to_notification_point(hook_type_t hook_type, hook_cb_t *cb, void *user_data)
+{
+	if (hook_type == HT_IDB)
+	{
+		HOOK hook = { cb, user_data };
+		s_idbHooks.push_back(hook);
+	}
+	return(true);
+}
+
+int unhook_from_notification_point(hook_type_t hook_type, hook_cb_t *cb, void *user_data)
+{
+	int count = 0;
+	for (std::vector<HOOK>::iterator it = s_idbHooks.begin(); it != s_idbHooks.end();)
+	{
+		if ((hook_type == HT_IDB) && (it->cb == cb) && (it->ud == user_data))
+		{
+			it = s_idbHooks.erase(it);
+			count++;
+		}
+		else
+			++it;
+	}
+	return(count);
+}
+
+// ---- auto.hpp ----
+bool auto_wait()
+{
+	CallTimer timer(TC_AUTO_WAIT);
+	const CALL *call = answer(TC_AUTO_WAIT, 0);
+	return(!call || (call->rec->result != 0));
+}
+
+bool auto_is_ok() { return(true); }
+
+void auto_mark_range(ea_t start, ea_t end, atype_t type)
+{
+	CallTimer timer(TC_AUTO_MARK_RANGE);
+	answer(TC_AUTO_MARK_RANGE, toAddr(start), toAddr(end));
+}
@@ -0,0 +1,11 @@
+// Stand-in IDB for trace replay, the SDK shim's database side
+#pragma once
+
+namespace StandIn
+{
+	// Read a trace, building the database from its prologue; FALSE with a message on error
+	BOOL load(const char *path);
+
+	// Per call counts and times, recorded in IDA vs. replayed, and the questions the trace had no answer for
+	void report(double seconds);
+};
@@ -0,0 +1,92 @@
+// Replay test: an index table pass 1 recognizes stays pinned after the pass remakes it as bytes.
+// The trace is made here: a function with a "movzx eax, byte [table]" and the referenced 16 byte table of indexes.
+// The stand-in tells the plugin's IDB hooks about the pass's "del_items()", as IDA does.
+// Built in place of "TraceReplay.cpp", from the plugin's directory:
+//   g++ -O2 -std=c++14 -Wno-unknown-pragmas -msse4.2 -IReplay/Sdk -I<IDA SDK>/include -o indextablepin Replay/Shim.cpp Replay/StandIn.cpp Replay/Tests/IndexTablePin.cpp *.cpp -lpthread
+//   indextablepin
+// Exits with zero when it passes.
+#include "stdafx.h"
+#include "../../TraceFormat.h"
+#include "../StandIn.h"
+
+extern "C" plugin_t PLUGIN;
+
+#define SEG_START	0x401000
+#define SEG_END		0x402000
+#define CODE_EA		0x401000	// movzx eax, byte [TABLE_EA]
+#define CODE_SIZE	7
+#define TABLE_EA	0x401100
+#define TABLE_SIZE	16
+
+static std::vector<BYTE> s_trace;
+
+static void record(TRACECALL call, UINT64 arg0, UINT64 arg1 = 0, UINT64 result = 0, const void *payload = NULL, size_t payloadSize = 0, BYTE extra0 = 0, BYTE extra1 = 0, BYTE extra2 = 0)
+{
+	TRACEREC rec = { (uint8_t) call, { extra0, extra1, extra2 }, 100, arg0, arg1, result };
+	const BYTE *bytes = (const BYTE *) &rec;
+	s_trace.insert(s_trace.end(), bytes, (bytes + sizeof(rec)));
+	bytes = (const BYTE *) payload;
+	if (payloadSize)
+		s_trace.insert(s_trace.end(), bytes, (bytes + payloadSize));
+}
+
+static BOOL writeTrace(const char *path)
+{
+	TRACEHEADER header = { TRACE_MAGIC, TRACE_VERSION, sizeof(ea_t), 0 };
+	s_trace.assign((const BYTE *) &header, ((const BYTE *) &header + sizeof(header)));
+
+	// Database: the code segment, the function, and the table with code after it; the rest unknown zero bytes
+	record(TC_INFO, 0x400000, SEG_START, SEG_END);
+	TRACESEGNAMES names = { ".text", "CODE" };
+	record(TC_SEGMENT, SEG_START, SEG_END, SEG_CODE, &names, sizeof(names), 1, 5);
+	record(TC_CHUNK, CODE_EA, (CODE_EA + CODE_SIZE + 1), TRACE_BADADDR);
+	std::vector<UINT32> flags((SEG_END - SEG_START), FF_IVL);
+	for (int i = 0; i < CODE_SIZE; i++)
+		flags[(CODE_EA - SEG_START) + i] |= (i ? FF_TAIL : (FF_CODE | FF_FUNC | FF_FLOW));
+	flags[(CODE_EA - SEG_START) + CODE_SIZE] |= (FF_CODE | FF_FLOW | 0xC3);
+	for (int i = 0; i < TABLE_SIZE; i++)
+		flags[(TABLE_EA - SEG_START) + i] |= ((i ? FF_TAIL : (FF_DATA | FF_BYTE | FF_REF)) | (1 + (i & 3)));
+	flags[(TABLE_EA - SEG_START) + TABLE_SIZE] |= (FF_CODE | 0xC3);
+	record(TC_FLAGS_RUN, SEG_START, flags.size(), 0, flags.data(), (flags.size() * sizeof(UINT32)));
+	record(TC_PROLOGUE_END, 0);
+
+	// The table's one reader, a data read ("dr_R")
+	record(TC_XREF_FIRST_TO, TABLE_EA, XREF_DATA, CODE_EA, NULL, 0, 3, 0, XREF_DATA);
+	record(TC_XREF_NEXT_TO, TABLE_EA, CODE_EA, TRACE_BADADDR, NULL, 0, 0, 0, XREF_DATA);
+	record(TC_GET_SWITCH_INFO, CODE_EA, 0, 0);
+	TRACEOP ops[2] = {};
+	ops[0].type = o_reg; ops[0].dtype = dt_dword;
+	ops[1].type = o_mem; ops[1].dtype = dt_byte; ops[1].addr = TABLE_EA;
+	record(TC_DECODE_INSN, CODE_EA, NN_movzx, CODE_SIZE, ops, sizeof(ops), 2);
+
+	double seconds = 1.0;
+	UINT64 bits;
+	memcpy(&bits, &seconds, sizeof(bits));
+	record(TC_END, 1, 0, bits);
+
+	FILE *file = fopen(path, "wb");
+	if (!file)
+		return(FALSE);
+	BOOL written = (fwrite(s_trace.data(), 1, s_trace.size(), file) == s_trace.size());
+	fclose(file);
+	return(written);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = "IndexTablePin.xpt";
+	if (!writeTrace(path) || !StandIn::load(path))
+		return(1);
+	remove(path);
+
+	if (PLUGIN.init() == PLUGIN_SKIP)
+		return(1);
+	PLUGIN.run(0);
+	PLUGIN.term();
+
+	// Pinned as it was recognized, start to end
+	netnode node(NETNODE_NAME);
+	BOOL pinned = ((node != BADNODE) && (node.altval(TABLE_EA, 'P') == (TABLE_EA + TABLE_SIZE)));
+	printf("\nIndex table " EAFORMAT " %s.\n", (ea_t) TABLE_EA, (pinned ? "still pinned, passed" : "not pinned, FAILED"));
+	return(pinned ? 0 : 1);
+}
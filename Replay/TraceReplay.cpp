@@ -0,0 +1,38 @@
+// Offline SDK call trace replay, for traces recorded by SDK_TRACE builds (see "../SdkTrace.h").
+// Runs the plugin itself, built against the SDK shim in "Sdk/", with the shim's database side
+// answered by a stand-in IDB rebuilt from the trace (see "StandIn.cpp"). Reports the pass code's own
+// time apart from the SDK's, and per call counts and times, recorded in IDA vs. answered by the stand-in.
+// The plugin runs with its default options, as "ask_form()" is answered OK unchanged.
+// No IDA or Windows needed, just the SDK's headers for "allins.hpp", from the plugin's directory:
+//   g++ -O2 -std=c++14 -Wno-unknown-pragmas -msse4.2 -IReplay/Sdk -I<IDA SDK>/include -o tracereplay Replay/*.cpp *.cpp -lpthread
+//   (with -D__EA64__ for traces from 64 bit IDA)
+//   tracereplay <file.xpt> [time limit]
+#include "stdafx.h"
+#include <stdlib.h>
+#include "StandIn.h"
+
+extern "C" plugin_t PLUGIN;
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: tracereplay <file.xpt> [time limit]\n");
+		return(1);
+	}
+	if (!StandIn::load(argv[1]))
+		return(1);
+
+	if (PLUGIN.init() == PLUGIN_SKIP)
+	{
+		fprintf(stderr, "Plugin skipped the database\n");
+		return(1);
+	}
+	TIMESTAMP startTime = getTimeStamp();
+	PLUGIN.run((argc > 2) ? (size_t) strtoul(argv[2], NULL, 10) : 0);
+	TIMESTAMP seconds = (getTimeStamp() - startTime);
+	PLUGIN.term();
+
+	StandIn::report(seconds);
+	return(0);
+}
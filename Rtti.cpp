@@ -0,0 +1,118 @@
+// MSVC RTTI vtable finder
+#include "stdafx.h"
+#include <algorithm>
+#include "Rtti.h"
+#include "Profiler.h"
+
+static bool rangeLess(const range_t &a, const range_t &b) { return(a.start_ea < b.start_ea); }
+
+static BOOL inRanges(const std::vector<range_t> &ranges, ea_t ea)
+{
+	std::vector<range_t>::const_iterator it = std::upper_bound(ranges.begin(), ranges.end(), range_t(ea, ea), rangeLess);
+	if (it == ranges.begin())
+		return(FALSE);
+	--it;
+	return(it->contains(ea));
+}
+
+VtableClassifier::VtableClassifier() : m_imageBase(0), m_pointerSize(4), m_vtables(0)
+{
+}
+
+void VtableClassifier::setup(const std::vector<range_t> &execRanges, const std::vector<range_t> &dataRanges)
+{
+	m_exec = execRanges;
+	m_data = dataRanges;
+	std::sort(m_exec.begin(), m_exec.end(), rangeLess);
+	std::sort(m_data.begin(), m_data.end(), rangeLess);
+	m_imageBase = get_imagebase();
+	m_seeds.clear();
+	m_vtables = 0;
+}
+
+void VtableClassifier::begin(UINT pointerSize)
+{
+	m_pointerSize = pointerSize;
+	m_candidates.clear();
+}
+
+// A pointer to data followed by a pointer to code, worker thread safe
+void VtableClassifier::classify(const FLAGWINDOW &window)
+{
+	ea_t ea = ((window.start + (m_pointerSize - 1)) & ~((ea_t) m_pointerSize - 1));
+	for (; (ea < window.ownedEnd) && ((ea + (2 * m_pointerSize)) <= window.end); ea += m_pointerSize)
+	{
+		// Little endian pointers from the byte values, valueless bytes read as zero
+		UINT64 col = 0, slot = 0;
+		for (int i = (m_pointerSize - 1); i >= 0; i--)
+		{
+			col  = ((col << 8) | window.byteAt(ea + i));
+			slot = ((slot << 8) | window.byteAt(ea + m_pointerSize + i));
+		}
+
+		if (inRanges(m_data, (ea_t) col) && inRanges(m_exec, (ea_t) slot))
+			m_candidates.push_back(ea);
+	}
+}
+
+ea_t VtableClassifier::pointerAt(ea_t ea) const
+{
+	return((m_pointerSize == 8) ? (ea_t) get_qword(ea) : (ea_t) get_dword(ea));
+}
+
+// Complete object locator, consistent with its type and hierarchy descriptors?
+// x86: { signature 0, offset, cdOffset, type descriptor, hierarchy descriptor }, absolute pointers
+// x64: { signature 1, offset, cdOffset, type descriptor, hierarchy descriptor, self }, image relative
+BOOL VtableClassifier::isLocator(ea_t col) const
+{
+	BOOL is64 = (m_pointerSize == 8);
+	if (get_dword(col) != (is64 ? 1 : 0))
+		return(FALSE);
+	if (is64 && ((ea_t) (m_imageBase + get_dword(col + 20)) != col))
+		return(FALSE);
+
+	ea_t typeDesc  = (is64 ? (m_imageBase + get_dword(col + 12)) : (ea_t) get_dword(col + 12));
+	ea_t hierarchy = (is64 ? (m_imageBase + get_dword(col + 16)) : (ea_t) get_dword(col + 16));
+	if (!is_mapped(typeDesc) || !is_mapped(hierarchy))
+		return(FALSE);
+
+	// Type descriptor { type_info vtable, spare, decorated name }, class or struct name
+	char name[4];
+	if (get_bytes(name, sizeof(name), (typeDesc + (2 * m_pointerSize))) != sizeof(name))
+		return(FALSE);
+	if ((name[0] != '.') || (name[1] != '?') || (name[2] != 'A') || ((name[3] != 'V') && (name[3] != 'U')))
+		return(FALSE);
+
+	// Hierarchy descriptor { signature 0, attributes, base class count, base class array }
+	UINT32 bases = get_dword(hierarchy + 8);
+	return((get_dword(hierarchy) == 0) && (bases >= 1) && (bases <= 1024));
+}
+
+// Check the candidates, gather the slots of the vtables up to the first non-code pointer
+void VtableClassifier::apply()
+{
+	for (std::vector<ea_t>::iterator it = m_candidates.begin(); it != m_candidates.end(); ++it)
+	{
+		if (!isLocator(pointerAt(*it)))
+			continue;
+
+		m_vtables++;
+		ea_t slot = (*it + m_pointerSize);
+		for (int i = 0; i < RTTI_MAX_SLOTS; i++, slot += m_pointerSize)
+		{
+			ea_t target = pointerAt(slot);
+			if (!inRanges(m_exec, target))
+				break;
+
+			flags_t flags = get_flags(target);
+			if (is_tail(flags) || is_data(flags))
+				break;
+			if (!is_func(flags))
+			{
+				FUNCNODE seed = { target, 0 };
+				m_seeds.push_back(seed);
+			}
+		}
+	}
+	m_candidates.clear();
+}
@@ -0,0 +1,36 @@
+// MSVC RTTI vtable finder.
+// Every vtable of a class with RTTI is preceded by a pointer to its "Complete Object Locator", which
+// points at the class's type descriptor and hierarchy descriptor; finding them gives every vtable.
+#pragma once
+#include <vector>
+#include "SegStream.h"
+#include "FuncSeed.h"
+
+// Vtable slot limit
+#define RTTI_MAX_SLOTS 4096
+
+// Finds the pointers to locators followed by code pointers in a data segment stream, the locator
+// is checked against its descriptors and the vtable slots gathered in apply().
+class VtableClassifier : public WindowClassifier
+{
+public:
+	VtableClassifier();
+
+	void setup(const std::vector<range_t> &execRanges, const std::vector<range_t> &dataRanges);
+	void begin(UINT pointerSize);	// Per data segment
+	void classify(const FLAGWINDOW &window);
+	void apply();
+
+	FUNCLIST &seeds() { return(m_seeds); }
+	UINT vtables() const { return(m_vtables); }
+
+private:
+	BOOL isLocator(ea_t col) const;
+	ea_t pointerAt(ea_t ea) const;
+
+	std::vector<range_t> m_exec, m_data;
+	std::vector<ea_t> m_candidates;	// Locator pointer addresses
+	FUNCLIST m_seeds;
+	ea_t m_imageBase;
+	UINT m_pointerSize, m_vtables;
+};
@@ -0,0 +1,610 @@
+// Optional SDK call trace recorder, development builds with SDK_TRACE defined only.
+#include "stdafx.h"
+#ifdef SDK_TRACE
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+// Records buffered before a write, and the longest coalesced flags run
+#define TRACE_BUFFER_RECS (64 * 1024)
+#define TRACE_MAX_RUN     (1024 * 1024)
+
+namespace SdkTrace
+{
+	static FILE *s_file = NULL;
+	static std::vector<BYTE> s_buffer;
+	static UINT64 s_startTicks = 0;
+	static TIMESTAMP s_startTime = 0;
+
+	// Open flags run
+	static TRACEREC s_run;
+	static std::vector<UINT32> s_runFlags;
+
+	static void flush()
+	{
+		if (s_file && !s_buffer.empty())
+			qfwrite(s_file, s_buffer.data(), s_buffer.size());
+		s_buffer.clear();
+	}
+
+	static void write(const void *data, size_t size)
+	{
+		s_buffer.insert(s_buffer.end(), (const BYTE *) data, ((const BYTE *) data + size));
+		if (s_buffer.size() >= (TRACE_BUFFER_RECS * sizeof(TRACEREC)))
+			flush();
+	}
+
+	static void endRun()
+	{
+		if (s_run.arg1)
+		{
+			write(&s_run, sizeof(s_run));
+			write(s_runFlags.data(), (s_runFlags.size() * sizeof(UINT32)));
+			s_run.arg1 = 0;
+			s_runFlags.clear();
+		}
+	}
+
+	static UINT32 ticksSince(UINT64 start)
+	{
+		UINT64 ticks = (__rdtsc() - start);
+		return((UINT32) ((ticks > 0xFFFFFFFF) ? 0xFFFFFFFF : ticks));
+	}
+
+	// "extra" fills TRACEREC::extra, low byte first
+	static void record(TRACECALL call, UINT64 start, UINT64 arg0, UINT64 arg1, UINT64 result, UINT32 extra = 0, const void *payload = NULL, size_t size = 0)
+	{
+		if (!s_file)
+			return;
+		endRun();
+
+		TRACEREC rec;
+		memset(&rec, 0, sizeof(rec));
+		rec.call     = (uint8_t) call;
+		rec.extra[0] = (uint8_t) extra;
+		rec.extra[1] = (uint8_t) (extra >> 8);
+		rec.extra[2] = (uint8_t) (extra >> 16);
+		rec.ticks    = ticksSince(start);
+		rec.arg0     = arg0;
+		rec.arg1     = arg1;
+		rec.result   = result;
+		write(&rec, sizeof(rec));
+
+		if (size)
+		{
+			static const BYTE zeros[8] = { 0 };
+			write(payload, size);
+			if (size & 7)
+				write(zeros, (8 - (size & 7)));
+		}
+	}
+
+	// ea_t to trace address, BADADDR the same in both sizes
+	static inline UINT64 addr(ea_t ea) { return((ea == BADADDR) ? TRACE_BADADDR : (UINT64) ea); }
+
+	// Instruction record with its operands
+	static void recordInsn(TRACECALL call, UINT64 start, ea_t ea, const insn_t &insn, BOOL decoded, UINT64 result)
+	{
+		TRACEOP ops[UA_MAXOP];
+		UINT count = 0;
+		for (; decoded && (count < UA_MAXOP) && (insn.ops[count].type != o_void); count++)
+		{
+			const op_t &op = insn.ops[count];
+			TRACEOP &traceOp = ops[count];
+			memset(&traceOp, 0, sizeof(traceOp));
+			traceOp.type  = op.type;
+			traceOp.dtype = op.dtype;
+			traceOp.offb  = op.offb;
+			traceOp.flags = op.flags;
+			traceOp.reg   = op.reg;
+			traceOp.value = op.value;
+			traceOp.addr  = op.addr;
+		}
+		record(call, start, addr(ea), (decoded ? insn.itype : 0), result, count, ops, (count * sizeof(TRACEOP)));
+	}
+
+	static void recordChunk(ea_t start, ea_t end, const func_t *chunk)
+	{
+		record(TC_CHUNK, __rdtsc(), addr(start), addr(end), ((chunk->flags & FUNC_TAIL) ? addr(chunk->owner) : TRACE_BADADDR), (UINT32) (chunk->flags & 0xFFFFFF));
+	}
+
+	// The IDB changes made while tracing, by the plugin's calls and the auto-analyzer
+	static ssize_t idaapi idbEvent(void *ud, int code, va_list va)
+	{
+		switch (code)
+		{
+			case idb_event::make_code:
+			{
+				const insn_t *insn = va_arg(va, const insn_t *);
+				record(TC_EV_CODE, __rdtsc(), addr(insn->ea), insn->size, 0);
+			}
+			break;
+
+			case idb_event::make_data:
+			{
+				ea_t ea = va_arg(va, ea_t);
+				flags_t flags = va_arg(va, flags_t);
+				va_arg(va, tid_t);
+				asize_t len = va_arg(va, asize_t);
+				record(TC_EV_DATA, __rdtsc(), addr(ea), len, flags);
+			}
+			break;
+
+			case idb_event::destroyed_items:
+			{
+				ea_t ea1 = va_arg(va, ea_t);
+				ea_t ea2 = va_arg(va, ea_t);
+				record(TC_EV_DESTROYED, __rdtsc(), addr(ea1), addr(ea2), 0);
+			}
+			break;
+
+			case idb_event::func_added:
+			case idb_event::func_updated:
+			{
+				func_t *pfn = va_arg(va, func_t *);
+				recordChunk(pfn->start_ea, pfn->end_ea, pfn);
+			}
+			break;
+
+			case idb_event::func_tail_appended:
+			{
+				va_arg(va, func_t *);
+				func_t *tail = va_arg(va, func_t *);
+				recordChunk(tail->start_ea, tail->end_ea, tail);
+			}
+			break;
+
+			case idb_event::tail_owner_changed:
+			{
+				func_t *tail = va_arg(va, func_t *);
+				ea_t owner = va_arg(va, ea_t);
+				record(TC_CHUNK, __rdtsc(), addr(tail->start_ea), addr(tail->end_ea), addr(owner), (UINT32) (tail->flags & 0xFFFFFF));
+			}
+			break;
+
+			// Before the change, with the new bound
+			case idb_event::set_func_start:
+			{
+				func_t *pfn = va_arg(va, func_t *);
+				ea_t start = va_arg(va, ea_t);
+				record(TC_EV_CHUNK_DEL, __rdtsc(), addr(pfn->start_ea), 0, 0);
+				recordChunk(start, pfn->end_ea, pfn);
+			}
+			break;
+
+			case idb_event::set_func_end:
+			{
+				func_t *pfn = va_arg(va, func_t *);
+				ea_t end = va_arg(va, ea_t);
+				recordChunk(pfn->start_ea, end, pfn);
+			}
+			break;
+
+			case idb_event::deleting_func:
+			{
+				func_t *pfn = va_arg(va, func_t *);
+				record(TC_EV_CHUNK_DEL, __rdtsc(), addr(pfn->start_ea), 0, 0);
+			}
+			break;
+
+			case idb_event::func_tail_deleted:
+			{
+				va_arg(va, func_t *);
+				ea_t tail = va_arg(va, ea_t);
+				record(TC_EV_CHUNK_DEL, __rdtsc(), addr(tail), 0, 0);
+			}
+			break;
+		};
+		return(0);
+	}
+
+	// The IDB facts the passes read but don't change, and every segment's flags
+	static void writePrologue()
+	{
+		UINT64 now = __rdtsc();
+		record(TC_INFO, now, addr(get_imagebase()), addr(inf.min_ea), addr(inf.max_ea), inf.is_64bit());
+
+		int segCount = get_segm_qty();
+		for (int i = 0; i < segCount; i++)
+		{
+			if (segment_t *seg = getnseg(i))
+			{
+				TRACESEGNAMES names;
+				memset(&names, 0, sizeof(names));
+				qstring name;
+				if (get_segm_name(&name, seg) > 0)
+					qstrncpy(names.name, name.c_str(), sizeof(names.name));
+				if (get_segm_class(&name, seg) > 0)
+					qstrncpy(names.sclass, name.c_str(), sizeof(names.sclass));
+				record(TC_SEGMENT, now, addr(seg->start_ea), addr(seg->end_ea), seg->type, (seg->bitness | (seg->perm << 8)), &names, sizeof(names));
+			}
+		}
+
+		size_t chunkCount = get_fchunk_qty();
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			if (func_t *chunk = getn_fchunk((int) i))
+				recordChunk(chunk->start_ea, chunk->end_ea, chunk);
+		}
+
+		size_t nameCount = get_nlist_size();
+		for (size_t i = 0; i < nameCount; i++)
+		{
+			if (const char *name = get_nlist_name(i))
+				record(TC_NAME, now, addr(get_nlist_ea(i)), strlen(name), 0, 0, name, strlen(name));
+		}
+
+		for (ea_t ea = get_first_fixup_ea(); ea != BADADDR; ea = get_next_fixup_ea(ea))
+		{
+			fixup_data_t fd;
+			if (get_fixup(&fd, ea))
+				record(TC_FIXUP, now, addr(ea), fd.get_type(), 0);
+		}
+
+		BYTE buffer[0x400];
+		netnode node(NETNODE_NAME);
+		if (node != BADNODE)
+		{
+			for (nodeidx_t alt = node.altfirst('P'); alt != BADNODE; alt = node.altnext(alt, 'P'))
+				record(TC_ALTVAL, now, alt, node.altval(alt, 'P'), 0, 'P');
+
+			ssize_t size = node.supval(0, buffer, sizeof(buffer), 'R');
+			if (size > 0)
+				record(TC_BLOB, now, TB_PASS_RATES, size, 0, 0, buffer, size);
+		}
+
+		netnode penode("$ PE header");
+		if (penode != BADNODE)
+		{
+			ssize_t size = penode.valobj(buffer, sizeof(buffer));
+			if (size > 0)
+				record(TC_BLOB, now, TB_PE_HEADER, size, 0, 0, buffer, size);
+		}
+
+		// The database image, as runs
+		std::vector<UINT32> flags;
+		for (int i = 0; i < segCount; i++)
+		{
+			if (segment_t *seg = getnseg(i))
+			{
+				for (ea_t ea = seg->start_ea; ea < seg->end_ea;)
+				{
+					UINT count = (UINT) std::min<asize_t>((seg->end_ea - ea), TRACE_MAX_RUN);
+					flags.resize(count);
+					for (UINT j = 0; j < count; j++)
+						flags[j] = (UINT32) (get_full_flags)(ea + j);
+					record(TC_FLAGS_RUN, now, addr(ea), count, 0);
+					write(flags.data(), (count * sizeof(UINT32)));
+					ea += count;
+				}
+			}
+		}
+		record(TC_PROLOGUE_END, now, 0, 0, 0);
+	}
+
+	void begin()
+	{
+		end();
+
+		qstring path(get_path(PATH_TYPE_IDB));
+		path += ".xpt";
+		if (!(s_file = qfopen(path.c_str(), "wb")))
+		{
+			msg("** Trace file \"%s\" open failed! **\n", path.c_str());
+			return;
+		}
+		msg("Tracing SDK calls to \"%s\".\n", path.c_str());
+
+		TRACEHEADER header = { TRACE_MAGIC, TRACE_VERSION, (uint32_t) sizeof(ea_t), 0 };
+		write(&header, sizeof(header));
+		memset(&s_run, 0, sizeof(s_run));
+		s_run.call = TC_FLAGS_RUN;
+		writePrologue();
+		hook_to_notification_point(HT_IDB, idbEvent, NULL);
+		s_startTicks = __rdtsc();
+		s_startTime = getTimeStamp();
+	}
+
+	void end()
+	{
+		if (!s_file)
+			return;
+		unhook_from_notification_point(HT_IDB, idbEvent, NULL);
+
+		double seconds = (getTimeStamp() - s_startTime);
+		UINT64 secondsBits;
+		memcpy(&secondsBits, &seconds, sizeof(secondsBits));
+		record(TC_END, __rdtsc(), (__rdtsc() - s_startTicks), 0, secondsBits);
+		flush();
+		qfclose(s_file);
+		s_file = NULL;
+		std::vector<BYTE> empty;
+		s_buffer.swap(empty);
+	}
+
+	flags_t getFlags(ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		flags_t result = (get_flags)(ea);
+		record(TC_GET_FLAGS, start, addr(ea), 0, result);
+		return(result);
+	}
+
+	// Consecutive ones coalesce into a run
+	flags_t getFullFlags(ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		flags_t result = (get_full_flags)(ea);
+		if (!s_file)
+			return(result);
+
+		if (s_run.arg1 && ((s_run.arg0 + s_run.arg1) == (UINT64) ea) && (s_run.arg1 < TRACE_MAX_RUN))
+		{
+			s_run.arg1++;
+			s_run.ticks += ticksSince(start);
+		}
+		else
+		{
+			endRun();
+			s_run.arg0  = addr(ea);
+			s_run.arg1  = 1;
+			s_run.ticks = ticksSince(start);
+		}
+		s_runFlags.push_back((UINT32) result);
+		return(result);
+	}
+
+	ea_t nextHead(ea_t ea, ea_t maxea)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (next_head)(ea, maxea);
+		record(TC_NEXT_HEAD, start, addr(ea), addr(maxea), addr(result));
+		return(result);
+	}
+
+	ea_t prevHead(ea_t ea, ea_t minea)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (prev_head)(ea, minea);
+		record(TC_PREV_HEAD, start, addr(ea), addr(minea), addr(result));
+		return(result);
+	}
+
+	ea_t nextUnknown(ea_t ea, ea_t maxea)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (next_unknown)(ea, maxea);
+		record(TC_NEXT_UNKNOWN, start, addr(ea), addr(maxea), addr(result));
+		return(result);
+	}
+
+	ea_t nextThat(ea_t ea, ea_t maxea, testf_t *testf, void *ud)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (next_that)(ea, maxea, testf, ud);
+		record(TC_NEXT_THAT, start, addr(ea), addr(maxea), addr(result));
+		return(result);
+	}
+
+	ea_t getItemEnd(ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (get_item_end)(ea);
+		record(TC_GET_ITEM_END, start, addr(ea), 0, addr(result));
+		return(result);
+	}
+
+	int decodeInsn(insn_t *out, ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		int result = (decode_insn)(out, ea);
+		recordInsn(TC_DECODE_INSN, start, ea, *out, (result > 0), (UINT64) (INT64) result);
+		return(result);
+	}
+
+	int createInsn(ea_t ea, insn_t *out)
+	{
+		UINT64 start = __rdtsc();
+		insn_t insn;
+		if (!out)
+			out = &insn;
+		int result = (create_insn)(ea, out);
+		recordInsn(TC_CREATE_INSN, start, ea, *out, (result > 0), (UINT64) (INT64) result);
+		return(result);
+	}
+
+	ea_t decodePrevInsn(insn_t *out, ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (decode_prev_insn)(out, ea);
+		recordInsn(TC_DECODE_PREV_INSN, start, ea, *out, (result != BADADDR), addr(result));
+		return(result);
+	}
+
+	bool addFunc(ea_t ea1, ea_t ea2)
+	{
+		UINT64 start = __rdtsc();
+		bool result = (add_func)(ea1, ea2);
+		record(TC_ADD_FUNC, start, addr(ea1), addr(ea2), result);
+		return(result);
+	}
+
+	func_t *getFchunk(ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		func_t *result = (get_fchunk)(ea);
+		record(TC_GET_FCHUNK, start, addr(ea), (result ? addr(result->end_ea) : 0), (result ? addr(result->start_ea) : TRACE_BADADDR));
+		return(result);
+	}
+
+	func_t *getFunc(ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		func_t *result = (get_func)(ea);
+		record(TC_GET_FUNC, start, addr(ea), (result ? addr(result->end_ea) : 0), (result ? addr(result->start_ea) : TRACE_BADADDR));
+		return(result);
+	}
+
+	bool delItems(ea_t ea, int flags, asize_t nbytes, bool (idaapi *may_destroy)(ea_t ea))
+	{
+		UINT64 start = __rdtsc();
+		bool result = (del_items)(ea, flags, nbytes, may_destroy);
+		record(TC_DEL_ITEMS, start, addr(ea), nbytes, result);
+		return(result);
+	}
+
+	bool createByte(ea_t ea, asize_t length)
+	{
+		UINT64 start = __rdtsc();
+		bool result = (create_byte)(ea, length);
+		record(TC_CREATE_BYTE, start, addr(ea), length, result);
+		return(result);
+	}
+
+	bool createAlign(ea_t ea, asize_t length, int alignment)
+	{
+		UINT64 start = __rdtsc();
+		bool result = (create_align)(ea, length, alignment);
+		record(TC_CREATE_ALIGN, start, addr(ea), length, result);
+		return(result);
+	}
+
+	bool autoWait()
+	{
+		UINT64 start = __rdtsc();
+		bool result = (auto_wait)();
+		record(TC_AUTO_WAIT, start, 0, 0, result);
+		return(result);
+	}
+
+	void autoMarkRange(ea_t start, ea_t end, atype_t type)
+	{
+		UINT64 ticks = __rdtsc();
+		(auto_mark_range)(start, end, type);
+		record(TC_AUTO_MARK_RANGE, ticks, addr(start), addr(end), 0);
+	}
+
+	ea_t getFirstCrefFrom(ea_t from)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (get_first_cref_from)(from);
+		record(TC_GET_FIRST_CREF_FROM, start, addr(from), 0, addr(result));
+		return(result);
+	}
+
+	ssize_t getSwitchInfo(switch_info_t *out, ea_t ea)
+	{
+		UINT64 start = __rdtsc();
+		ssize_t result = (get_switch_info)(out, ea);
+		if (result > 0)
+		{
+			TRACESWITCH info;
+			memset(&info, 0, sizeof(info));
+			info.flags  = out->flags;
+			info.ncases = out->ncases;
+			info.jsize  = (uint8_t) out->get_jtable_element_size();
+			info.vsize  = (uint8_t) out->get_vtable_element_size();
+			info.jcases = out->jcases;
+			info.jumps  = addr(out->jumps);
+			info.values = addr(out->values);
+			record(TC_GET_SWITCH_INFO, start, addr(ea), addr(out->jumps), (UINT64) (INT64) result, 0, &info, sizeof(info));
+		}
+		else
+			record(TC_GET_SWITCH_INFO, start, addr(ea), 0, (UINT64) (INT64) result);
+		return(result);
+	}
+
+	ea_t getFirstCrefTo(ea_t to)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (get_first_cref_to)(to);
+		record(TC_GET_FIRST_CREF_TO, start, addr(to), 0, addr(result));
+		return(result);
+	}
+
+	ea_t getFirstDrefFrom(ea_t from)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (get_first_dref_from)(from);
+		record(TC_GET_FIRST_DREF_FROM, start, addr(from), 0, addr(result));
+		return(result);
+	}
+
+	ea_t getFirstDrefTo(ea_t to)
+	{
+		UINT64 start = __rdtsc();
+		ea_t result = (get_first_dref_to)(to);
+		record(TC_GET_FIRST_DREF_TO, start, addr(to), 0, addr(result));
+		return(result);
+	}
+
+	// Type and kind of the xref found, and the flags iterated with
+	UINT32 XrefBlock::extra(bool found) const
+	{
+		return((found ? (type | (iscode << 8)) : 0) | (m_flags << 16));
+	}
+
+	bool XrefBlock::first_from(ea_t from, int flags)
+	{
+		UINT64 start = __rdtsc();
+		m_flags = flags;
+		bool result = base::first_from(from, flags);
+		record(TC_XREF_FIRST_FROM, start, addr(from), flags, (result ? addr(to) : TRACE_BADADDR), extra(result));
+		return(result);
+	}
+
+	bool XrefBlock::next_from()
+	{
+		UINT64 start = __rdtsc();
+		ea_t current = to;
+		bool result = base::next_from();
+		record(TC_XREF_NEXT_FROM, start, addr(from), addr(current), (result ? addr(to) : TRACE_BADADDR), extra(result));
+		return(result);
+	}
+
+	bool XrefBlock::first_to(ea_t to, int flags)
+	{
+		UINT64 start = __rdtsc();
+		m_flags = flags;
+		bool result = base::first_to(to, flags);
+		record(TC_XREF_FIRST_TO, start, addr(to), flags, (result ? addr(from) : TRACE_BADADDR), extra(result));
+		return(result);
+	}
+
+	bool XrefBlock::next_to()
+	{
+		UINT64 start = __rdtsc();
+		ea_t current = from;
+		bool result = base::next_to();
+		record(TC_XREF_NEXT_TO, start, addr(to), addr(current), (result ? addr(from) : TRACE_BADADDR), extra(result));
+		return(result);
+	}
+
+	FlowChart::FlowChart(const char *title, func_t *pfn, ea_t ea1, ea_t ea2, int flags, UINT64 start) : base(title, pfn, ea1, ea2, flags)
+	{
+		if (!s_file)
+			return;
+
+		int count = size();
+		std::vector<TRACEBLOCK> blocks(std::max(count, 0));
+		std::vector<uint32_t> succs;
+		for (int i = 0; i < count; i++)
+		{
+			blocks[i].start = addr(this->blocks[i].start_ea);
+			blocks[i].end   = addr(this->blocks[i].end_ea);
+			blocks[i].firstSucc = (uint32_t) succs.size();
+			blocks[i].succCount = nsucc(i);
+			for (int j = 0; j < nsucc(i); j++)
+				succs.push_back(succ(i, j));
+		}
+
+		std::vector<BYTE> payload((blocks.size() * sizeof(TRACEBLOCK)) + (succs.size() * sizeof(uint32_t)));
+		if (!blocks.empty())
+			memcpy(payload.data(), blocks.data(), (blocks.size() * sizeof(TRACEBLOCK)));
+		if (!succs.empty())
+			memcpy((payload.data() + (blocks.size() * sizeof(TRACEBLOCK))), succs.data(), (succs.size() * sizeof(uint32_t)));
+		record(TC_FLOW_CHART, start, (pfn ? addr(pfn->start_ea) : addr(ea1)), blocks.size(), succs.size(), 0, payload.data(), payload.size());
+	}
+};
+
+#endif // SDK_TRACE
@@ -0,0 +1,88 @@
+// Optional SDK call trace recorder, development builds with SDK_TRACE defined only.
+// Included last by "StdAfx.h" so the macros below route the plugin's SDK calls through the
+// recorder. The trace ("<IDB>.xpt", see "TraceFormat.h") starts with a prologue of the IDB facts
+// the passes read, and records the IDB changes IDA makes along the way; "Replay/TraceReplay.cpp"
+// runs the pass code against it offline.
+#pragma once
+#ifdef SDK_TRACE
+#include "TraceFormat.h"
+
+namespace SdkTrace
+{
+	void begin();	// Start a new trace file for the IDB
+	void end();		// Flush and close it
+
+	flags_t getFlags(ea_t ea);
+	flags_t getFullFlags(ea_t ea);
+	ea_t nextHead(ea_t ea, ea_t maxea);
+	ea_t prevHead(ea_t ea, ea_t minea);
+	ea_t nextUnknown(ea_t ea, ea_t maxea);
+	ea_t nextThat(ea_t ea, ea_t maxea, testf_t *testf, void *ud = NULL);
+	ea_t getItemEnd(ea_t ea);
+	int decodeInsn(insn_t *out, ea_t ea);
+	int createInsn(ea_t ea, insn_t *out = NULL);
+	bool addFunc(ea_t ea1, ea_t ea2 = BADADDR);
+	func_t *getFchunk(ea_t ea);
+	func_t *getFunc(ea_t ea);
+	bool delItems(ea_t ea, int flags = 0, asize_t nbytes = 1, bool (idaapi *may_destroy)(ea_t ea) = NULL);
+	bool createByte(ea_t ea, asize_t length);
+	bool createAlign(ea_t ea, asize_t length, int alignment);
+	bool autoWait();
+	void autoMarkRange(ea_t start, ea_t end, atype_t type);
+	ea_t getFirstCrefFrom(ea_t from);
+	ssize_t getSwitchInfo(switch_info_t *out, ea_t ea);
+	ea_t decodePrevInsn(insn_t *out, ea_t ea);
+	ea_t getFirstCrefTo(ea_t to);
+	ea_t getFirstDrefFrom(ea_t from);
+	ea_t getFirstDrefTo(ea_t to);
+
+	// Stands in for xrefblk_t in the plugin's code
+	struct XrefBlock : public xrefblk_t
+	{
+		typedef ::xrefblk_t base;
+		bool first_from(ea_t from, int flags);
+		bool next_from();
+		bool first_to(ea_t to, int flags);
+		bool next_to();
+
+	private:
+		UINT32 extra(bool found) const;
+		int m_flags;
+	};
+
+	// And for qflow_chart_t, recording the chart built; "start" times the base constructor
+	struct FlowChart : public qflow_chart_t
+	{
+		typedef ::qflow_chart_t base;
+		FlowChart(const char *title, func_t *pfn, ea_t ea1, ea_t ea2, int flags, UINT64 start = __rdtsc());
+	};
+};
+
+// The recorder itself calls the real ones as "(get_flags)(ea)", etc.
+#define get_flags(...)           SdkTrace::getFlags(__VA_ARGS__)
+#define get_full_flags(...)      SdkTrace::getFullFlags(__VA_ARGS__)
+#define next_head(...)           SdkTrace::nextHead(__VA_ARGS__)
+#define prev_head(...)           SdkTrace::prevHead(__VA_ARGS__)
+#define next_unknown(...)        SdkTrace::nextUnknown(__VA_ARGS__)
+#define next_that(...)           SdkTrace::nextThat(__VA_ARGS__)
+#define get_item_end(...)        SdkTrace::getItemEnd(__VA_ARGS__)
+#define decode_insn(...)         SdkTrace::decodeInsn(__VA_ARGS__)
+#define create_insn(...)         SdkTrace::createInsn(__VA_ARGS__)
+#define add_func(...)            SdkTrace::addFunc(__VA_ARGS__)
+#define get_fchunk(...)          SdkTrace::getFchunk(__VA_ARGS__)
+#define get_func(...)            SdkTrace::getFunc(__VA_ARGS__)
+#define del_items(...)           SdkTrace::delItems(__VA_ARGS__)
+#define create_byte(...)         SdkTrace::createByte(__VA_ARGS__)
+#define create_align(...)        SdkTrace::createAlign(__VA_ARGS__)
+#define auto_wait(...)           SdkTrace::autoWait(__VA_ARGS__)
+#define auto_mark_range(...)     SdkTrace::autoMarkRange(__VA_ARGS__)
+#define get_first_cref_from(...) SdkTrace::getFirstCrefFrom(__VA_ARGS__)
+#define get_switch_info(...)     SdkTrace::getSwitchInfo(__VA_ARGS__)
+#define decode_prev_insn(...)    SdkTrace::decodePrevInsn(__VA_ARGS__)
+#define get_first_cref_to(...)   SdkTrace::getFirstCrefTo(__VA_ARGS__)
+#define get_first_dref_from(...) SdkTrace::getFirstDrefFrom(__VA_ARGS__)
+#define get_first_dref_to(...)   SdkTrace::getFirstDrefTo(__VA_ARGS__)
+#define xrefblk_t                SdkTrace::XrefBlock
+#define qflow_chart_t            SdkTrace::FlowChart
+
+#endif // SDK_TRACE
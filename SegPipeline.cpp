@@ -0,0 +1,243 @@
+// Multi-threaded segment snapshot pipeline
+#include "stdafx.h"
+#include <algorithm>
+#include <chrono>
+#include "SegPipeline.h"
+#include "Profiler.h"
+
+// Yields spent waiting before backing off to short sleeps
+#define PIPELINE_SPINS 64
+
+// Wait a little, spinning at first
+static void backOff(UINT &spins)
+{
+	if (++spins < PIPELINE_SPINS)
+		std::this_thread::yield();
+	else
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+SegPipeline::SegPipeline() : m_slotCount(0), m_classifier(NULL), m_range(0), m_next(0), m_windowSize(0), m_overlap(0), m_active(FALSE),
+	m_readCount(0), m_scanNext(0), m_mergeCount(0), m_readDone(false), m_stop(false), m_failed(false), m_position(0)
+{
+	for (int i = 0; i < PIPELINE_MAX_SLOTS; i++)
+		m_slots[i].state.store(SLOT_FREE, std::memory_order_relaxed);
+}
+
+void SegPipeline::begin(const std::vector<range_t> &ranges, WindowClassifier &classifier, UINT memoryMB, UINT overlap)
+{
+	end();
+	if (memoryMB == 0)
+		memoryMB = STREAM_MEMORY_MB;
+
+	// A scan worker per core, less the main and merge threads
+	UINT cores = std::thread::hardware_concurrency();
+	UINT workers = std::min(std::max(((cores > 2) ? (cores - 2) : 1), 1U), (UINT) PIPELINE_MAX_WORKERS);
+	m_slotCount = (workers + PIPELINE_EXTRA_SLOTS);
+
+	// Every slot's flags and scan bytes in the memory limit
+	m_ranges = ranges;
+	m_range = 0;
+	m_next = (m_ranges.empty() ? 0 : m_ranges.front().start_ea);
+	m_overlap = overlap;
+	m_windowSize = std::max((size_t) 4096, ((((size_t) memoryMB << 20) / (m_slotCount * (sizeof(flags_t) + 1))) - overlap));
+
+	for (UINT i = 0; i < m_slotCount; i++)
+		m_slots[i].state.store(SLOT_FREE, std::memory_order_relaxed);
+	m_readCount.store(0, std::memory_order_relaxed);
+	m_scanNext.store(0, std::memory_order_relaxed);
+	m_mergeCount.store(0, std::memory_order_relaxed);
+	m_readDone.store(m_ranges.empty(), std::memory_order_relaxed);
+	m_stop.store(false, std::memory_order_relaxed);
+	m_failed.store(false, std::memory_order_relaxed);
+	m_position.store(m_next, std::memory_order_relaxed);
+	m_invalidated.reset(PIPELINE_INVALIDATE_QUEUE);
+
+	m_classifier = &classifier;
+	m_classifier->cancel(false);
+	m_active = TRUE;
+
+	for (UINT i = 0; i < workers; i++)
+		m_threads.push_back(std::thread(&SegPipeline::scanWorker, this));
+	m_threads.push_back(std::thread(&SegPipeline::mergeWorker, this));
+}
+
+// Stop the threads and free the window memory
+void SegPipeline::end()
+{
+	if (!m_active)
+		return;
+
+	m_stop.store(true, std::memory_order_release);
+	m_classifier->cancel(true);
+	for (std::vector<std::thread>::iterator it = m_threads.begin(); it != m_threads.end(); ++it)
+		it->join();
+	m_threads.clear();
+
+	for (UINT i = 0; i < m_slotCount; i++)
+	{
+		std::vector<flags_t> empty;
+		m_slots[i].window.flags.swap(empty);
+		std::vector<BYTE> emptyScan;
+		m_slots[i].window.scan.swap(emptyScan);
+	}
+	if (!m_ranges.empty())
+		m_position.store(m_ranges.back().end_ea, std::memory_order_release);
+	m_ranges.clear();
+	m_range = 0;
+	m_active = FALSE;
+}
+
+// Snapshot the next window, as SegStream does
+void SegPipeline::read(FLAGWINDOW &window)
+{
+	ea_t end = m_ranges[m_range].end_ea;
+	window.start    = m_next;
+	window.ownedEnd = ((ea_t) std::min((UINT64) end, ((UINT64) m_next + m_windowSize)));
+	window.end      = ((ea_t) std::min((UINT64) end, ((UINT64) window.ownedEnd + m_overlap)));
+	window.last     = (window.ownedEnd >= end);
+
+	window.flags.resize((size_t) (window.end - window.start));
+	flags_t *flags = window.flags.data();
+	for (ea_t ea = window.start; ea < window.end; ea++)
+		*flags++ = get_full_flags(ea);
+
+	m_next = window.ownedEnd;
+	if (window.last && (++m_range < m_ranges.size()))
+		m_next = m_ranges[m_range].start_ea;
+}
+
+// Read ahead a window into a free slot, and apply what the merge thread has classified so far
+BOOL SegPipeline::step()
+{
+	if (!m_active)
+		return(FALSE);
+
+	// The SDK is main thread only, so a worker failure is reported here
+	if (m_failed.load(std::memory_order_acquire))
+	{
+		msg("** Segment scan failed, the rest of the step is skipped! **\n");
+		end();
+		return(FALSE);
+	}
+
+	BOOL didRead = FALSE;
+	UINT64 readCount = m_readCount.load(std::memory_order_relaxed);
+	if (more())
+	{
+		SLOT &slot = m_slots[readCount % m_slotCount];
+		if (slot.state.load(std::memory_order_acquire) == SLOT_FREE)
+		{
+			PROFILE_CALL("stream read", read(slot.window));
+			slot.state.store(SLOT_READ, std::memory_order_relaxed);
+			m_readCount.store(++readCount, std::memory_order_release);
+			didRead = TRUE;
+		}
+	}
+	if (!more())
+		m_readDone.store(true, std::memory_order_release);
+
+	// The last window's results are in once its merge is counted
+	BOOL done = (m_readDone.load(std::memory_order_relaxed) && (m_mergeCount.load(std::memory_order_acquire) == readCount));
+	PROFILE_CALL("stream apply", m_classifier->apply());
+	if (done)
+	{
+		end();
+		return(FALSE);
+	}
+
+	// Nothing to read, give the threads the time
+	if (!didRead)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return(TRUE);
+}
+
+// Advisory, dropped if the merge thread is that far behind
+void SegPipeline::invalidate(ea_t start, ea_t end)
+{
+	if (m_active && (end > start))
+		m_invalidated.push(range_t(start, end));
+}
+
+// Wait until window "seq" is read, returns FALSE if there won't be one or the pipeline is ending
+BOOL SegPipeline::waitFor(UINT64 seq)
+{
+	UINT spins = 0;
+	while (seq >= m_readCount.load(std::memory_order_acquire))
+	{
+		if (m_stop.load(std::memory_order_acquire))
+			return(FALSE);
+		if (m_readDone.load(std::memory_order_acquire) && (seq >= m_readCount.load(std::memory_order_acquire)))
+			return(FALSE);
+		backOff(spins);
+	}
+	return(!m_stop.load(std::memory_order_acquire));
+}
+
+// Worker side, stop the threads and leave the rest to the main thread
+void SegPipeline::fail()
+{
+	m_failed.store(true, std::memory_order_release);
+	m_stop.store(true, std::memory_order_release);
+	m_classifier->cancel(true);
+}
+
+// Take the next window in line and scan it
+void SegPipeline::scanWorker()
+{
+	for (;;)
+	{
+		UINT64 seq = m_scanNext.fetch_add(1, std::memory_order_relaxed);
+		if (!waitFor(seq))
+			return;
+
+		SLOT &slot = m_slots[seq % m_slotCount];
+		try
+		{
+			m_classifier->scan(slot.window);
+		}
+		catch (...)
+		{
+			fail();
+			return;
+		}
+		slot.state.store(SLOT_SCANNED, std::memory_order_release);
+	}
+}
+
+// Classify the scanned windows in order, then free their slots for the main thread
+void SegPipeline::mergeWorker()
+{
+	for (UINT64 seq = 0;; seq++)
+	{
+		if (!waitFor(seq))
+			return;
+
+		SLOT &slot = m_slots[seq % m_slotCount];
+		UINT spins = 0;
+		while (slot.state.load(std::memory_order_acquire) != SLOT_SCANNED)
+		{
+			if (m_stop.load(std::memory_order_acquire))
+				return;
+			backOff(spins);
+		}
+
+		range_t range;
+		while (m_invalidated.pop(range))
+			m_classifier->invalidate(range);
+
+		try
+		{
+			m_classifier->classify(slot.window);
+		}
+		catch (...)
+		{
+			fail();
+			return;
+		}
+
+		m_position.store(slot.window.ownedEnd, std::memory_order_release);
+		slot.state.store(SLOT_FREE, std::memory_order_release);
+		m_mergeCount.store((seq + 1), std::memory_order_release);
+	}
+}
@@ -0,0 +1,77 @@
+// Multi-threaded segment snapshot pipeline
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "SegStream.h"
+#include "SpscQueue.h"
+
+// Scan worker limit, and the windows in flight past the worker count
+#define PIPELINE_MAX_WORKERS 16
+#define PIPELINE_EXTRA_SLOTS 2
+#define PIPELINE_MAX_SLOTS (PIPELINE_MAX_WORKERS + PIPELINE_EXTRA_SLOTS)
+
+// Main thread edited ranges waiting on the merge thread
+#define PIPELINE_INVALIDATE_QUEUE 1024
+
+// Classifier result queue size, see WindowClassifier::emit()
+#define PIPELINE_RESULT_QUEUE 4096
+
+// Streams a sorted list of ranges like SegStream, through a ring of windows with the work spread
+// over threads, see WindowClassifier:
+//  Main thread:    reads the window snapshots (the SDK is main thread only), and calls apply().
+//  Scan workers:   one per spare core, scan() any read window.
+//  Merge thread:   classify() the scanned windows in order, carrying runs over them.
+// The threads only meet through the slot states and lock-free queues.
+class SegPipeline
+{
+public:
+	SegPipeline();
+	~SegPipeline() { end(); }
+
+	void begin(const std::vector<range_t> &ranges, WindowClassifier &classifier, UINT memoryMB = STREAM_MEMORY_MB, UINT overlap = STREAM_OVERLAP);
+	BOOL step();	// Returns FALSE when the ranges are done
+	void end();
+
+	// Main thread, a range it edited; for the windows in flight, see WindowClassifier::invalidate()
+	void invalidate(ea_t start, ea_t end);
+
+	ea_t position() const { return(m_position.load(std::memory_order_acquire)); }
+	BOOL active() const { return(m_active); }
+
+private:
+	enum SLOTSTATE { SLOT_FREE, SLOT_READ, SLOT_SCANNED };
+	struct SLOT
+	{
+		FLAGWINDOW window;
+		std::atomic<int> state;
+	};
+
+	void read(FLAGWINDOW &window);
+	BOOL more() const { return(m_range < m_ranges.size()); }
+	void scanWorker();
+	void mergeWorker();
+	BOOL waitFor(UINT64 seq);
+	void fail();
+
+	SLOT m_slots[PIPELINE_MAX_SLOTS];
+	UINT m_slotCount;
+	WindowClassifier *m_classifier;
+	std::vector<std::thread> m_threads;
+	SpscQueue<range_t> m_invalidated;
+
+	// Main thread's
+	std::vector<range_t> m_ranges;
+	size_t m_range;
+	ea_t m_next;
+	size_t m_windowSize;
+	UINT m_overlap;
+	BOOL m_active;
+
+	std::atomic<UINT64> m_readCount;	// Windows read, by sequence
+	std::atomic<UINT64> m_scanNext;		// Next window for a scan worker to take
+	std::atomic<UINT64> m_mergeCount;	// Windows merged
+	std::atomic<bool> m_readDone, m_stop;
+	std::atomic<bool> m_failed;		// A worker threw, reported and ended by the main thread
+	std::atomic<ea_t> m_position;
+};
@@ -0,0 +1,120 @@
+// Bounded memory segment streaming for snapshot based passes
+#include "stdafx.h"
+#include <thread>
+#include <algorithm>
+#include "SegStream.h"
+#include "Profiler.h"
+
+SegStream::SegStream() : m_current(0), m_haveCurrent(FALSE), m_active(FALSE), m_failed(FALSE), m_range(0), m_next(0), m_position(0), m_windowSize(0), m_overlap(0)
+{
+}
+
+// Start streaming the range with the given peak window memory
+void SegStream::begin(ea_t start, ea_t end, UINT memoryMB, UINT overlap)
+{
+	std::vector<range_t> ranges;
+	if (end > start)
+		ranges.push_back(range_t(start, end));
+	begin(ranges, memoryMB, overlap);
+}
+
+void SegStream::begin(const std::vector<range_t> &ranges, UINT memoryMB, UINT overlap)
+{
+	if (memoryMB == 0)
+		memoryMB = STREAM_MEMORY_MB;
+
+	m_ranges = ranges;
+	m_range = 0;
+	m_next = m_position = (m_ranges.empty() ? 0 : m_ranges.front().start_ea);
+	m_overlap = overlap;
+	m_windowSize = ((((size_t) memoryMB << 20) / (2 * sizeof(flags_t))) - overlap);
+	m_current = 0;
+	m_haveCurrent = m_failed = FALSE;
+	m_active = TRUE;
+}
+
+// Done, free the window memory
+void SegStream::end()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		std::vector<flags_t> empty;
+		m_window[i].flags.swap(empty);
+	}
+	m_haveCurrent = m_active = FALSE;
+	if (!m_ranges.empty())
+		m_position = m_ranges.back().end_ea;
+	m_ranges.clear();
+	m_range = 0;
+}
+
+// Snapshot the next window
+void SegStream::read(FLAGWINDOW &window)
+{
+	ea_t end = m_ranges[m_range].end_ea;
+	window.start    = m_next;
+	window.ownedEnd = ((ea_t) std::min((UINT64) end, ((UINT64) m_next + m_windowSize)));
+	window.end      = ((ea_t) std::min((UINT64) end, ((UINT64) window.ownedEnd + m_overlap)));
+	window.last     = (window.ownedEnd >= end);
+
+	window.flags.resize((size_t) (window.end - window.start));
+	flags_t *flags = window.flags.data();
+	for (ea_t ea = window.start; ea < window.end; ea++)
+		*flags++ = get_full_flags(ea);
+
+	m_next = window.ownedEnd;
+	if (window.last && (++m_range < m_ranges.size()))
+		m_next = m_ranges[m_range].start_ea;
+}
+
+// Classify the current window on a worker while reading ahead, then apply its results
+BOOL SegStream::step(WindowClassifier &classifier)
+{
+	if (!m_active)
+		return(FALSE);
+
+	if (!m_haveCurrent)
+	{
+		if (!more())
+		{
+			end();
+			return(FALSE);
+		}
+		PROFILE_CALL("stream read", read(m_window[m_current]));
+	}
+
+	FLAGWINDOW &window = m_window[m_current];
+	BOOL failed = FALSE;
+	std::thread worker([&classifier, &window, &failed]()
+	{
+		try
+		{
+			classifier.classify(window);
+		}
+		catch (...)
+		{
+			failed = TRUE;
+		}
+	});
+
+	BOOL haveNext = more();
+	if (haveNext)
+		PROFILE_CALL("stream read", read(m_window[m_current ^ 1]));
+
+	PROFILE_CALL("stream wait", worker.join());
+
+	// Nothing applied from a half classified window; the SDK is main thread only, so it's reported here
+	if (failed)
+	{
+		msg("** Segment scan failed, the rest of the step is skipped! **\n");
+		end();
+		m_failed = TRUE;
+		return(FALSE);
+	}
+	PROFILE_CALL("stream apply", classifier.apply());
+
+	m_position = window.ownedEnd;
+	m_current ^= 1;
+	m_haveCurrent = haveNext;
+	return(TRUE);
+}
@@ -0,0 +1,99 @@
+// Bounded memory segment streaming for snapshot based passes
+#pragma once
+#include <vector>
+#include <thread>
+#include "SpscQueue.h"
+
+// Default peak window memory, both buffers together
+#define STREAM_MEMORY_MB 32
+
+// Look ahead past each window's end, enough to decode an instruction that starts right before it
+#define STREAM_OVERLAP 16
+
+// A snapshot of the full flags (which carry the byte values too) of a segment window.
+// Holds [start, end); the window "owns" [start, ownedEnd), the rest is look ahead overlap
+// with the next window.
+struct FLAGWINDOW
+{
+	ea_t start;
+	ea_t ownedEnd;
+	ea_t end;
+	BOOL last;	// Last window of the range
+	std::vector<flags_t> flags;
+	std::vector<BYTE> scan;	// Per byte results of WindowClassifier::scan(), SegPipeline only
+
+	flags_t operator[](ea_t ea) const { return(flags[(size_t) (ea - start)]); }
+	BYTE byteAt(ea_t ea) const { return((BYTE) (flags[(size_t) (ea - start)] & 0xFF)); }
+};
+
+// Per window consumer of a SegStream.
+// classify() runs on a worker thread and must not call into the IDA SDK; runs or ranges that
+// cross a window boundary are carried over in the classifier between calls.
+// apply() runs on the main thread after classify(), to make the database edits.
+// Note the next window is already read by then, so apply() should recheck anything it edits.
+//
+// Run by a SegPipeline instead, scan() first runs on any of the scan workers, windows in no
+// particular order, and can only keep its results in the window's "scan" bytes. classify() then runs
+// on the merge thread in window order, while apply() runs on the main thread at the same time;
+// the results must go between them through a lock-free queue. invalidate() runs on the merge thread
+// before classify(), with a range the main thread edited since the later windows were read.
+class WindowClassifier
+{
+public:
+	WindowClassifier() : m_canceled(false) {}
+	virtual ~WindowClassifier() {}
+	virtual void scan(FLAGWINDOW &window) {}
+	virtual void classify(const FLAGWINDOW &window) = 0;
+	virtual void invalidate(const range_t &range) {}
+	virtual void apply() = 0;
+
+	void cancel(bool canceled) { m_canceled.store(canceled, std::memory_order_release); }
+
+protected:
+	// classify() side result push for a pipeline, waits for apply() to make room.
+	// Returns FALSE if the pipeline was ended meanwhile.
+	template<class T> BOOL emit(SpscQueue<T> &queue, const T &item)
+	{
+		while (!queue.push(item))
+		{
+			if (m_canceled.load(std::memory_order_acquire))
+				return(FALSE);
+			std::this_thread::yield();
+		}
+		return(TRUE);
+	}
+
+private:
+	std::atomic<bool> m_canceled;
+};
+
+// Streams a segment range, or a sorted list of them, through two fixed size windows.
+// Each step classifies the current window on a worker thread while the main thread reads the next.
+// Windows don't span ranges, each range ends with a "last" window.
+class SegStream
+{
+public:
+	SegStream();
+
+	void begin(ea_t start, ea_t end, UINT memoryMB = STREAM_MEMORY_MB, UINT overlap = STREAM_OVERLAP);
+	void begin(const std::vector<range_t> &ranges, UINT memoryMB = STREAM_MEMORY_MB, UINT overlap = STREAM_OVERLAP);
+	BOOL step(WindowClassifier &classifier);	// Returns FALSE when the range is done, or classify() threw; see failed()
+	void end();
+
+	ea_t position() const { return(m_position); }
+	BOOL active() const { return(m_active); }
+	BOOL failed() const { return(m_failed); }	// Ended by a classify() throw, the results are partial
+
+private:
+	void read(FLAGWINDOW &window);
+	BOOL more() const { return(m_range < m_ranges.size()); }
+
+	FLAGWINDOW m_window[2];
+	int m_current;
+	BOOL m_haveCurrent, m_active, m_failed;
+	std::vector<range_t> m_ranges;
+	size_t m_range;
+	ea_t m_next, m_position;
+	size_t m_windowSize;
+	UINT m_overlap;
+};
@@ -0,0 +1,53 @@
+// Bounded single producer, single consumer lock-free queue
+#pragma once
+#include <atomic>
+#include <vector>
+
+// A ring of power of two size; the producer owns the tail, the consumer the head.
+// reset() isn't thread safe, call it before the threads using the queue start.
+template<class T> class SpscQueue
+{
+public:
+	SpscQueue() : m_mask(0), m_head(0), m_tail(0) {}
+
+	void reset(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+		m_buffer.assign(size, T());
+		m_mask = (size - 1);
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_relaxed);
+	}
+
+	// Producer side, returns FALSE if full
+	BOOL push(const T &item)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if ((tail - m_head.load(std::memory_order_acquire)) > m_mask)
+			return(FALSE);
+		m_buffer[tail & m_mask] = item;
+		m_tail.store((tail + 1), std::memory_order_release);
+		return(TRUE);
+	}
+
+	// Consumer side, returns FALSE if empty
+	BOOL pop(T &item)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return(FALSE);
+		item = m_buffer[head & m_mask];
+		m_head.store((head + 1), std::memory_order_release);
+		return(TRUE);
+	}
+
+	BOOL empty() const { return(m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire)); }
+
+private:
+	std::vector<T> m_buffer;
+	size_t m_mask;
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+};
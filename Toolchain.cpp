@@ -0,0 +1,254 @@
+// Toolchain fingerprint
+#include "stdafx.h"
+#include <algorithm>
+#include "Toolchain.h"
+#include "Profiler.h"
+
+// Functions sampled for their prologue, padding and alignment
+#define FINGERPRINT_SAMPLE 1024
+
+// Score the winner needs, and its lead over the runner up, else the generic profile is used
+#define FINGERPRINT_MIN_SCORE 6
+#define FINGERPRINT_MIN_LEAD  3
+
+// Most any one kind of evidence adds
+#define FINGERPRINT_MAX_WEIGHT 8
+
+namespace Toolchain
+{
+	static UINT s_score[FAMILY_COUNT];
+
+	// Runtime name signatures
+	struct SIGNATURE
+	{
+		FAMILY family;
+		const char *text;
+	};
+
+	static const SIGNATURE s_names[] =
+	{
+		{ MSVC, "__security_init_cookie" },
+		{ MSVC, "CxxThrowException" },
+		{ MSVC, "__CxxFrameHandler" },
+		{ MSVC, "__GSHandlerCheck" },
+		{ MSVC, "_RTC_" },
+		{ GNU, "__mingw" },
+		{ GNU, "__gcc_" },
+		{ GNU, "__gxx_personality" },
+		{ GNU, "_Unwind_" },
+		{ GNU, "__cxa_" },
+		{ BORLAND, "@System@" },
+		{ BORLAND, "System::" },
+		{ BORLAND, "@Sysinit@" },
+		{ BORLAND, "@TObject@" },
+	};
+
+	static const SIGNATURE s_sections[] =
+	{
+		{ MSVC, ".pdata" },
+		{ MSVC, ".gfids" },
+		{ MSVC, "_RDATA" },
+		{ MSVC, ".didat" },
+		{ GNU, ".eh_frame" },
+		{ GNU, ".CRT" },
+		{ GNU, ".bss" },
+		{ BORLAND, "CODE" },
+		{ BORLAND, "DATA" },
+		{ BORLAND, "BSS" },
+		{ BORLAND, ".itext" },
+	};
+
+	static void add(FAMILY family, UINT weight)
+	{
+		s_score[family] += std::min(weight, (UINT) FINGERPRINT_MAX_WEIGHT);
+	}
+
+	// PE optional header linker version: MS link 5 and up, GNU ld 2.x, Borland TLINK/ILINK 2.25
+	static void scanLinkerVersion()
+	{
+		netnode penode("$ PE header");
+		if (penode == BADNODE)
+			return;
+
+		BYTE header[0x40];
+		if (penode.valobj(header, sizeof(header)) < 28)
+			return;
+		if (*((UINT32 *) header) != 0x4550)
+			return;
+
+		BYTE major = header[24 + 2], minor = header[24 + 3];
+		if (major >= 5)
+			add(MSVC, 4);
+		else
+		// Borland's, and binutils 2.25 GNU ld's too; the other scans decide
+		if ((major == 2) && (minor == 25))
+		{
+			add(BORLAND, 2);
+			add(GNU, 2);
+		}
+		else
+		if (major == 2)
+			add(GNU, 4);
+	}
+
+	// Only MS link writes the "Rich" header, it sits between the DOS stub and the PE header
+	static void scanRichHeader()
+	{
+		char path[QMAXPATH];
+		if (get_input_file_path(path, sizeof(path)) <= 0)
+			return;
+		FILE *fp = qfopen(path, "rb");
+		if (!fp)
+			return;
+
+		BYTE dos[0x400];
+		ssize_t size = qfread(fp, dos, sizeof(dos));
+		qfclose(fp);
+		if ((size < 0x40) || (dos[0] != 'M') || (dos[1] != 'Z'))
+			return;
+
+		UINT32 peOffset = std::min(*((UINT32 *) (dos + 0x3C)), (UINT32) (size - 4));
+		for (UINT32 i = 0x80; (i + 4) <= peOffset; i += 4)
+		{
+			if (memcmp(dos + i, "Rich", 4) == 0)
+			{
+				add(MSVC, FINGERPRINT_MAX_WEIGHT);
+				break;
+			}
+		}
+	}
+
+	static void scanSections()
+	{
+		UINT hits[FAMILY_COUNT] = { 0 };
+		int count = get_segm_qty();
+		for (int i = 0; i < count; i++)
+		{
+			qstring name;
+			if (segment_t *seg = getnseg(i))
+			{
+				if (get_segm_name(&name, seg) <= 0)
+					continue;
+
+				// GNU ld's long section names go to the string table, "/4", etc.
+				if (name[0] == '/')
+					hits[GNU]++;
+				for (size_t j = 0; j < qnumber(s_sections); j++)
+				{
+					if (name == s_sections[j].text)
+						hits[s_sections[j].family]++;
+				}
+			}
+		}
+		for (int i = 0; i < FAMILY_COUNT; i++)
+			add((FAMILY) i, (hits[i] * 2));
+	}
+
+	static void scanNames()
+	{
+		UINT hits[FAMILY_COUNT] = { 0 };
+		size_t count = get_nlist_size();
+		for (size_t i = 0; i < count; i++)
+		{
+			const char *name = get_nlist_name(i);
+			for (size_t j = 0; j < qnumber(s_names); j++)
+			{
+				if (strstr(name, s_names[j].text))
+					hits[s_names[j].family]++;
+			}
+		}
+		for (int i = 0; i < FAMILY_COUNT; i++)
+			add((FAMILY) i, hits[i]);
+	}
+
+	// Prologues, the padding before the function, and the alignment of a spread out sample of functions
+	static void scanFunctions()
+	{
+		size_t count = get_func_qty();
+		size_t step = std::max((size_t) 1, (count / FINGERPRINT_SAMPLE));
+		UINT prologues[FAMILY_COUNT] = { 0 };
+		UINT fillCC = 0, fillZero = 0, fillNop = 0, align16 = 0, align4 = 0, sampled = 0;
+		for (size_t i = 0; i < count; i += step)
+		{
+			func_t *f = getn_func(i);
+			if (!f)
+				continue;
+			segment_t *seg = getseg(f->start_ea);
+			BOOL is64 = (seg && seg->is_64bit());
+
+			BYTE bytes[1 + 16];
+			if (get_bytes(bytes, sizeof(bytes), (f->start_ea - 1)) != sizeof(bytes))
+				continue;
+			sampled++;
+
+			if (MsvcProfile::isPrologue(bytes + 1, is64))    prologues[MSVC]++;
+			if (GnuProfile::isPrologue(bytes + 1, is64))     prologues[GNU]++;
+			if (BorlandProfile::isPrologue(bytes + 1, is64)) prologues[BORLAND]++;
+
+			switch (bytes[0])
+			{
+				case 0xCC: fillCC++; break;
+				case 0x00: fillZero++; break;
+				case 0x90: fillNop++; break;
+			};
+
+			if ((f->start_ea & (16 - 1)) == 0)
+				align16++;
+			else
+			if ((f->start_ea & (4 - 1)) == 0)
+				align4++;
+		}
+		if (sampled < 16)
+			return;
+
+		// Weighted by share of the sample, the shared "push ebp; mov ebp,esp" counts for both MSVC and Borland
+		for (int i = 0; i < FAMILY_COUNT; i++)
+			add((FAMILY) i, ((prologues[i] * FINGERPRINT_MAX_WEIGHT) / sampled));
+		add(MSVC, ((fillCC * 4) / sampled));
+		add(GNU, (((fillZero + fillNop) * 4) / sampled));
+		add(BORLAND, ((fillNop * 2) / sampled));
+		if (align4 > align16)
+			add(BORLAND, 4);
+		else
+		{
+			add(MSVC, 2);
+			add(GNU, 2);
+		}
+	}
+
+	FAMILY fingerprint()
+	{
+		PROFILE_SCOPE("Toolchain::fingerprint");
+		memset(s_score, 0, sizeof(s_score));
+		scanLinkerVersion();
+		scanRichHeader();
+		scanSections();
+		scanNames();
+		scanFunctions();
+
+		FAMILY best = UNKNOWN;
+		UINT runnerUp = 0;
+		for (int i = (UNKNOWN + 1); i < FAMILY_COUNT; i++)
+		{
+			if (s_score[i] > s_score[best])
+			{
+				runnerUp = s_score[best];
+				best = (FAMILY) i;
+			}
+			else
+			if (s_score[i] > runnerUp)
+				runnerUp = s_score[i];
+		}
+
+		msg("Toolchain scores: MSVC %u, GNU %u, Borland %u.\n", s_score[MSVC], s_score[GNU], s_score[BORLAND]);
+		if ((s_score[best] < FINGERPRINT_MIN_SCORE) || ((s_score[best] - runnerUp) < FINGERPRINT_MIN_LEAD))
+			return(UNKNOWN);
+		return(best);
+	}
+
+	const char *name(FAMILY family)
+	{
+		static const char * const names[FAMILY_COUNT] = { "Unknown", "MSVC", "GNU", "Borland" };
+		return(((UINT) family < FAMILY_COUNT) ? names[family] : names[UNKNOWN]);
+	}
+};
@@ -0,0 +1,96 @@
+// Toolchain fingerprint and the per toolchain pass profiles.
+// A quick prescan guesses the compiler family from the PE header linker version, the Rich header,
+// section names, runtime names, and the prologues and padding of a sample of the known functions.
+// The passes are then instanced for that family's profile, so the choices are made at compile time
+// rather than per item.
+#pragma once
+#include "Padding.h"
+
+// Profile fill kind bit
+#define FILL_BIT(_kind) (1 << Padding::_kind)
+
+namespace Toolchain
+{
+	enum FAMILY
+	{
+		UNKNOWN,	// Anything goes, the original behavior
+		MSVC,		// Microsoft and Intel
+		GNU,		// MinGW GCC and Clang
+		BORLAND,	// Delphi and C++Builder
+		FAMILY_COUNT
+	};
+
+	// Prescan the database, returns the likely family
+	FAMILY fingerprint();
+	const char *name(FAMILY family);
+
+	// Prologue match helper
+	template<size_t N> inline BOOL leads(const BYTE *bytes, const BYTE (&form)[N]) { return(memcmp(bytes, form, N) == 0); }
+
+	// Pass profiles.
+	// FILLS: the padding kinds that count, ALIGN: function alignment, PASS1_SAFE: if data in code
+	// can be taken as a mistake; isPrologue() gets at least 16 bytes.
+	struct GenericProfile
+	{
+		enum { FILLS = (FILL_BIT(FILL_CC) | FILL_BIT(FILL_ZERO) | FILL_BIT(NOP)), ALIGN = 16, PASS1_SAFE = TRUE };
+		static BOOL isPrologue(const BYTE *bytes, BOOL is64)
+		{
+			static const BYTE pushMovMs[] = { 0x55, 0x8B, 0xEC }, pushMovGnu[] = { 0x55, 0x89, 0xE5 }, pushMov64[] = { 0x55, 0x48, 0x89, 0xE5 };
+			static const BYTE subRsp[] = { 0x48, 0x83, 0xEC };
+			if (is64)
+				return(leads(bytes, pushMov64) || leads(bytes, subRsp));
+			return(leads(bytes, pushMovMs) || leads(bytes, pushMovGnu));
+		}
+	};
+
+	struct MsvcProfile
+	{
+		enum { FILLS = (FILL_BIT(FILL_CC) | FILL_BIT(NOP)), ALIGN = 16, PASS1_SAFE = TRUE };
+		static BOOL isPrologue(const BYTE *bytes, BOOL is64)
+		{
+			if (is64)
+			{
+				// Home space spills, "mov r11,rsp", "mov rax,rsp", "sub rsp,N", "push rbx"
+				static const BYTE movRbx[] = { 0x48, 0x89, 0x5C, 0x24 }, movRcx[] = { 0x48, 0x89, 0x4C, 0x24 }, movRdx[] = { 0x48, 0x89, 0x54, 0x24 };
+				static const BYTE movR11[] = { 0x4C, 0x8B, 0xDC }, movRax[] = { 0x48, 0x8B, 0xC4 }, subRsp[] = { 0x48, 0x83, 0xEC }, pushRbx[] = { 0x40, 0x53 };
+				return(leads(bytes, movRbx) || leads(bytes, movRcx) || leads(bytes, movRdx) || leads(bytes, movR11) ||
+					   leads(bytes, movRax) || leads(bytes, subRsp) || leads(bytes, pushRbx));
+			}
+
+			// Hot patch "mov edi,edi", frame, and the SEH prolog helper setup
+			static const BYTE hotPatch[] = { 0x8B, 0xFF, 0x55, 0x8B, 0xEC }, pushMov[] = { 0x55, 0x8B, 0xEC }, sehPrologue[] = { 0x6A };
+			return(leads(bytes, hotPatch) || leads(bytes, pushMov) || (leads(bytes, sehPrologue) && (bytes[2] == 0x68)));
+		}
+	};
+
+	struct GnuProfile
+	{
+		enum { FILLS = (FILL_BIT(FILL_CC) | FILL_BIT(FILL_ZERO) | FILL_BIT(NOP)), ALIGN = 16, PASS1_SAFE = TRUE };
+		static BOOL isPrologue(const BYTE *bytes, BOOL is64)
+		{
+			if (is64)
+			{
+				// Frame, callee saved pushes, "sub rsp,N"
+				static const BYTE pushMov[] = { 0x55, 0x48, 0x89, 0xE5 }, pushR15[] = { 0x41, 0x57 }, pushR14[] = { 0x41, 0x56 }, pushR12[] = { 0x41, 0x54 };
+				static const BYTE subRsp[] = { 0x48, 0x83, 0xEC };
+				return(leads(bytes, pushMov) || leads(bytes, pushR15) || leads(bytes, pushR14) || leads(bytes, pushR12) || leads(bytes, subRsp));
+			}
+
+			// GAS encodes "mov ebp,esp" as 89 E5; callee saved pushes
+			static const BYTE pushMov[] = { 0x55, 0x89, 0xE5 }, pushEsiEbx[] = { 0x56, 0x53 }, pushEdiEsi[] = { 0x57, 0x56, 0x53 }, pushSub[] = { 0x53, 0x83, 0xEC };
+			return(leads(bytes, pushMov) || leads(bytes, pushEsiEbx) || leads(bytes, pushEdiEsi) || leads(bytes, pushSub));
+		}
+	};
+
+	// Data is mixed with code, so pass 1 would undo it; functions are 4 aligned with NOPs and its own fillers
+	struct BorlandProfile
+	{
+		enum { FILLS = (FILL_BIT(NOP) | FILL_BIT(FILLER)), ALIGN = 4, PASS1_SAFE = FALSE };
+		static BOOL isPrologue(const BYTE *bytes, BOOL is64)
+		{
+			// Frame, and the register convention "push ebx; mov ebx,eax" style saves
+			static const BYTE pushMov[] = { 0x55, 0x8B, 0xEC }, saveEax[] = { 0x53, 0x8B, 0xD8 }, saveEdx[] = { 0x53, 0x56, 0x8B, 0xF2 }, pushAll[] = { 0x53, 0x56, 0x57 };
+			return(leads(bytes, pushMov) || leads(bytes, saveEax) || leads(bytes, saveEdx) || leads(bytes, pushAll));
+		}
+	};
+};
@@ -0,0 +1,140 @@
+// SDK call trace file format, shared by the recorder ("SdkTrace.h") and the replay tool.
+// No IDA or Windows dependencies here.
+//
+// A TRACEHEADER, then the database prologue: the IDB facts the passes read but don't change (info,
+// segments, function chunks, names, fixups, the plugin's netnode data) and every segment's full flags.
+// A TC_PROLOGUE_END, then TRACERECs in call order, ended with a TC_END record.
+// Integers are little endian, addresses are always 64 bit.
+// TC_FLAGS_RUN records are followed by "arg1" 32 bit full flags, one per address from "arg0" on;
+// consecutive get_full_flags() calls (as a segment snapshot does) coalesce into one.
+// Other payloads are padded to 8 bytes.
+// The item and function changes IDA makes during a call, the call's own and the auto-analyzer's,
+// are TC_EV_* (and TC_CHUNK) records just before the call's.
+#pragma once
+#include <stdint.h>
+
+#define TRACE_MAGIC   0x31545058 // "XPT1"
+#define TRACE_VERSION 2
+
+enum TRACECALL
+{
+	TC_END,				// arg0 = total TSC ticks, result = total seconds (double bits)
+	TC_FLAGS_RUN,		// arg0 = start, arg1 = count, payload flags
+	TC_GET_FLAGS,		// arg0 = ea, result = flags
+	TC_GET_FULL_FLAGS,	// arg0 = ea, result = flags, a lone one
+	TC_NEXT_HEAD,		// arg0 = ea, arg1 = max ea, result = ea
+	TC_PREV_HEAD,		// arg0 = ea, arg1 = min ea, result = ea
+	TC_NEXT_UNKNOWN,	// arg0 = ea, arg1 = max ea, result = ea
+	TC_NEXT_THAT,		// arg0 = ea, arg1 = max ea, result = ea
+	TC_GET_ITEM_END,	// arg0 = ea, result = ea
+	TC_DECODE_INSN,		// arg0 = ea, arg1 = itype, result = size, extra[0] = operands, payload TRACEOPs
+	TC_CREATE_INSN,		// arg0 = ea, arg1 = itype, result = size, extra[0] = operands, payload TRACEOPs
+	TC_ADD_FUNC,		// arg0 = start, arg1 = end, result = bool
+	TC_GET_FCHUNK,		// arg0 = ea, arg1 = chunk end, result = chunk start or BADADDR
+	TC_GET_FUNC,		// arg0 = ea, arg1 = function end, result = function start or BADADDR
+	TC_DEL_ITEMS,		// arg0 = ea, arg1 = size, result = bool
+	TC_CREATE_BYTE,		// arg0 = ea, arg1 = size, result = bool
+	TC_CREATE_ALIGN,	// arg0 = ea, arg1 = size, result = bool
+	TC_AUTO_WAIT,		// result = bool
+	TC_AUTO_MARK_RANGE,	// arg0 = start, arg1 = end
+	TC_GET_FIRST_CREF_FROM,	// arg0 = ea, result = ea
+	TC_GET_SWITCH_INFO,	// arg0 = ea, arg1 = jump table, result = return value, payload TRACESWITCH if > 0
+	TC_DECODE_PREV_INSN,	// arg0 = ea, arg1 = itype, result = instruction ea, extra[0] = operands, payload TRACEOPs
+	TC_GET_FIRST_CREF_TO,	// arg0 = ea, result = ea
+	TC_GET_FIRST_DREF_FROM,	// arg0 = ea, result = ea
+	TC_GET_FIRST_DREF_TO,	// arg0 = ea, result = ea
+	TC_FLOW_CHART,		// arg0 = function start, arg1 = blocks, result = successors, payload TRACEBLOCKs then 32 bit successors
+
+	// xrefblk_t, extra[0] = xref type, extra[1] = is code, extra[2] = the first_ call's XREF_ flags
+	TC_XREF_FIRST_FROM,	// arg0 = from, arg1 = XREF_ flags, result = to or BADADDR
+	TC_XREF_NEXT_FROM,	// arg0 = from, arg1 = current to, result = to or BADADDR
+	TC_XREF_FIRST_TO,	// arg0 = to, arg1 = XREF_ flags, result = from or BADADDR
+	TC_XREF_NEXT_TO,	// arg0 = to, arg1 = current from, result = from or BADADDR
+
+	// Database prologue
+	TC_INFO,			// arg0 = image base, arg1 = min ea, result = max ea, extra[0] = 64 bit
+	TC_SEGMENT,			// arg0 = start, arg1 = end, result = type, extra[0] = bitness, extra[1] = permissions, payload TRACESEGNAMES
+	TC_CHUNK,			// arg0 = start, arg1 = end, result = tail owner or BADADDR, extra = flags' low 24 bits, also an event
+	TC_NAME,			// arg0 = ea, arg1 = length, payload the name
+	TC_FIXUP,			// arg0 = ea, arg1 = type
+	TC_ALTVAL,			// arg0 = index, arg1 = value, extra[0] = tag, the plugin's netnode
+	TC_BLOB,			// arg0 = TRACEBLOB, arg1 = size, payload the data
+	TC_PROLOGUE_END,
+
+	// IDB change events
+	TC_EV_CODE,			// arg0 = ea, arg1 = size
+	TC_EV_DATA,			// arg0 = ea, arg1 = size, result = flags
+	TC_EV_DESTROYED,	// arg0 = start, arg1 = end
+	TC_EV_CHUNK_DEL,	// arg0 = chunk start
+	TC_COUNT
+};
+
+#pragma pack(push, 1)
+struct TRACEHEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t eaSize;	// Recording plugin's ea_t size, 4 or 8
+	uint32_t reserved;
+};
+
+struct TRACEREC
+{
+	uint8_t  call;		// TRACECALL
+	uint8_t  extra[3];	// Call specific, see TRACECALL
+	uint32_t ticks;		// TSC ticks spent in the call, saturated
+	uint64_t arg0, arg1;
+	uint64_t result;
+};
+
+// Instruction operand, up to the first o_void
+struct TRACEOP
+{
+	uint8_t  type, dtype, offb, flags;
+	uint16_t reg, reserved;
+	uint64_t value, addr;
+};
+
+struct TRACESWITCH
+{
+	uint32_t flags;
+	uint16_t ncases;
+	uint8_t  jsize, vsize;	// Table element sizes
+	int32_t  jcases, reserved;
+	uint64_t jumps, values;
+};
+
+// Flow chart block, its successors "firstSucc" on in the chart's successor list
+struct TRACEBLOCK
+{
+	uint64_t start, end;
+	uint32_t firstSucc, succCount;
+};
+
+struct TRACESEGNAMES
+{
+	char name[32];
+	char sclass[16];
+};
+#pragma pack(pop)
+
+enum TRACEBLOB
+{
+	TB_PE_HEADER,	// "$ PE header" netnode value
+	TB_PASS_RATES,	// The plugin's measured pass rates
+};
+
+#define TRACE_PAYLOAD_SIZE(_bytes) ((((uint64_t) (_bytes)) + 7) & ~((uint64_t) 7))
+
+#define TRACE_BADADDR ((uint64_t) -1)
+
+static const char * const TRACE_CALL_NAMES[TC_COUNT] =
+{
+	"end", "get_full_flags (run)", "get_flags", "get_full_flags", "next_head", "prev_head", "next_unknown",
+	"next_that", "get_item_end", "decode_insn", "create_insn", "add_func", "get_fchunk", "get_func",
+	"del_items", "create_byte", "create_align", "auto_wait", "auto_mark_range", "get_first_cref_from",
+	"get_switch_info", "decode_prev_insn", "get_first_cref_to", "get_first_dref_from", "get_first_dref_to",
+	"qflow_chart_t",	"xrefblk_t::first_from", "xrefblk_t::next_from", "xrefblk_t::first_to", "xrefblk_t::next_to",
+	"(info)", "(segment)", "(function chunk)", "(name)", "(fixup)", "(altval)", "(blob)", "(prologue end)",
+	"(made code)", "(made data)", "(destroyed items)", "(deleted chunk)",
+};